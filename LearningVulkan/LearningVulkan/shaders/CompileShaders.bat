@@ -1,3 +1,7 @@
 C:/VulkanSDK/1.3.231.1/Bin32/glslc.exe shader.vert -o vert.spv
 C:/VulkanSDK/1.3.231.1/Bin32/glslc.exe shader.frag -o frag.spv
+C:/VulkanSDK/1.3.231.1/Bin32/glslc.exe indirect.vert -o indirect_vert.spv
+C:/VulkanSDK/1.3.231.1/Bin32/glslc.exe cull.comp -o cull.spv
+C:/VulkanSDK/1.3.231.1/Bin32/glslc.exe -DOCCLUSION_CULLING cull.comp -o cull_occlusion.spv
+C:/VulkanSDK/1.3.231.1/Bin32/glslc.exe hiz.comp -o hiz.spv
 pause
\ No newline at end of file
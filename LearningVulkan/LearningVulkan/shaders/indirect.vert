@@ -0,0 +1,33 @@
+#version 450
+
+struct Object {
+    vec4 transform; //xy offset, zw scale
+    vec4 boundingSphere;
+    uint indexCount;
+    uint firstIndex;
+    int vertexOffset;
+    float depth; //Distance in front of the camera
+};
+
+layout(set = 0, binding = 0) readonly buffer Objects {
+    Object objects[];
+};
+
+layout(push_constant) uniform Camera {
+    mat4 projection; //There is no view matrix, positions are already in view space
+} camera;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+//The depth prepass and the shading pass use different pipelines, their depths have to match exactly for the EQUAL test
+invariant gl_Position;
+
+void main() {
+    //The culling pass wrote each draw's object index as its firstInstance
+    Object object = objects[gl_InstanceIndex];
+    gl_Position = camera.projection * vec4(inPosition * object.transform.zw + object.transform.xy, -object.depth, 1.0);
+    fragColor = inColor;
+}
\ No newline at end of file
@@ -1,20 +1,23 @@
 #version 450
 
-layout(location = 0) out vec3 fragColor;
+layout(set = 0, binding = 0) uniform DrawConstants {
+    vec4 transform; //xy offset, zw scale
+    float depth; //Distance in front of the camera
+} draw;
+
+layout(push_constant) uniform Camera {
+    mat4 projection; //There is no view matrix, positions are already in view space
+} camera;
 
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
 
-vec3 colors[3] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+//The depth prepass and the shading pass use different pipelines, their depths have to match exactly for the EQUAL test
+invariant gl_Position;
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
+    gl_Position = camera.projection * vec4(inPosition * draw.transform.zw + draw.transform.xy, -draw.depth, 1.0);
+    fragColor = inColor;
 }
\ No newline at end of file
@@ -2,139 +2,578 @@
 
 #include "Core/Renderer/VulkanValidationLayer.h"
 
+#include <glm/gtc/matrix_transform.hpp>
+
 #include <iostream>
 #include <fstream>
 #include <map>
 #include <set>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
 
 ///////////////////////////////////////////
-void Application::Init(const int width, const int height, const char* appName)
+VulkanVertexLayout Vertex::GetLayout()
+{
+	VulkanVertexLayout layout;
+	layout.AddBinding(sizeof(Vertex))
+		.AddAttribute(0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, position))
+		.AddAttribute(1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color));
+	return layout;
+}
+
+///////////////////////////////////////////
+void Application::Init(const int width, const int height, const char* appName, const ApplicationSettings& settings)
 {
 	m_screenWidth = width;
 	m_screenHeight = height;
 	m_pApplicationName = appName;
+	m_settings = settings;
+	m_settings.framesInFlight = std::clamp(m_settings.framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+	m_settings.depthLayerCount = std::max(m_settings.depthLayerCount, 1u);
+	if (m_settings.bOcclusionCulling) {
+		m_settings.bGpuDrivenRendering = true;
+	}
 
-	//Initialize GLFW and our window
-	glfwInit();
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API); //Do not create a OpenGL context (Not needed for Vulkan)
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE); //TODO: Make the window resizeable
-	m_pWindow = glfwCreateWindow(m_screenWidth, m_screenHeight, m_pApplicationName, nullptr, nullptr); //Last paramater only relevant to OpenGL
+	if (!m_settings.bHeadless) {
+		//Initialize GLFW and our window
+		glfwInit();
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API); //Do not create a OpenGL context (Not needed for Vulkan)
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+		m_pWindow = glfwCreateWindow(m_screenWidth, m_screenHeight, m_pApplicationName, nullptr, nullptr); //Last paramater only relevant to OpenGL
+		glfwSetWindowUserPointer(m_pWindow, this);
+		glfwSetFramebufferSizeCallback(m_pWindow, FramebufferResizeCallback);
+	}
 
 	//Initialize Vulkan objects
-	m_vulkanInstance.CreateInstance(m_pApplicationName);
+	m_vulkanInstance.CreateInstance(m_pApplicationName, m_settings.bHeadless);
 	//TODO: Seperate debug messenger from instance class? 
-	CreateSurface();
-	m_vulkanDevices.InitDevice(m_vulkanInstance.GetInstanceObject(), m_surface);
-	m_vulkanSwapchain.InitSwapChain(m_pWindow, &m_vulkanDevices, m_surface);
-	m_vulkanSwapchain.CreateImageViews(m_vulkanDevices.GetLogicalDevice());
+	if (!m_settings.bHeadless) {
+		CreateSurface();
+	}
+	DeviceFeatureRequests featureRequests;
+	featureRequests.bPipelineStatistics = m_settings.bPipelineStatistics;
+	featureRequests.bIndirectDrawCount = m_settings.bGpuDrivenRendering;
+	m_vulkanDevices.InitDevice(m_vulkanInstance.GetInstanceObject(), m_surface, featureRequests);
+	if (m_settings.bGpuDrivenRendering && !m_vulkanDevices.IsDrawIndirectCountEnabled()) {
+		std::cerr << "GPU driven rendering needs drawIndirectCount, multiDrawIndirect and drawIndirectFirstInstance, falling back to CPU recording\n";
+		m_settings.bGpuDrivenRendering = false;
+		m_settings.bOcclusionCulling = false;
+	}
+	if (m_settings.bHeadless) {
+		CreateOffscreenTarget();
+	}
+	else {
+		m_vulkanSwapchain.InitSwapChain(m_pWindow, &m_vulkanDevices, m_surface);
+		m_vulkanSwapchain.CreateImageViews(m_vulkanDevices.GetLogicalDevice());
+	}
+	//The Hi-Z build samples the depth images
+	m_depthFormat = m_vulkanDevices.FindDepthFormat(m_settings.bOcclusionCulling ? VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT : 0);
 	CreateRenderPass();
+	m_pipelineCache.InitPipelineCache(&m_vulkanDevices, m_settings.pipelineCachePath);
+	m_jobSystem.InitJobSystem(m_settings.workerThreadCount);
+	CreateUniformAllocator();
 	CreateGraphicsPipeline();
+	CreateDepthTarget();
 	CreateFramebuffers();
 	CreateCommandPool();
-	CreateCommandBuffer();
+	CreateCommandBuffers();
 	CreateSyncObjects();
+	m_uploadEngine.InitUploadEngine(&m_vulkanDevices, static_cast<VkDeviceSize>(m_settings.uploadRingMegabytes) * 1024 * 1024);
+	m_defragmenter.InitDefragmenter(&m_vulkanDevices, &m_graphicsTimeline, static_cast<VkDeviceSize>(m_settings.defragmentBudgetKilobytes) * 1024);
+	if (m_settings.fragmentationTestBufferCount > 0) {
+		CreateFragmentationTestBuffers();
+	}
+	CreateSceneMesh();
+	UpdateProjection();
+	BuildDrawList();
+	if (m_settings.sceneNodeCount > 0) {
+		CreateSceneHierarchy();
+	}
+	if (m_settings.bGpuDrivenRendering) {
+		UploadCullingObjects();
+	}
+	if (m_settings.bStaticCommandBuffers) {
+		CreateStaticCommandBuffers();
+	}
+
+	m_gpuProfiler.InitProfiler(&m_vulkanDevices, m_settings.framesInFlight);
+	m_pipelineStatistics.InitPipelineStatistics(&m_vulkanDevices, m_settings.framesInFlight);
+	if (m_settings.bPipelineStatistics && !m_pipelineStatistics.IsEnabled()) {
+		std::cerr << "Pipeline statistics queries are not supported by this device\n";
+	}
+	else if (m_settings.bParallelRecording && m_pipelineStatistics.IsEnabled() && !m_pipelineStatistics.SupportsSecondaryCommandBuffers()) {
+		std::cerr << "Pipeline statistics are not collected while recording in parallel, inheritedQueries is not supported by this device\n";
+	}
 }
 
 ///////////////////////////////////////////
 void Application::Run()
 {
-	while (!glfwWindowShouldClose(m_pWindow)) {
-		glfwPollEvents();
-		DrawFrame();
+	if (m_settings.uploadBenchmarkMegabytes > 0) {
+		m_uploadBandwidthMBps = RunUploadBenchmark();
+		std::cout << "Uploaded " << m_settings.uploadBenchmarkMegabytes << "MB at " << m_uploadBandwidthMBps << " MB/s\n";
+	}
+
+	//Checked first as a benchmark runs the same with or without a window, it draws its own frame counts instead of headlessFrameCount
+	if (m_settings.bBenchmark) {
+		RunBenchmark();
+		return;
+	}
+
+	if (m_settings.bHeadless) {
+		uint32_t renderedFrameCount = 0;
+		double seconds = RunTimed(m_settings.headlessFrameCount, renderedFrameCount);
+		std::cout << "Rendered " << renderedFrameCount << " headless frames in " << seconds << "s (" << renderedFrameCount / seconds << " frames/s)\n";
+		return;
+	}
+
+	while (!ShouldClose()) {
+		Tick();
 	}
 
 	vkDeviceWaitIdle(m_vulkanDevices.GetLogicalDevice());
 }
 
+///////////////////////////////////////////
+double Application::RunTimed(const uint32_t frameCount, uint32_t& renderedFrameCount)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	renderedFrameCount = 0;
+	for (; renderedFrameCount < frameCount && !ShouldClose(); ++renderedFrameCount) {
+		Tick();
+	}
+
+	//Include the frames still in flight so deeper rings are not rewarded for work they have not finished
+	vkDeviceWaitIdle(m_vulkanDevices.GetLogicalDevice());
+
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+	return elapsed.count();
+}
+
+///////////////////////////////////////////
+void Application::RunBenchmark()
+{
+	//Warm up so pipeline creation, driver caches and the swap chain queue have settled before anything is timed
+	m_frameRecorder.SetRecording(false);
+	for (uint32_t i = 0; i < m_settings.benchmarkWarmupFrames && !ShouldClose(); ++i) {
+		Tick();
+	}
+
+	m_frameRecorder.Clear();
+	m_frameRecorder.SetRecording(true);
+	for (uint32_t i = 0; i < m_settings.benchmarkMeasureFrames && !ShouldClose(); ++i) {
+		Tick();
+	}
+	m_frameRecorder.SetRecording(false);
+
+	vkDeviceWaitIdle(m_vulkanDevices.GetLogicalDevice());
+
+	WriteBenchmarkReport(m_settings.benchmarkOutputPath);
+
+	FrameStatistics stats = m_frameRecorder.GetFrameStatistics();
+	std::cout << "Benchmark: " << m_frameRecorder.GetSampleCount() << " frames, mean " << stats.mean << "ms, p50 " << stats.p50 << "ms, p95 " << stats.p95 << "ms, p99 " << stats.p99 << "ms\n";
+	if (m_pipelineStatistics.IsEnabled()) {
+		VkExtent2D extents = GetRenderTargetExtents();
+		double fragmentsPerFrame = GetFragmentsPerFrame();
+		std::cout << "Fragments: " << fragmentsPerFrame / 1000000.0 << "M shaded per frame, " << fragmentsPerFrame / (static_cast<double>(extents.width) * extents.height) << " per pixel\n";
+	}
+	if (m_settings.stressTriangleCount > 0 && stats.mean > 0.0) {
+		double trianglesPerFrame = static_cast<double>(m_sceneMesh.GetTriangleCount()) * m_drawList.size();
+		std::cout << "Geometry: " << trianglesPerFrame / 1000000.0 << "M triangles per frame, " << (trianglesPerFrame * (1000.0 / stats.mean)) / 1000000.0 << "M triangles/s\n";
+	}
+	std::cout << "Report written to " << m_settings.benchmarkOutputPath << "\n";
+}
+
+///////////////////////////////////////////
+double Application::RunUploadBenchmark()
+{
+	//Streamed in frame sized chunks into a destination that is reused, so the ring wraps and recycles many times over
+	const VkDeviceSize chunkSize = 4 * 1024 * 1024;
+	const VkDeviceSize destinationSize = 64 * 1024 * 1024;
+	VkDeviceSize totalSize = static_cast<VkDeviceSize>(m_settings.uploadBenchmarkMegabytes) * 1024 * 1024;
+
+	VulkanBuffer destination;
+	destination.InitBuffer(&m_vulkanDevices, destinationSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	std::vector<uint8_t> source(chunkSize);
+	for (size_t i = 0; i < source.size(); ++i) {
+		source[i] = static_cast<uint8_t>(i * 31);
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (VkDeviceSize uploaded = 0; uploaded < totalSize; uploaded += chunkSize) {
+		VkDeviceSize size = std::min(chunkSize, totalSize - uploaded);
+		m_uploadEngine.UploadBuffer(destination.GetBuffer(), uploaded % destinationSize, source.data(), size);
+		m_uploadEngine.Flush();
+	}
+
+	//Finish the way a frame would, with the graphics queue taking ownership of everything written
+	m_uploadEngine.Flush();
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = m_commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	if (vkAllocateCommandBuffers(m_vulkanDevices.GetLogicalDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to Allocate Command Buffer");
+	}
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	TimelineWait uploadWait = m_uploadEngine.RecordAcquires(commandBuffer);
+	vkEndCommandBuffer(commandBuffer);
+
+	std::vector<TimelineWait> waits;
+	if (uploadWait.semaphore != VK_NULL_HANDLE) {
+		waits.push_back(uploadWait);
+	}
+	m_graphicsTimeline.WaitForValue(m_graphicsTimeline.Submit(m_vulkanDevices.GetGraphicsQueue(), { commandBuffer }, waits, {}));
+
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	vkFreeCommandBuffers(m_vulkanDevices.GetLogicalDevice(), m_commandPool, 1, &commandBuffer);
+	destination.DestroyBuffer();
+
+	double megabytes = static_cast<double>(totalSize) / (1024.0 * 1024.0);
+	return elapsed.count() > 0.0 ? megabytes / elapsed.count() : 0.0;
+}
+
 ///////////////////////////////////////////
 void Application::Cleanup()
 {
 	m_vulkanInstance.DestroyDebugMessenger();
 
+	//Waits for the last submit and destroys anything still retiring, such as swap chains replaced by a resize
+	m_graphicsTimeline.DestroyTimeline();
+	m_uploadEngine.DestroyUploadEngine();
+
+	//Moves still in flight are dropped before the buffers they would have moved are destroyed
+	m_defragmenter.DestroyDefragmenter();
+	for (auto& buffer : m_fragmentationTestBuffers) {
+		buffer.DestroyBuffer();
+	}
+	m_fragmentationTestBuffers.clear();
+	m_sceneMesh.DestroyMesh();
+	if (m_settings.sceneNodeCount > 0) {
+		m_sceneTransformBuffer.DestroyBuffer();
+	}
+
+	m_commandAllocator.DestroyCommandAllocator();
+	m_gpuProfiler.DestroyProfiler();
+	m_pipelineStatistics.DestroyPipelineStatistics();
+
+	m_pipelineCache.SaveToDisk();
+	m_pipelineCache.DestroyPipelineCache();
+
 	VkDevice logicalDevice = m_vulkanDevices.GetLogicalDevice();
 	for (auto fbs : m_swapchainFramebuffers) {
 		vkDestroyFramebuffer(logicalDevice, fbs, nullptr);
 	}
+	m_depthTarget.DestroyDepthTarget();
 
-	m_vulkanSwapchain.DestroyImageViews(logicalDevice);
+	if (m_settings.bHeadless) {
+		m_offscreenTarget.DestroyOffscreenTarget(logicalDevice);
+	}
+	else {
+		m_vulkanSwapchain.DestroyImageViews(logicalDevice);
+	}
 
-	vkDestroySemaphore(logicalDevice, m_imageAvailableSemaphore, nullptr);
-	vkDestroySemaphore(logicalDevice, m_renderFinishedSemaphore, nullptr);
-	vkDestroyFence(logicalDevice, m_inFlightFence, nullptr);
+	for (auto& frame : m_frames) {
+		vkDestroySemaphore(logicalDevice, frame.imageAvailableSemaphore, nullptr);
+	}
 
-	vkDestroyPipeline(logicalDevice, m_graphicsPipeline, nullptr);
+	for (auto semaphore : m_renderFinishedSemaphores) {
+		vkDestroySemaphore(logicalDevice, semaphore, nullptr);
+	}
+
+	//The device is idle by now so any presents to old swap chains have been consumed
+	DestroyRetiredPresentations(m_retiredPresentations);
+	DestroyRetiredPresentations(m_fencedPresentations);
+	vkDestroyFence(logicalDevice, m_acquireFence, nullptr);
+
+	//Waits for background compiles before destroying the pipelines, so the workers are only stopped afterwards
+	m_pipelineLibrary.DestroyPipelineLibrary();
+	m_jobSystem.DestroyJobSystem();
 	vkDestroyPipelineLayout(logicalDevice, m_pipelineLayout, nullptr);
+	if (m_settings.bGpuDrivenRendering) {
+		vkDestroyPipelineLayout(logicalDevice, m_gpuDrivenPipelineLayout, nullptr);
+		m_gpuCulling.DestroyGpuCulling();
+	}
+	if (m_settings.bOcclusionCulling) {
+		m_hiZPyramid.DestroyHiZPyramid();
+		vkDestroyRenderPass(logicalDevice, m_latePassRenderPass, nullptr);
+	}
+	if (m_settings.bDepthPrepass) {
+		vkDestroyRenderPass(logicalDevice, m_depthPrepassRenderPass, nullptr);
+	}
+	m_uniformAllocator.DestroyUniformAllocator();
 	vkDestroyRenderPass(logicalDevice, m_renderPass, nullptr);
 
-	m_vulkanSwapchain.DestroySwapChain(logicalDevice);
+	if (!m_settings.bHeadless) {
+		m_vulkanSwapchain.DestroySwapChain(logicalDevice);
+	}
 
 	vkDestroyCommandPool(logicalDevice, m_commandPool, nullptr);
 
 	m_vulkanDevices.DestroyDevice();
 
-	vkDestroySurfaceKHR(m_vulkanInstance.GetInstanceObject(), m_surface, nullptr);
+	if (!m_settings.bHeadless) {
+		vkDestroySurfaceKHR(m_vulkanInstance.GetInstanceObject(), m_surface, nullptr);
+	}
 
 	m_vulkanInstance.DestroyInstance();
 
 	//Cleanup GLFW
-	glfwDestroyWindow(m_pWindow);
-	glfwTerminate();
+	if (!m_settings.bHeadless) {
+		glfwDestroyWindow(m_pWindow);
+		glfwTerminate();
+	}
 }
 
 ///////////////////////////////////////////
-std::vector<char> Application::ReadFile(const std::string& filename)
+const VulkanGpuProfiler& Application::GetGpuProfiler() const
 {
-	//std::ios::ate (start reading at end of file) std::ios::binary(read as a binary file and avoid text transformations)
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+	return m_gpuProfiler;
+}
 
-	if (!file.is_open()) {
-		throw std::runtime_error("Failed to open file: " + filename);
+///////////////////////////////////////////
+void Application::InvalidateStaticCommandBuffers()
+{
+	for (auto& staticCommandBuffer : m_staticCommandBuffers) {
+		staticCommandBuffer.bRecorded = false;
 	}
+}
 
-	size_t fileSize = (size_t)file.tellg();
-	std::vector<char> buffer(fileSize);
-
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
-
-	file.close();
-
-	return buffer;
+///////////////////////////////////////////
+double Application::GetFragmentsPerFrame() const
+{
+	double fragments = 0.0;
+	for (const auto& pass : m_pipelineStatistics.GetPassStatistics()) {
+		if (pass.second.frameCount > 0) {
+			fragments += static_cast<double>(pass.second.total[static_cast<size_t>(PipelineStatistic::FragmentShaderInvocations)]) / pass.second.frameCount;
+		}
+	}
+	return fragments;
 }
 
 ///////////////////////////////////////////
-void Application::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+void Application::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, bool bPrerecorded)
 {
 	VkCommandBufferBeginInfo beginInfo{};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	beginInfo.flags = 0;
 	beginInfo.pInheritanceInfo = nullptr;
 
-	if (vkBeginCommandBuffer(m_commandBuffer, &beginInfo) != VK_SUCCESS) {
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to Record Command Buffer");
 	}
 
+	//Queries belong to a frame slot, a buffer replayed by whichever slot presents its image cannot own any
+	bool bProfile = !bPrerecorded;
+
+	//The slot's previous frame has finished so its timestamps can be read back without waiting
+	if (bProfile) {
+		m_gpuProfiler.BeginFrame(commandBuffer, m_currentFrame);
+		m_pipelineStatistics.BeginFrame(commandBuffer, m_currentFrame);
+		m_gpuProfiler.BeginScope(commandBuffer, "Frame");
+	}
+
+	CullingPhase firstPhase = m_settings.bOcclusionCulling ? CullingPhase::Early : CullingPhase::All;
+
+	//Culling writes the indirect commands, so it runs before the render pass and is part of every replay of a static buffer
+	if (m_settings.bGpuDrivenRendering) {
+		if (bProfile) {
+			m_gpuProfiler.BeginScope(commandBuffer, "Culling");
+		}
+		m_gpuCulling.RecordCulling(commandBuffer, m_projection, firstPhase, &m_hiZPyramid);
+		if (bProfile) {
+			m_gpuProfiler.EndScope(commandBuffer); //Culling
+		}
+	}
+
+	if (m_settings.bDepthPrepass) {
+		RecordScenePass(commandBuffer, imageIndex, m_depthPrepassRenderPass, "DepthPrepass", bPrerecorded, true, firstPhase);
+	}
+	RecordScenePass(commandBuffer, imageIndex, m_renderPass, "MainPass", bPrerecorded, false, firstPhase);
+
+	//This frame's depth so far becomes the pyramid the late phase tests against, and the one next frame's early phase starts from
+	if (m_settings.bOcclusionCulling) {
+		if (bProfile) {
+			m_gpuProfiler.BeginScope(commandBuffer, "HiZ");
+		}
+		m_hiZPyramid.RecordBuild(commandBuffer, imageIndex);
+		m_gpuCulling.RecordCulling(commandBuffer, m_projection, CullingPhase::Late, &m_hiZPyramid);
+		if (bProfile) {
+			m_gpuProfiler.EndScope(commandBuffer); //HiZ
+		}
+
+		RecordScenePass(commandBuffer, imageIndex, m_latePassRenderPass, "LatePass", bPrerecorded, false, CullingPhase::Late);
+	}
+
+	if (bProfile) {
+		m_gpuProfiler.EndScope(commandBuffer); //Frame
+	}
+
+	//End the command buffer and check for success
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record command buffer!");
+	}
+}
+
+///////////////////////////////////////////
+void Application::RecordScenePass(VkCommandBuffer commandBuffer, uint32_t imageIndex, VkRenderPass renderPass, const char* name, bool bPrerecorded, bool bDepthOnly, CullingPhase phase)
+{
+	bool bProfile = !bPrerecorded;
+
+	//Statistics queries can only stay active across secondary command buffers when they are inherited
+	bool bParallel = m_settings.bParallelRecording && !bPrerecorded && !m_settings.bGpuDrivenRendering;
+	bool bMeasurePass = bProfile && (!bParallel || m_pipelineStatistics.SupportsSecondaryCommandBuffers());
+
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 
-	//Define what attachements to bind
-	renderPassInfo.renderPass = m_renderPass;
+	//Define what attachements to bind, every scene pass is compatible with the one the framebuffers were made for
+	renderPassInfo.renderPass = renderPass;
 	renderPassInfo.framebuffer = m_swapchainFramebuffers[imageIndex];
 
 	//Define the size of the render pass area
-	VkExtent2D swapchainExtents = m_vulkanSwapchain.GetExtents();
+	VkExtent2D swapchainExtents = GetRenderTargetExtents();
 	renderPassInfo.renderArea.offset = { 0,0 };
 	renderPassInfo.renderArea.extent = swapchainExtents;
 
-	//Defins the clear color
-	VkClearValue clearColor = { {{0.0f,0.0f,0.0f,1.0f}} };
-	renderPassInfo.clearValueCount = 1;
-	renderPassInfo.pClearValues = &clearColor;
+	//Defins the clear color and depth, in attachment order. Passes that load their attachments ignore them
+	VkClearValue clearValues[2]{};
+	clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+	clearValues[1].depthStencil = { m_settings.bReversedDepth ? 0.0f : 1.0f, 0 };
+	renderPassInfo.clearValueCount = 2;
+	renderPassInfo.pClearValues = clearValues;
+
+	if (bProfile) {
+		m_gpuProfiler.BeginScope(commandBuffer, name);
+	}
+	if (bMeasurePass) {
+		m_pipelineStatistics.BeginPass(commandBuffer, name);
+	}
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, bParallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+
+	uint32_t drawCount = static_cast<uint32_t>(m_drawList.size());
+	PipelineHandle pipelineOverride = bDepthOnly ? m_depthPrepassPipeline : INVALID_PIPELINE_HANDLE;
+	if (m_settings.bGpuDrivenRendering) {
+		PipelineHandle pipeline = m_gpuDrivenPipeline;
+		if (bDepthOnly) {
+			pipeline = m_gpuDrivenPrepassPipeline;
+		}
+		else if (phase == CullingPhase::Late) {
+			pipeline = m_gpuDrivenLatePipeline;
+		}
+		RecordIndirectDraws(commandBuffer, phase, pipeline);
+	}
+	else if (bParallel) {
+		VkCommandBufferInheritanceInfo inheritanceInfo{};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = renderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = m_swapchainFramebuffers[imageIndex];
+		inheritanceInfo.pipelineStatistics = bMeasurePass ? m_pipelineStatistics.GetInheritedStatistics() : 0;
+
+		const std::vector<VkCommandBuffer>& secondaries = m_parallelRecorder.RecordSecondaries(inheritanceInfo, drawCount,
+			[this, pipelineOverride](VkCommandBuffer secondary, uint32_t firstDraw, uint32_t rangeCount) { RecordDrawRange(secondary, firstDraw, rangeCount, false, pipelineOverride); });
+		vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+	}
+	else {
+		RecordDrawRange(commandBuffer, 0, drawCount, bPrerecorded, pipelineOverride);
+	}
 
-	vkCmdBeginRenderPass(m_commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	//Finish our render pass
+	vkCmdEndRenderPass(commandBuffer);
+	if (bMeasurePass) {
+		m_pipelineStatistics.EndPass(commandBuffer);
+	}
+	if (bProfile) {
+		m_gpuProfiler.EndScope(commandBuffer);
+	}
+}
+
+///////////////////////////////////////////
+void Application::RecordDrawRange(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount, bool bPrerecorded, PipelineHandle pipelineOverride)
+{
+	//Each range takes one block of the frame's region, so parallel tasks only touch the allocator once
+	VkDeviceSize constantsStride = m_uniformAllocator.GetAlignedSize(sizeof(DrawConstants));
+	uint32_t constantsOffset = 0;
+	if (bPrerecorded) {
+		constantsOffset = m_staticConstantsOffset + static_cast<uint32_t>(firstDraw * constantsStride);
+	}
+	else {
+		UniformAllocation constants = m_uniformAllocator.Allocate(constantsStride * drawCount);
+		for (uint32_t i = 0; i < drawCount; ++i) {
+			DrawConstants* pConstants = reinterpret_cast<DrawConstants*>(static_cast<uint8_t*>(constants.pData) + i * constantsStride);
+			pConstants->transform = m_drawList[firstDraw + i].transform;
+			pConstants->depth = m_drawList[firstDraw + i].depth;
+		}
+		constantsOffset = constants.offset;
+	}
+
+	VkDescriptorSet descriptorSet = m_uniformAllocator.GetDescriptorSet();
+
+	RecordViewportAndScissor(commandBuffer);
+	vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &m_projection);
+
+	//Every draw shares the scene mesh, so it is bound once per range
+	m_sceneMesh.Bind(commandBuffer);
+
+	PipelineHandle boundHandle = INVALID_PIPELINE_HANDLE;
+	for (uint32_t i = firstDraw; i < firstDraw + drawCount; ++i) {
+		const DrawItem& draw = m_drawList[i];
+		PipelineHandle drawPipeline = pipelineOverride != INVALID_PIPELINE_HANDLE ? pipelineOverride : draw.pipeline;
+
+		//A pipeline still compiling on a worker skips its draws rather than stalling the frame
+		if (drawPipeline != boundHandle) {
+			VkPipeline pipeline = m_pipelineLibrary.GetPipeline(drawPipeline);
+			if (pipeline == VK_NULL_HANDLE) {
+				continue;
+			}
+
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			boundHandle = drawPipeline;
+		}
+
+		uint32_t dynamicOffset = constantsOffset + static_cast<uint32_t>((i - firstDraw) * constantsStride);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &descriptorSet, 1, &dynamicOffset);
+
+		//command buffer, index count, instance count, first index, vertex offset, first instance
+		vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, draw.vertexOffset, 0);
+	}
+}
+
+///////////////////////////////////////////
+void Application::RecordIndirectDraws(VkCommandBuffer commandBuffer, CullingPhase phase, PipelineHandle pipelineHandle)
+{
+	//Startup waits for these pipelines, so unlike the draw list there is nothing to skip
+	VkPipeline pipeline = m_pipelineLibrary.GetPipeline(pipelineHandle);
+	if (pipeline == VK_NULL_HANDLE) {
+		return;
+	}
+
+	RecordViewportAndScissor(commandBuffer);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	vkCmdPushConstants(commandBuffer, m_gpuDrivenPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &m_projection);
+	m_sceneMesh.Bind(commandBuffer);
+	m_gpuCulling.RecordDraws(commandBuffer, m_gpuDrivenPipelineLayout, phase);
+}
 
-	vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+///////////////////////////////////////////
+void Application::RecordViewportAndScissor(VkCommandBuffer commandBuffer)
+{
+	VkExtent2D swapchainExtents = GetRenderTargetExtents();
 
 	//Create and set the viewport
 	VkViewport viewport{};
@@ -144,256 +583,391 @@ void Application::RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t im
 	viewport.height = static_cast<float>(swapchainExtents.height);
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
-	vkCmdSetViewport(m_commandBuffer, 0, 1, &viewport);
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
 	//Create and set the scissor
 	VkRect2D scissor{};
 	scissor.offset = { 0,0 };
 	scissor.extent = swapchainExtents;
-	vkCmdSetScissor(m_commandBuffer, 0, 1, &scissor);
-
-	//command buffer, vertex count, instance count, first vertex, first instance
-	vkCmdDraw(m_commandBuffer, 3, 1, 0, 0);
-
-	//Finish our render pass
-	vkCmdEndRenderPass(m_commandBuffer);
-
-	//End the command buffer and check for success
-	if (vkEndCommandBuffer(m_commandBuffer) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to record command buffer!");
-	}
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
 
 ///////////////////////////////////////////
-VkShaderModule Application::CreateShaderModule(const std::vector<char>& code)
+void Application::CreateSurface()
 {
-	VkShaderModuleCreateInfo createInfo{};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = code.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-	VkShaderModule shaderModule;
-	if (vkCreateShaderModule(m_vulkanDevices.GetLogicalDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create shader module!");
+	if (glfwCreateWindowSurface(m_vulkanInstance.GetInstanceObject(), m_pWindow, nullptr, &m_surface) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create window surface!");
 	}
+}
 
-	return shaderModule;
+///////////////////////////////////////////
+void Application::CreateOffscreenTarget()
+{
+	//One image per frame in flight so a frame never renders into an image the GPU is still writing for an earlier frame
+	VkExtent2D extents = { static_cast<uint32_t>(m_screenWidth), static_cast<uint32_t>(m_screenHeight) };
+	m_offscreenTarget.InitOffscreenTarget(&m_vulkanDevices, extents, VK_FORMAT_R8G8B8A8_UNORM, m_settings.framesInFlight);
 }
 
 ///////////////////////////////////////////
-void Application::CreateSurface()
+void Application::CreateRenderPass()
 {
-	if (glfwCreateWindowSurface(m_vulkanInstance.GetInstanceObject(), m_pWindow, nullptr, &m_surface) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create window surface!");
+	//With occlusion culling the frame is split around the Hi-Z build, the early pass hands its attachments to the late one
+	bool bSplitFrame = m_settings.bOcclusionCulling;
+	bool bPrepass = m_settings.bDepthPrepass;
+	if (bPrepass) {
+		m_depthPrepassRenderPass = BuildRenderPass(true, false);
+	}
+	m_renderPass = BuildRenderPass(!bPrepass, !bSplitFrame);
+	if (bSplitFrame) {
+		m_latePassRenderPass = BuildRenderPass(false, true);
 	}
 }
 
 ///////////////////////////////////////////
-void Application::CreateRenderPass()
+VkRenderPass Application::BuildRenderPass(bool bFirstPass, bool bLastPass)
 {
 	VkAttachmentDescription colorAttachment{};
-	colorAttachment.format = m_vulkanSwapchain.GetImageFormat();
+	colorAttachment.format = GetRenderTargetFormat();
 	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.loadOp = bFirstPass ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
 	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	colorAttachment.initialLayout = bFirstPass ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	//Offscreen images are left ready to be copied out rather than presented
+	colorAttachment.finalLayout = !bLastPass ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : (m_settings.bHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+	//Depth only has to outlive the frame's last pass when a later pass or the Hi-Z build reads it
+	VkAttachmentDescription depthAttachment{};
+	depthAttachment.format = m_depthFormat;
+	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depthAttachment.loadOp = bFirstPass ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+	depthAttachment.storeOp = bLastPass ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = bFirstPass ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	depthAttachment.finalLayout = bLastPass ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
 	VkAttachmentReference colorAttachmentRef{};
 	colorAttachmentRef.attachment = 0; //Directly read from the shader
 	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+	VkAttachmentReference depthAttachmentRef{};
+	depthAttachmentRef.attachment = 1;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
 	VkSubpassDescription subpass{};
 	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 	subpass.colorAttachmentCount = 1;
 	subpass.pColorAttachments = &colorAttachmentRef;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+	VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment };
 
 	VkRenderPassCreateInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassInfo.attachmentCount = 1;
-	renderPassInfo.pAttachments = &colorAttachment;
+	renderPassInfo.attachmentCount = 2;
+	renderPassInfo.pAttachments = attachments;
 	renderPassInfo.subpassCount = 1;
 	renderPassInfo.pSubpasses = &subpass;
 
-	VkSubpassDependency dependancy{};
-	dependancy.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependancy.dstSubpass = 0;
-
-	dependancy.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependancy.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependancy;
-
-	if (vkCreateRenderPass(m_vulkanDevices.GetLogicalDevice(), &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) {
+	//Waits for the previous user of the attachments, a frame that rendered into the same images or compute that sampled the depth
+	VkSubpassDependency dependancies[2]{};
+	dependancies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependancies[0].dstSubpass = 0;
+
+	dependancies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	dependancies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependancies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependancies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	//A pass that is not the last makes its depth visible to the Hi-Z build, the following pass is covered by the dependency above
+	dependancies[1].srcSubpass = 0;
+	dependancies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependancies[1].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependancies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependancies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	dependancies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	renderPassInfo.dependencyCount = bLastPass ? 1 : 2;
+	renderPassInfo.pDependencies = dependancies;
+
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	if (vkCreateRenderPass(m_vulkanDevices.GetLogicalDevice(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create Render Pass!");
 	}
+	return renderPass;
 }
 
 ///////////////////////////////////////////
 void Application::CreateGraphicsPipeline()
 {
-	auto vertShaderCode = ReadFile("shaders/vert.spv");
-	auto fragShaderCode = ReadFile("shaders/frag.spv");
-
-	VkShaderModule vertShaderModule = CreateShaderModule(vertShaderCode);
-	VkShaderModule fragShaderModule = CreateShaderModule(fragShaderCode);
-
-	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	vertShaderStageInfo.module = vertShaderModule;
-	vertShaderStageInfo.pName = "main";
-
-	VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	fragShaderStageInfo.module = fragShaderModule;
-	fragShaderStageInfo.pName = "main";
-
-	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-
-	std::vector<VkDynamicState> dynamicStates = {
-		VK_DYNAMIC_STATE_VIEWPORT,
-		VK_DYNAMIC_STATE_SCISSOR
-	};
-
-	VkPipelineDynamicStateCreateInfo dynamicState{};
-	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-	dynamicState.pDynamicStates = dynamicStates.data();
-
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 0;
-	vertexInputInfo.pVertexBindingDescriptions = nullptr;
-	vertexInputInfo.vertexAttributeDescriptionCount = 0;
-	vertexInputInfo.pVertexAttributeDescriptions = nullptr;
-
-	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-	VkExtent2D swapchainExtents = m_vulkanSwapchain.GetExtents();
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)swapchainExtents.width;
-	viewport.height = (float)swapchainExtents.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor{};
-	scissor.offset = { 0, 0 };
-	scissor.extent = swapchainExtents;
-
-	VkPipelineViewportStateCreateInfo viewportState{};
-	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
-	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
-
-	VkPipelineRasterizationStateCreateInfo rasterizer{};
-	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizer.depthClampEnable = VK_FALSE;
-	rasterizer.rasterizerDiscardEnable = VK_FALSE;
-	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterizer.lineWidth = 1.0f;
-	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-	rasterizer.depthBiasEnable = VK_FALSE;
-	rasterizer.depthBiasConstantFactor = 0.0f;
-	rasterizer.depthBiasClamp = 0.0f;
-	rasterizer.depthBiasSlopeFactor = 0.0f;
-
-	VkPipelineMultisampleStateCreateInfo multisampling{};
-	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampling.sampleShadingEnable = VK_FALSE;
-	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-	multisampling.minSampleShading = 1.0f;
-	multisampling.pSampleMask = nullptr;
-	multisampling.alphaToCoverageEnable = VK_FALSE;
-	multisampling.alphaToOneEnable = VK_FALSE;
-
-	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
-	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-	VkPipelineColorBlendStateCreateInfo colorBlending{};
-	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlending.logicOpEnable = VK_FALSE;
-	colorBlending.logicOp = VK_LOGIC_OP_COPY;
-	colorBlending.attachmentCount = 1;
-	colorBlending.pAttachments = &colorBlendAttachment;
-	colorBlending.blendConstants[0] = 0.0f;
-	colorBlending.blendConstants[1] = 0.0f;
-	colorBlending.blendConstants[2] = 0.0f;
-	colorBlending.blendConstants[3] = 0.0f;
-
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 0;
-	pipelineLayoutInfo.pSetLayouts = nullptr;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	pipelineLayoutInfo.pPushConstantRanges = nullptr;
+	VkDescriptorSetLayout descriptorSetLayout = m_uniformAllocator.GetDescriptorSetLayout();
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+
+	//The camera's projection, shared by every draw
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(glm::mat4);
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
 	if (vkCreatePipelineLayout(m_vulkanDevices.GetLogicalDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create Pipeline Layout!");
 	}
 
-	VkGraphicsPipelineCreateInfo pipelineInfo{};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
-	pipelineInfo.pStages = shaderStages;
-
-	pipelineInfo.pVertexInputState = &vertexInputInfo;
-	pipelineInfo.pInputAssemblyState = &inputAssembly;
-	pipelineInfo.pViewportState = &viewportState;
-	pipelineInfo.pRasterizationState = &rasterizer;
-	pipelineInfo.pMultisampleState = &multisampling;
-	pipelineInfo.pDepthStencilState = nullptr;
-	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.pDynamicState = &dynamicState;
-	pipelineInfo.layout = m_pipelineLayout;
-	pipelineInfo.renderPass = m_renderPass;
-	pipelineInfo.subpass = 0;
-	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-	pipelineInfo.basePipelineIndex = -1;
+	m_pipelineLibrary.InitPipelineLibrary(&m_vulkanDevices, m_pipelineCache.GetPipelineCache(), &m_jobSystem);
+
+	GraphicsPipelineDescription description{};
+	description.vertexShaderPath = "shaders/vert.spv";
+	description.fragmentShaderPath = "shaders/frag.spv";
+	VulkanVertexLayout vertexLayout = Vertex::GetLayout();
+	description.vertexBindings = vertexLayout.GetBindingDescriptions();
+	description.vertexAttributes = vertexLayout.GetAttributeDescriptions();
+	description.layout = m_pipelineLayout;
+	description.renderPass = m_renderPass;
+	description.colorFormat = GetRenderTargetFormat();
+	description.bDepthTestEnable = true;
+	description.bDepthWriteEnable = true;
+	description.depthCompareOp = m_settings.bReversedDepth ? VK_COMPARE_OP_GREATER : VK_COMPARE_OP_LESS;
+
+	//After a prepass the depth buffer already holds the nearest surface, shading only passes where it matches
+	GraphicsPipelineDescription shadingDescription = description;
+	GraphicsPipelineDescription prepassDescription = description;
+	if (m_settings.bDepthPrepass) {
+		shadingDescription.bDepthWriteEnable = false;
+		shadingDescription.depthCompareOp = VK_COMPARE_OP_EQUAL;
+		prepassDescription.fragmentShaderPath.clear();
+		prepassDescription.colorWriteMask = 0;
+	}
 
-	VkDevice logicalDevice = m_vulkanDevices.GetLogicalDevice();
-	if (vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create graphics pipeline!");
+	//Every pipeline is queued to the workers, startup only blocks on the ones marked required
+	auto start = std::chrono::high_resolution_clock::now();
+	m_graphicsPipeline = m_pipelineLibrary.RequestPipeline(shadingDescription, PipelinePriority::Required);
+	if (m_settings.bDepthPrepass) {
+		m_depthPrepassPipeline = m_pipelineLibrary.RequestPipeline(prepassDescription, PipelinePriority::Required);
+	}
+
+	if (m_settings.bGpuDrivenRendering) {
+		VkDescriptorSetLayout occlusionSetLayout = VK_NULL_HANDLE;
+		if (m_settings.bOcclusionCulling) {
+			m_hiZPyramid.InitHiZPyramid(&m_vulkanDevices, &m_pipelineLibrary, &m_graphicsTimeline, m_settings.bReversedDepth);
+			occlusionSetLayout = m_hiZPyramid.GetCullingDescriptorSetLayout();
+		}
+		m_gpuCulling.InitGpuCulling(&m_vulkanDevices, &m_pipelineLibrary, std::max(m_settings.drawCount, 1u), occlusionSetLayout);
+
+		VkDescriptorSetLayout cullingSetLayout = m_gpuCulling.GetDescriptorSetLayout();
+		pipelineLayoutInfo.pSetLayouts = &cullingSetLayout;
+		if (vkCreatePipelineLayout(m_vulkanDevices.GetLogicalDevice(), &pipelineLayoutInfo, nullptr, &m_gpuDrivenPipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Pipeline Layout!");
+		}
+
+		//The same three variants drawing through the culling pass's objects, the library hands back one pipeline when two descriptions match
+		for (GraphicsPipelineDescription* pDescription : { &description, &shadingDescription, &prepassDescription }) {
+			pDescription->vertexShaderPath = "shaders/indirect_vert.spv";
+			pDescription->layout = m_gpuDrivenPipelineLayout;
+		}
+		m_gpuDrivenPipeline = m_pipelineLibrary.RequestPipeline(shadingDescription, PipelinePriority::Required);
+		m_gpuDrivenLatePipeline = m_pipelineLibrary.RequestPipeline(description, PipelinePriority::Required);
+		if (m_settings.bDepthPrepass) {
+			m_gpuDrivenPrepassPipeline = m_pipelineLibrary.RequestPipeline(prepassDescription, PipelinePriority::Required);
+		}
+	}
+	m_pipelineLibrary.WaitForRequiredPipelines();
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	m_pipelineCreationMs = elapsed.count();
+
+	std::cout << "Waiting for required pipelines took " << m_pipelineCreationMs << "ms (" << (m_pipelineCache.WasLoadedFromDisk() ? "warm" : "cold") << " pipeline cache)\n";
+}
+
+///////////////////////////////////////////
+void Application::CreateSceneMesh()
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+
+	if (m_settings.stressTriangleCount == 0) {
+		vertices = {
+			{ glm::vec2(0.0f, -0.5f), glm::vec3(1.0f, 0.0f, 0.0f) },
+			{ glm::vec2(0.5f, 0.5f), glm::vec3(0.0f, 1.0f, 0.0f) },
+			{ glm::vec2(-0.5f, 0.5f), glm::vec3(0.0f, 0.0f, 1.0f) }
+		};
+		indices = { 0, 1, 2 };
+	}
+	else {
+		//Every draw renders the whole grid, so each copy gets its share of the requested triangles. Two triangles per cell
+		uint32_t trianglesPerDraw = std::max(m_settings.stressTriangleCount / std::max(m_settings.drawCount, 1u), 2u);
+		uint32_t cells = static_cast<uint32_t>(std::ceil(std::sqrt(trianglesPerDraw / 2.0)));
+		uint32_t rowLength = cells + 1;
+
+		vertices.reserve(static_cast<size_t>(rowLength) * rowLength);
+		for (uint32_t y = 0; y < rowLength; ++y) {
+			for (uint32_t x = 0; x < rowLength; ++x) {
+				float u = static_cast<float>(x) / cells;
+				float v = static_cast<float>(y) / cells;
+				vertices.push_back({ glm::vec2(u - 0.5f, v - 0.5f), glm::vec3(u, v, 1.0f - u) });
+			}
+		}
+
+		//Wound clockwise on screen like the triangle, so back face culling keeps them
+		indices.reserve(static_cast<size_t>(cells) * cells * 6);
+		for (uint32_t y = 0; y < cells; ++y) {
+			for (uint32_t x = 0; x < cells; ++x) {
+				uint32_t topLeft = y * rowLength + x;
+				uint32_t bottomLeft = topLeft + rowLength;
+				indices.insert(indices.end(), { topLeft, topLeft + 1, bottomLeft + 1 });
+				indices.insert(indices.end(), { topLeft, bottomLeft + 1, bottomLeft });
+			}
+		}
+	}
+
+	//The grid and the triangle both fit inside [-0.5, 0.5], the sphere only has to be conservative
+	m_sceneMeshBounds = glm::vec4(0.0f);
+	for (const Vertex& vertex : vertices) {
+		m_sceneMeshBounds.w = std::max(m_sceneMeshBounds.w, glm::length(vertex.position));
+	}
+
+	m_sceneMesh.InitMesh(&m_vulkanDevices, &m_uploadEngine, vertices.data(), static_cast<uint32_t>(vertices.size()), sizeof(Vertex), indices);
+	m_defragmenter.RegisterBuffer(m_sceneMesh.GetVertexBuffer());
+	m_defragmenter.RegisterBuffer(m_sceneMesh.GetIndexBuffer());
+}
+
+///////////////////////////////////////////
+void Application::UpdateProjection()
+{
+	//Deep enough for a thousand depth layers, see BuildDrawList()
+	const float nearPlane = 0.1f;
+	const float farPlane = 1000.0f;
+	VkExtent2D extents = GetRenderTargetExtents();
+	float aspectRatio = static_cast<float>(extents.width) / static_cast<float>(extents.height);
+
+	//View space y points down the screen like Vulkan's clip space, which keeps the meshes' clockwise winding.
+	//Reversed depth only swaps the planes, the projection then maps near to 1 and far to 0
+	if (m_settings.bReversedDepth) {
+		m_projection = glm::perspectiveRH_ZO(glm::radians(90.0f), aspectRatio, farPlane, nearPlane);
+	}
+	else {
+		m_projection = glm::perspectiveRH_ZO(glm::radians(90.0f), aspectRatio, nearPlane, farPlane);
+	}
+}
+
+///////////////////////////////////////////
+void Application::BuildDrawList()
+{
+	m_drawList.resize(std::max(m_settings.drawCount, 1u));
+
+	//Copies are laid out on a grid filling the screen so every draw is visible, a single draw keeps the mesh at its original size.
+	//Extra layers repeat the grid one unit further back each, front layer first
+	uint32_t layerCount = std::min(m_settings.depthLayerCount, static_cast<uint32_t>(m_drawList.size()));
+	uint32_t drawsPerLayer = static_cast<uint32_t>((m_drawList.size() + layerCount - 1) / layerCount);
+	uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(drawsPerLayer))));
+	float cellSize = 2.0f / columns;
+
+	//Layered copies fill their whole cell so each layer is a solid wall hiding the ones behind it
+	float scale = layerCount > 1 ? cellSize : cellSize * 0.5f;
+
+	for (size_t i = 0; i < m_drawList.size(); ++i) {
+		DrawItem& draw = m_drawList[i];
+		draw.pipeline = m_graphicsPipeline;
+		draw.indexCount = m_sceneMesh.GetIndexCount();
+		draw.firstIndex = 0;
+		draw.vertexOffset = 0;
+
+		uint32_t layer = static_cast<uint32_t>(i / drawsPerLayer);
+		uint32_t cell = static_cast<uint32_t>(i % drawsPerLayer);
+		float x = -1.0f + cellSize * (cell % columns + 0.5f);
+		float y = -1.0f + cellSize * (cell / columns + 0.5f);
+
+		//The grid is in normalized device coordinates, each layer is scaled with its distance so it covers the same part of the screen as the front one
+		float distance = 1.0f + layer;
+		glm::vec2 toViewSpace = distance / glm::vec2(m_projection[0][0], m_projection[1][1]);
+		draw.transform = glm::vec4(glm::vec2(x, y) * toViewSpace, glm::vec2(scale) * toViewSpace);
+		draw.depth = distance;
+	}
+}
+
+///////////////////////////////////////////
+void Application::UploadCullingObjects()
+{
+	std::vector<CullingObject> objects(m_drawList.size());
+	for (size_t i = 0; i < m_drawList.size(); ++i) {
+		const DrawItem& draw = m_drawList[i];
+		objects[i].transform = draw.transform;
+		objects[i].boundingSphere = m_sceneMeshBounds;
+		objects[i].indexCount = draw.indexCount;
+		objects[i].firstIndex = draw.firstIndex;
+		objects[i].vertexOffset = draw.vertexOffset;
+		objects[i].depth = draw.depth;
 	}
 
-	vkDestroyShaderModule(logicalDevice, vertShaderModule, nullptr);
-	vkDestroyShaderModule(logicalDevice, fragShaderModule, nullptr);
+	m_gpuCulling.UploadObjects(&m_uploadEngine, objects);
+}
+
+///////////////////////////////////////////
+void Application::CreateUniformAllocator()
+{
+	//256 bytes is the largest minUniformBufferOffsetAlignment the spec allows, the extra 64KB leaves room for other per frame data.
+	//The depth prepass records the draw list a second time
+	VkDeviceSize passCount = m_settings.bDepthPrepass ? 2 : 1;
+	VkDeviceSize regionSize = static_cast<VkDeviceSize>(std::max(m_settings.drawCount, 1u)) * 256 * passCount + 64 * 1024;
+	m_uniformAllocator.InitUniformAllocator(&m_vulkanDevices, m_settings.framesInFlight + 1, regionSize, sizeof(DrawConstants));
+}
+
+///////////////////////////////////////////
+void Application::WriteStaticDrawConstants()
+{
+	//Draws never change so the constants are written once, rewriting them while a static buffer reads them would race the GPU
+	if (m_staticConstantsOffset != UINT32_MAX) {
+		return;
+	}
+
+	VkDeviceSize constantsStride = m_uniformAllocator.GetAlignedSize(sizeof(DrawConstants));
+	m_uniformAllocator.BeginRegion(m_settings.framesInFlight);
+	UniformAllocation constants = m_uniformAllocator.Allocate(constantsStride * m_drawList.size());
+	for (size_t i = 0; i < m_drawList.size(); ++i) {
+		DrawConstants* pConstants = reinterpret_cast<DrawConstants*>(static_cast<uint8_t*>(constants.pData) + i * constantsStride);
+		pConstants->transform = m_drawList[i].transform;
+		pConstants->depth = m_drawList[i].depth;
+	}
+	m_staticConstantsOffset = constants.offset;
+}
+
+///////////////////////////////////////////
+void Application::CreateDepthTarget()
+{
+	//The Hi-Z build samples the depth after the early pass
+	VkImageUsageFlags extraUsage = m_settings.bOcclusionCulling ? VK_IMAGE_USAGE_SAMPLED_BIT : 0;
+	uint32_t imageCount = static_cast<uint32_t>(GetRenderTargetImageViews().size());
+	m_depthTarget.InitDepthTarget(&m_vulkanDevices, GetRenderTargetExtents(), m_depthFormat, imageCount, extraUsage);
+
+	if (m_settings.bOcclusionCulling) {
+		m_hiZPyramid.ResizePyramid(m_depthTarget.GetExtents(), m_depthTarget.GetImageViews());
+		m_bHiZPyramidNeedsInitialize = true;
+	}
 }
 
 ///////////////////////////////////////////
 void Application::CreateFramebuffers()
 {
-	m_swapchainFramebuffers.resize(m_vulkanSwapchain.GetImageViews().size());
+	const std::vector<VkImageView>& imageViews = GetRenderTargetImageViews();
+	const std::vector<VkImageView>& depthViews = m_depthTarget.GetImageViews();
+	m_swapchainFramebuffers.resize(imageViews.size());
 
-	for (size_t i = 0; i < m_vulkanSwapchain.GetImageViews().size(); ++i) {
+	for (size_t i = 0; i < imageViews.size(); ++i) {
 		VkImageView attachment[] = {
-			m_vulkanSwapchain.GetImageViews()[i]
+			imageViews[i],
+			depthViews[i]
 		};
 
-		VkExtent2D extents = m_vulkanSwapchain.GetExtents();
+		VkExtent2D extents = GetRenderTargetExtents();
 		VkFramebufferCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 		createInfo.renderPass = m_renderPass;
-		createInfo.attachmentCount = 1;
+		createInfo.attachmentCount = 2;
 		createInfo.pAttachments = attachment;
 		createInfo.width = extents.width;
 		createInfo.height = extents.height;
@@ -406,18 +980,72 @@ void Application::CreateFramebuffers()
 }
 
 ///////////////////////////////////////////
-void Application::CreateCommandBuffer()
+void Application::CreateCommandBuffers()
 {
+	m_frames.resize(m_settings.framesInFlight);
+
+	//Thread index 0 records the primary on the main thread, the parallel recorder's tasks use the ones after it
+	uint32_t threadCount = 1 + VulkanParallelRecorder::GetTaskCapacity(&m_jobSystem);
+	m_commandAllocator.InitCommandAllocator(&m_vulkanDevices, m_settings.framesInFlight, threadCount);
+	m_parallelRecorder.InitParallelRecorder(&m_commandAllocator, 1, &m_jobSystem);
+}
+
+///////////////////////////////////////////
+void Application::CreateStaticCommandBuffers()
+{
+	VkDevice logicalDevice = m_vulkanDevices.GetLogicalDevice();
+	WriteStaticDrawConstants();
+
+	//The old set may still be executing, free it once the GPU passes the last submitted value
+	if (!m_staticCommandBuffers.empty()) {
+		std::vector<VkCommandBuffer> retiredCommandBuffers;
+		for (auto& staticCommandBuffer : m_staticCommandBuffers) {
+			retiredCommandBuffers.push_back(staticCommandBuffer.commandBuffer);
+		}
+
+		VkCommandPool commandPool = m_commandPool;
+		m_graphicsTimeline.Retire(m_graphicsTimeline.GetLastSubmittedValue(), [logicalDevice, commandPool, retiredCommandBuffers]() {
+			vkFreeCommandBuffers(logicalDevice, commandPool, static_cast<uint32_t>(retiredCommandBuffers.size()), retiredCommandBuffers.data());
+		});
+	}
+
+	std::vector<VkCommandBuffer> commandBuffers(m_swapchainFramebuffers.size());
+
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.commandPool = m_commandPool;
-	//Specifies that this command can be submitted to a queue for execution but cannot be called from other command buffers
 	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandBufferCount = 1;
+	allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
 
-	if (vkAllocateCommandBuffers(m_vulkanDevices.GetLogicalDevice(), &allocInfo, &m_commandBuffer) != VK_SUCCESS) {
+	if (vkAllocateCommandBuffers(logicalDevice, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to Allocate Command Buffer");
 	}
+
+	m_staticCommandBuffers.clear();
+	m_staticCommandBuffers.resize(commandBuffers.size());
+	for (size_t i = 0; i < commandBuffers.size(); ++i) {
+		m_staticCommandBuffers[i].commandBuffer = commandBuffers[i];
+	}
+}
+
+///////////////////////////////////////////
+VkCommandBuffer Application::GetStaticCommandBuffer(uint32_t imageIndex)
+{
+	StaticCommandBuffer& staticCommandBuffer = m_staticCommandBuffers[imageIndex];
+
+	//Recorded without SIMULTANEOUS_USE, so a buffer can be neither resubmitted nor reset while a previous submit of it is still executing
+	m_graphicsTimeline.WaitForValue(staticCommandBuffer.timelineValue);
+	if (staticCommandBuffer.bRecorded) {
+		return staticCommandBuffer.commandBuffer;
+	}
+
+	vkResetCommandBuffer(staticCommandBuffer.commandBuffer, 0);
+	RecordCommandBuffer(staticCommandBuffer.commandBuffer, imageIndex, true);
+
+	//Draws skipped because their pipeline was still compiling would be baked in, so keep rerecording until every pipeline is ready
+	staticCommandBuffer.bRecorded = m_pipelineLibrary.GetPendingCount() == 0;
+
+	return staticCommandBuffer.commandBuffer;
 }
 
 ///////////////////////////////////////////
@@ -441,55 +1069,344 @@ void Application::CreateSyncObjects()
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
+	VkDevice logicalDevice = m_vulkanDevices.GetLogicalDevice();
+	for (auto& frame : m_frames) {
+		if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &frame.imageAvailableSemaphore) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Sychronisation objects!");
+		}
+	}
+
+	if (!m_settings.bHeadless) {
+		CreatePresentSemaphores();
+	}
+
+	//Only used to find out when retired swap chains can be destroyed
 	VkFenceCreateInfo fenceInfo{};
 	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; //Creates the fence in a already signaled state
 
-	VkDevice logicalDevice = m_vulkanDevices.GetLogicalDevice();
-	if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &m_imageAvailableSemaphore) != VK_SUCCESS ||
-		vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &m_renderFinishedSemaphore) != VK_SUCCESS ||
-		vkCreateFence(logicalDevice, &fenceInfo, nullptr, &m_inFlightFence) != VK_SUCCESS) {
+	if (vkCreateFence(logicalDevice, &fenceInfo, nullptr, &m_acquireFence) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create Sychronisation objects!");
 	}
+
+	//Replaces the per frame fences, a timeline value of 0 is already reached so fresh slots never wait
+	m_graphicsTimeline.InitTimeline(&m_vulkanDevices);
+}
+
+///////////////////////////////////////////
+void Application::CreatePresentSemaphores()
+{
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	m_renderFinishedSemaphores.resize(m_vulkanSwapchain.GetImages().size());
+	for (auto& semaphore : m_renderFinishedSemaphores) {
+		if (vkCreateSemaphore(m_vulkanDevices.GetLogicalDevice(), &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Sychronisation objects!");
+		}
+	}
+}
+
+///////////////////////////////////////////
+void Application::CreateFragmentationTestBuffers()
+{
+	//Sizes from 4KB to 252KB so the freed ranges are of every size class and rarely merge
+	std::vector<VulkanBuffer> buffers(m_settings.fragmentationTestBufferCount);
+	const VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	for (size_t i = 0; i < buffers.size(); ++i) {
+		VkDeviceSize size = ((i * 7919) % 63 + 1) * 4096;
+		buffers[i].InitBuffer(&m_vulkanDevices, size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+
+	m_fragmentationTestBuffers.reserve(buffers.size() / 2 + 1);
+	for (size_t i = 0; i < buffers.size(); ++i) {
+		if (i % 2 == 0) {
+			m_fragmentationTestBuffers.push_back(buffers[i]);
+		}
+		else {
+			buffers[i].DestroyBuffer();
+		}
+	}
+
+	//The survivors get real contents so a broken move would be visible in a capture
+	std::vector<uint8_t> contents(64 * 4096);
+	for (size_t i = 0; i < contents.size(); ++i) {
+		contents[i] = static_cast<uint8_t>(i * 31);
+	}
+
+	for (auto& buffer : m_fragmentationTestBuffers) {
+		m_uploadEngine.UploadBuffer(buffer.GetBuffer(), 0, contents.data(), buffer.GetSize());
+		m_defragmenter.RegisterBuffer(&buffer);
+	}
+}
+
+///////////////////////////////////////////
+VkCommandBuffer Application::RecordFrameSetup(std::vector<TimelineWait>& waits)
+{
+	//Everything uploaded since the last frame goes out in one transfer submit
+	m_uploadEngine.Flush();
+	bool bAcquireUploads = m_uploadEngine.HasPendingAcquires();
+	bool bMoveBuffers = m_defragmenter.PlanMoves() > 0;
+	bool bInitializePyramid = m_bHiZPyramidNeedsInitialize;
+	if (!bAcquireUploads && !bMoveBuffers && !bInitializePyramid) {
+		return VK_NULL_HANDLE;
+	}
+
+	//Kept out of the frame's own command buffer so static command buffers never replay an acquire or a move
+	VkCommandBuffer commandBuffer = m_commandAllocator.Allocate(0, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to Record Command Buffer");
+	}
+
+	//Acquired first, a buffer uploaded this frame may also be moved this frame
+	if (bAcquireUploads) {
+		waits.push_back(m_uploadEngine.RecordAcquires(commandBuffer));
+	}
+	if (bMoveBuffers) {
+		m_defragmenter.RecordMoves(commandBuffer);
+	}
+	//Nothing counts as occluded until the first build, so the first frame after a resize culls by frustum only
+	if (bInitializePyramid) {
+		m_hiZPyramid.RecordInitialize(commandBuffer);
+		m_bHiZPyramidNeedsInitialize = false;
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record command buffer!");
+	}
+
+	return commandBuffer;
+}
+
+///////////////////////////////////////////
+void Application::CreateSceneHierarchy()
+{
+	//Added depth first the way a scene file is walked. After each node the path climbs a random number of levels, which keeps the tree bushy and at most 16 deep
+	uint32_t nodeCount = m_settings.sceneNodeCount;
+	std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+	std::bernoulli_distribution climb(0.55);
+	std::vector<NodeHandle> path;
+
+	m_sceneRandom.seed(nodeCount);
+	m_sceneHierarchy.Reserve(nodeCount);
+	for (uint32_t i = 0; i < nodeCount; ++i) {
+		while (!path.empty() && (path.size() >= 16 || climb(m_sceneRandom))) {
+			path.pop_back();
+		}
+		NodeHandle parent = path.empty() ? INVALID_NODE_HANDLE : path.back();
+		path.push_back(m_sceneHierarchy.AddNode(parent, glm::vec3(offset(m_sceneRandom), offset(m_sceneRandom), offset(m_sceneRandom))));
+	}
+	m_sceneHierarchy.SetDestinationCount(m_settings.framesInFlight);
+
+	VkDeviceSize regionSize = static_cast<VkDeviceSize>(nodeCount) * sizeof(glm::mat4);
+	m_sceneTransformBuffer.InitBuffer(&m_vulkanDevices, regionSize * m_settings.framesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+///////////////////////////////////////////
+void Application::UpdateSceneHierarchy()
+{
+	uint32_t nodeCount = m_settings.sceneNodeCount;
+	uint32_t changeCount = static_cast<uint32_t>(nodeCount * std::clamp(m_settings.sceneChangeRatio, 0.0f, 1.0f));
+	std::uniform_int_distribution<uint32_t> node(0, nodeCount - 1);
+	std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+	for (uint32_t i = 0; i < changeCount; ++i) {
+		glm::vec3 position(offset(m_sceneRandom), offset(m_sceneRandom), offset(m_sceneRandom));
+		glm::quat rotation = glm::angleAxis(angle(m_sceneRandom), glm::vec3(0.0f, 1.0f, 0.0f));
+		m_sceneHierarchy.SetLocalTransform(node(m_sceneRandom), position, rotation, glm::vec3(1.0f));
+	}
+
+	glm::mat4* pRegion = static_cast<glm::mat4*>(m_sceneTransformBuffer.GetMappedData()) + static_cast<size_t>(nodeCount) * m_currentFrame;
+	m_sceneHierarchy.UpdateWorldMatrices(&m_jobSystem, pRegion, m_currentFrame);
+}
+
+///////////////////////////////////////////
+void Application::RecreateSwapChain()
+{
+	//A minimized window has a zero sized framebuffer which we cannot create a swap chain for, so wait until it is restored
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(m_pWindow, &width, &height);
+	while (width == 0 || height == 0) {
+		glfwGetFramebufferSize(m_pWindow, &width, &height);
+		glfwWaitEvents();
+	}
+
+	RetiredSwapChain retired = m_vulkanSwapchain.RecreateSwapChain(m_pWindow, &m_vulkanDevices, m_surface);
+	std::vector<VkFramebuffer> retiredFramebuffers = std::move(m_swapchainFramebuffers);
+	m_swapchainFramebuffers.clear();
+	VulkanDepthTarget retiredDepthTarget = m_depthTarget;
+
+	//Frames already submitted may still be rendering into the old framebuffers, they are destroyed once the GPU passes the last submitted value
+	VkDevice logicalDevice = m_vulkanDevices.GetLogicalDevice();
+	m_graphicsTimeline.Retire(m_graphicsTimeline.GetLastSubmittedValue(), [logicalDevice, retiredFramebuffers, imageViews = retired.imageViews, retiredDepthTarget]() mutable {
+		for (auto framebuffer : retiredFramebuffers) {
+			vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
+		}
+
+		retiredDepthTarget.DestroyDepthTarget();
+
+		for (auto imageView : imageViews) {
+			vkDestroyImageView(logicalDevice, imageView, nullptr);
+		}
+	});
+
+	//The timeline says nothing about the presents still queued on the old swap chain, so it and the semaphores they wait on go through the acquire fence instead
+	RetiredPresentation presentation{};
+	presentation.swapChain = retired.swapChain;
+	presentation.renderFinishedSemaphores = std::move(m_renderFinishedSemaphores);
+	m_retiredPresentations.push_back(std::move(presentation));
+
+	//The new swap chain may have a different amount of images
+	CreatePresentSemaphores();
+
+	//Viewport and scissor are dynamic state so the pipeline survives a resize, only the depth images and framebuffers need rebuilding
+	CreateDepthTarget();
+	CreateFramebuffers();
+
+	//The camera follows the new aspect ratio, the draw list stays where it is in view space
+	UpdateProjection();
+
+	//Static command buffers reference the old framebuffers and the image count may have changed
+	if (m_settings.bStaticCommandBuffers) {
+		CreateStaticCommandBuffers();
+	}
+}
+
+///////////////////////////////////////////
+void Application::CollectRetiredPresentations()
+{
+	//The presentation engine has handed back an image of a newer swap chain and the frame drawn into it has finished, so it is done with the older ones
+	VkDevice logicalDevice = m_vulkanDevices.GetLogicalDevice();
+	if (!m_fencedPresentations.empty() && m_graphicsTimeline.IsValueComplete(m_acquireFenceValue) && vkGetFenceStatus(logicalDevice, m_acquireFence) == VK_SUCCESS) {
+		DestroyRetiredPresentations(m_fencedPresentations);
+		vkResetFences(logicalDevice, 1, &m_acquireFence);
+	}
+}
+
+///////////////////////////////////////////
+void Application::DestroyRetiredPresentations(std::vector<RetiredPresentation>& presentations)
+{
+	VkDevice logicalDevice = m_vulkanDevices.GetLogicalDevice();
+	for (auto& presentation : presentations) {
+		for (auto semaphore : presentation.renderFinishedSemaphores) {
+			vkDestroySemaphore(logicalDevice, semaphore, nullptr);
+		}
+
+		vkDestroySwapchainKHR(logicalDevice, presentation.swapChain, nullptr);
+	}
+
+	presentations.clear();
+}
+
+///////////////////////////////////////////
+void Application::FramebufferResizeCallback(GLFWwindow* pWindow, int width, int height)
+{
+	auto app = reinterpret_cast<Application*>(glfwGetWindowUserPointer(pWindow));
+	app->m_bFramebufferResized = true;
 }
 
 ///////////////////////////////////////////
 void Application::DrawFrame()
 {
-	//Wait for previous frame to finish
+	FrameContext& frame = m_frames[m_currentFrame];
+
+	//Wait for the frame that last used this slot to finish, the other slots can still be executing on the GPU. No reset is needed as the next submit signals a new value
 	VkDevice logicalDevice = m_vulkanDevices.GetLogicalDevice();
-	vkWaitForFences(logicalDevice, 1, &m_inFlightFence, VK_TRUE, UINT64_MAX);
-	vkResetFences(logicalDevice, 1, &m_inFlightFence);
+	m_frameRecorder.BeginPhase(FramePhase::Wait);
+	m_graphicsTimeline.WaitForValue(frame.timelineValue);
+	m_frameRecorder.EndPhase(FramePhase::Wait);
+	m_graphicsTimeline.CollectRetired();
+	CollectRetiredPresentations();
+
+	//Buffers whose defragmentation copies have finished now use new handles, anything prerecorded with the old ones is stale
+	if (m_defragmenter.CompleteMoves() > 0) {
+		InvalidateStaticCommandBuffers();
+	}
 
-	//acquire an image from swap chain
-	uint32_t imageIndex;
-	vkAcquireNextImageKHR(logicalDevice, m_vulkanSwapchain.GetSwapChain(), UINT64_MAX, m_imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+	//Every command buffer the slot used last time is reset with one vkResetCommandPool per thread, and its uniform region is rewound
+	m_commandAllocator.BeginFrame(m_currentFrame);
+	m_uniformAllocator.BeginRegion(m_currentFrame);
+	if (m_settings.sceneNodeCount > 0) {
+		UpdateSceneHierarchy();
+	}
 
-	//Record a command buffer which draws the scene
-	vkResetCommandBuffer(m_commandBuffer, 0);
-	RecordCommandBuffer(m_commandBuffer, imageIndex);
+	//acquire an image from swap chain, in headless mode each ring slot owns its own offscreen image
+	uint32_t imageIndex = m_currentFrame;
+	std::vector<TimelineWait> waits;
+	std::vector<VkSemaphore> signals;
+	VkFence acquireFence = VK_NULL_HANDLE;
+
+	if (!m_settings.bHeadless) {
+		//Fenced while there are retired swap chains that are not yet waiting on the fence
+		acquireFence = (m_fencedPresentations.empty() && !m_retiredPresentations.empty()) ? m_acquireFence : VK_NULL_HANDLE;
+		m_frameRecorder.BeginPhase(FramePhase::Acquire);
+		VkResult result = vkAcquireNextImageKHR(logicalDevice, m_vulkanSwapchain.GetSwapChain(), UINT64_MAX, frame.imageAvailableSemaphore, acquireFence, &imageIndex);
+		m_frameRecorder.EndPhase(FramePhase::Acquire);
+
+		//Nothing has been acquired so the semaphore is left unsignalled and the slot can be reused straight away. Suboptimal images are still presentable so we draw and recreate after presenting
+		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+			RecreateSwapChain();
+			return;
+		}
+		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+			throw std::runtime_error("Failed to acquire swap chain image!");
+		}
 
-	//Submit the recorded command buffer
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		TimelineWait imageAvailable{};
+		imageAvailable.semaphore = frame.imageAvailableSemaphore;
+		imageAvailable.stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		waits.push_back(imageAvailable);
+		signals.push_back(m_renderFinishedSemaphores[imageIndex]);
+	}
 
-	VkSemaphore waitSemophores[] = { m_imageAvailableSemaphore };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemophores;
-	submitInfo.pWaitDstStageMask = waitStages;
+	//Record a command buffer which draws the scene, or reuse the image's static one if nothing has changed since it was recorded
+	m_frameRecorder.BeginPhase(FramePhase::Record);
+	std::vector<VkCommandBuffer> commandBuffers;
+	VkCommandBuffer setupCommandBuffer = RecordFrameSetup(waits);
+	if (setupCommandBuffer != VK_NULL_HANDLE) {
+		commandBuffers.push_back(setupCommandBuffer);
+	}
+
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	if (m_settings.bStaticCommandBuffers) {
+		commandBuffer = GetStaticCommandBuffer(imageIndex);
+	}
+	else {
+		commandBuffer = m_commandAllocator.Allocate(0, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+		RecordCommandBuffer(commandBuffer, imageIndex);
+	}
+	commandBuffers.push_back(commandBuffer);
+	m_frameRecorder.EndPhase(FramePhase::Record);
+
+	//Submit the recorded command buffer, it waits for the swap chain image and signals both the present semaphore and the next timeline value
+	m_frameRecorder.BeginPhase(FramePhase::Submit);
+	frame.timelineValue = m_graphicsTimeline.Submit(m_vulkanDevices.GetGraphicsQueue(), commandBuffers, waits, signals);
+	if (m_settings.bStaticCommandBuffers) {
+		m_staticCommandBuffers[imageIndex].timelineValue = frame.timelineValue;
+	}
+	m_frameRecorder.EndPhase(FramePhase::Submit);
 
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &m_commandBuffer;
+	//The fence is only signalled when an image was acquired, which it was if we got this far
+	if (acquireFence != VK_NULL_HANDLE) {
+		m_fencedPresentations = std::move(m_retiredPresentations);
+		m_retiredPresentations.clear();
+		m_acquireFenceValue = frame.timelineValue;
+	}
 
-	VkSemaphore signalSemaphores[] = { m_renderFinishedSemaphore };
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;
+	//Move on to the next slot in the ring
+	m_currentFrame = (m_currentFrame + 1) % static_cast<uint32_t>(m_frames.size());
 
-	if (vkQueueSubmit(m_vulkanDevices.GetGraphicsQueue(), 1, &submitInfo, m_inFlightFence) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to submit draw command buffer!");
+	if (m_settings.bHeadless) {
+		return;
 	}
 
+	//Present the swap chain image once rendering has finished
+	VkSemaphore signalSemaphores[] = { m_renderFinishedSemaphores[imageIndex] };
 
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -503,8 +1420,164 @@ void Application::DrawFrame()
 
 	presentInfo.pResults = nullptr;
 
-	vkQueuePresentKHR(m_vulkanDevices.GetPresentQueue(), &presentInfo);
+	m_frameRecorder.BeginPhase(FramePhase::Present);
+	VkResult result = vkQueuePresentKHR(m_vulkanDevices.GetPresentQueue(), &presentInfo);
+	m_frameRecorder.EndPhase(FramePhase::Present);
+
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_bFramebufferResized) {
+		m_bFramebufferResized = false;
+		RecreateSwapChain();
+	}
+	else if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to present swap chain image!");
+	}
+}
+
+///////////////////////////////////////////
+void Application::Tick()
+{
+	m_frameRecorder.BeginFrame();
+
+	if (!m_settings.bHeadless) {
+		glfwPollEvents();
+	}
+	DrawFrame();
+
+	m_frameRecorder.EndFrame();
+}
 
+///////////////////////////////////////////
+//Only the formats VulkanDevice::FindDepthFormat() can pick
+static const char* GetDepthFormatName(VkFormat format)
+{
+	switch (format) {
+	case VK_FORMAT_D32_SFLOAT: return "D32_SFLOAT";
+	case VK_FORMAT_X8_D24_UNORM_PACK32: return "X8_D24_UNORM_PACK32";
+	case VK_FORMAT_D16_UNORM: return "D16_UNORM";
+	default: return "unknown";
+	}
+}
 
-	//Present the swap chain image
+///////////////////////////////////////////
+void Application::WriteBenchmarkReport(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open benchmark report: " + path);
+	}
+
+	JsonWriter writer(file);
+	writer.BeginObject();
+
+	VkExtent2D extents = GetRenderTargetExtents();
+	writer.BeginObject("configuration");
+	writer.Write("device", m_vulkanDevices.GetPhysicalDeviceProperties().deviceName);
+	QueueFamilyIndices queueFamilies = m_vulkanDevices.FindQueueFamiliesForPhysicalDevice();
+	writer.Write("dedicatedComputeQueue", queueFamilies.HasDedicatedCompute());
+	writer.Write("dedicatedTransferQueue", queueFamilies.HasDedicatedTransfer());
+	writer.Write("width", extents.width);
+	writer.Write("height", extents.height);
+	writer.Write("framesInFlight", m_settings.framesInFlight);
+	writer.Write("headless", m_settings.bHeadless);
+	writer.Write("warmupFrames", m_settings.benchmarkWarmupFrames);
+	writer.Write("measuredFrames", m_settings.benchmarkMeasureFrames);
+	writer.Write("drawCount", static_cast<uint32_t>(m_drawList.size()));
+	writer.Write("parallelRecording", m_settings.bParallelRecording);
+	writer.Write("staticCommandBuffers", m_settings.bStaticCommandBuffers);
+	writer.Write("gpuDrivenRendering", m_settings.bGpuDrivenRendering);
+	writer.Write("occlusionCulling", m_settings.bOcclusionCulling);
+	writer.Write("depthLayers", m_settings.depthLayerCount);
+	writer.Write("reversedDepth", m_settings.bReversedDepth);
+	writer.Write("depthPrepass", m_settings.bDepthPrepass);
+	writer.Write("depthFormat", GetDepthFormatName(m_depthFormat));
+	writer.Write("recordingTasks", m_settings.bParallelRecording ? m_parallelRecorder.GetLastTaskCount() : 1u);
+	writer.Write("commandBuffersAllocated", m_commandAllocator.GetAllocatedCount());
+	writer.Write("commandBuffersReused", m_commandAllocator.GetReusedCount());
+	writer.EndObject();
+
+	writer.BeginObject("startup");
+	writer.Write("pipelineCreationMs", m_pipelineCreationMs);
+	writer.Write("pipelineCacheWarm", m_pipelineCache.WasLoadedFromDisk());
+	writer.Write("pipelineCount", static_cast<uint64_t>(m_pipelineLibrary.GetPipelineCount()));
+	writer.Write("pipelineLibraryHits", m_pipelineLibrary.GetCacheHits());
+	writer.Write("pipelineLibraryMisses", m_pipelineLibrary.GetCacheMisses());
+	writer.Write("pipelinesStillCompiling", static_cast<uint64_t>(m_pipelineLibrary.GetPendingCount()));
+	writer.Write("workerThreads", m_jobSystem.GetThreadCount());
+	writer.EndObject();
+
+	writer.BeginObject("geometry");
+	uint64_t trianglesPerFrame = static_cast<uint64_t>(m_sceneMesh.GetTriangleCount()) * m_drawList.size();
+	double meanFrameMs = m_frameRecorder.GetFrameStatistics().mean;
+	writer.Write("trianglesPerDraw", m_sceneMesh.GetTriangleCount());
+	writer.Write("trianglesPerFrame", trianglesPerFrame);
+	writer.Write("meshVertices", m_sceneMesh.GetVertexCount());
+	writer.Write("meshBytes", static_cast<uint64_t>(m_sceneMesh.GetSizeInBytes()));
+	writer.Write("trianglesPerSecond", meanFrameMs > 0.0 ? trianglesPerFrame * (1000.0 / meanFrameMs) : 0.0);
+	writer.EndObject();
+
+	//Overdraw as the fragment shader sees it, compare runs with and without the depth prepass for the savings
+	writer.BeginObject("fragments");
+	double fragmentsPerFrame = GetFragmentsPerFrame();
+	writer.Write("measured", m_pipelineStatistics.IsEnabled());
+	writer.Write("shadedPerFrame", fragmentsPerFrame);
+	writer.Write("shadedPerPixel", fragmentsPerFrame / (static_cast<double>(extents.width) * extents.height));
+	writer.EndObject();
+
+	if (m_settings.sceneNodeCount > 0) {
+		writer.BeginObject("transforms");
+		writer.Write("changeRatio", static_cast<double>(m_settings.sceneChangeRatio));
+		m_sceneHierarchy.WriteJson(writer);
+		writer.EndObject();
+	}
+
+	writer.BeginObject("upload");
+	m_uploadEngine.WriteJson(writer);
+	writer.Write("benchmarkMBps", m_uploadBandwidthMBps);
+	writer.EndObject();
+
+	writer.BeginObject("memory");
+	m_vulkanDevices.GetMemoryAllocator().WriteJson(writer);
+	writer.EndObject();
+
+	writer.BeginObject("defragmentation");
+	m_defragmenter.WriteJson(writer);
+	writer.EndObject();
+
+	writer.BeginObject("cpu");
+	m_frameRecorder.WriteJson(writer);
+	writer.EndObject();
+
+	writer.BeginObject("gpu");
+	m_gpuProfiler.WriteJson(writer);
+	writer.EndObject();
+
+	writer.BeginObject("pipelineStatistics");
+	m_pipelineStatistics.WriteJson(writer);
+	writer.EndObject();
+
+	writer.EndObject();
+}
+
+///////////////////////////////////////////
+VkExtent2D Application::GetRenderTargetExtents()
+{
+	return m_settings.bHeadless ? m_offscreenTarget.GetExtents() : m_vulkanSwapchain.GetExtents();
+}
+
+///////////////////////////////////////////
+VkFormat Application::GetRenderTargetFormat()
+{
+	return m_settings.bHeadless ? m_offscreenTarget.GetImageFormat() : m_vulkanSwapchain.GetImageFormat();
+}
+
+///////////////////////////////////////////
+const std::vector<VkImageView>& Application::GetRenderTargetImageViews()
+{
+	return m_settings.bHeadless ? m_offscreenTarget.GetImageViews() : m_vulkanSwapchain.GetImageViews();
+}
+
+///////////////////////////////////////////
+bool Application::ShouldClose()
+{
+	return !m_settings.bHeadless && glfwWindowShouldClose(m_pWindow);
 }
@@ -6,74 +6,343 @@
 #include "Core/Renderer/VulkanDevice.h"
 #include "Core/Renderer/VulkanInstance.h"
 #include "Core/Renderer/VulkanSwapChain.h"
+#include "Core/Renderer/VulkanTimeline.h"
+#include "Core/Renderer/VulkanOffscreenTarget.h"
+#include "Core/Renderer/VulkanGpuProfiler.h"
+#include "Core/Renderer/VulkanPipelineStatistics.h"
+#include "Core/Renderer/VulkanPipelineCache.h"
+#include "Core/Renderer/VulkanPipelineLibrary.h"
+#include "Core/Renderer/VulkanParallelRecorder.h"
+#include "Core/Renderer/VulkanCommandAllocator.h"
+#include "Core/Renderer/VulkanUploadEngine.h"
+#include "Core/Renderer/VulkanDefragmenter.h"
+#include "Core/Renderer/VulkanUniformAllocator.h"
+#include "Core/Renderer/VulkanVertexLayout.h"
+#include "Core/Renderer/VulkanMesh.h"
+#include "Core/Renderer/VulkanGpuCulling.h"
+#include "Core/Renderer/VulkanDepthTarget.h"
+#include "Core/Renderer/VulkanHiZPyramid.h"
+#include "Core/Profiling/FrameRecorder.h"
+#include "Core/Threading/JobSystem.h"
+#include "Core/Scene/TransformHierarchy.h"
+
+#include <glm/glm.hpp>
 
 #include <vector>
 #include <string>
 #include <optional>
+#include <random>
+
+///////////////////////////////////////////
+//Upper bound for the frames in flight ring, more than this just adds latency without letting the CPU get further ahead
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+///////////////////////////////////////////
+struct ApplicationSettings {
+	uint32_t framesInFlight = 2; //How many frames the CPU may record ahead of the GPU, clamped to [1, MAX_FRAMES_IN_FLIGHT]
+
+	//Renders into device local images with no window, surface or swap chain. Useful for software ICDs and render farms
+	bool bHeadless = false;
+	uint32_t headlessFrameCount = 1000; //With no window to close Run() stops after this many frames
+
+	//Run() draws benchmarkWarmupFrames untimed frames, then times benchmarkMeasureFrames frames and writes a JSON report to benchmarkOutputPath
+	bool bBenchmark = false;
+	uint32_t benchmarkWarmupFrames = 100;
+	uint32_t benchmarkMeasureFrames = 1000;
+	std::string benchmarkOutputPath = "benchmark.json";
+
+	//Collects vertex, clipping and fragment counters around each render pass (needs the pipelineStatisticsQuery feature)
+	bool bPipelineStatistics = false;
+
+	//Pipeline cache loaded at startup and written back at shutdown, an empty path disables persistence
+	std::string pipelineCachePath = "pipeline_cache.bin";
+
+	//Job system workers used for parallel recording and background pipeline compiles, 0 uses one per hardware thread minus the main thread
+	uint32_t workerThreadCount = 0;
+
+	//Copies of the mesh drawn each frame, raise it to stress command recording
+	uint32_t drawCount = 1;
+	//When non zero the triangle is replaced by a grid mesh sized so the whole draw list adds up to about this many triangles, raise it to stress geometry throughput
+	uint32_t stressTriangleCount = 0;
+	//Splits the draw list across the worker threads, each recording a secondary command buffer
+	bool bParallelRecording = false;
+	//Culls the draw list in a compute pass and draws the survivors with one vkCmdDrawIndexedIndirectCount, so recording cost does not grow with drawCount.
+	//Falls back to CPU recording when the device lacks drawIndirectCount. Parallel recording has nothing to split in this mode and is ignored
+	bool bGpuDrivenRendering = false;
+	//Two phase Hi-Z occlusion culling on top of GPU driven rendering, which it turns on. Objects hidden behind last frame's depth are skipped before any vertex work,
+	//a late pass tests them again against this frame's depth so anything that has just come into view is still drawn the same frame
+	bool bOcclusionCulling = false;
+	//Stacks the draw list in this many layers one behind the other, so all but the front layer are hidden. Gives occlusion culling something to reject
+	uint32_t depthLayerCount = 1;
+	//Swaps the projection's near and far planes so near maps to 1 and far to 0, with a GREATER test. A perspective divide crowds most of the depth range close to the camera,
+	//float depth is densest near 0 and so now puts its precision on distant geometry instead, giving close to even precision along the view
+	bool bReversedDepth = true;
+	//Draws the scene depth only first, then shades with an EQUAL test and no depth writes so every pixel runs the fragment shader once however much overdraw there is
+	bool bDepthPrepass = false;
+	//Records one command buffer per swap chain image and resubmits it until something invalidates it. GPU profiling is not available in this mode
+	bool bStaticCommandBuffers = false;
+
+	//Nodes in a random transform hierarchy whose world matrices are written every frame into a persistently mapped storage buffer, 0 builds none
+	uint32_t sceneNodeCount = 0;
+	//Fraction of the hierarchy's nodes given a new local transform each frame
+	float sceneChangeRatio = 0.01f;
+
+	//Size of the persistently mapped staging ring every upload goes through
+	uint32_t uploadRingMegabytes = 64;
+	//When non zero Run() first streams this many megabytes into a device local buffer and reports the upload bandwidth
+	uint32_t uploadBenchmarkMegabytes = 0;
+
+	//Most the defragmenter may copy each frame, 0 turns it off
+	uint32_t defragmentBudgetKilobytes = 4096;
+	//Creates this many small device local buffers and frees every other one at startup, leaving fragmented blocks for the defragmenter to compact
+	uint32_t fragmentationTestBufferCount = 0;
+};
+
+///////////////////////////////////////////
+//Resources owned by a single slot of the frames in flight ring. A slot is only reused once the GPU has reached the timeline value of the frame that last used it
+//The slot's command buffers come from m_commandAllocator
+struct FrameContext {
+	VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
+	uint64_t timelineValue = 0; //Value signalled by the last submit from this slot
+};
+
+///////////////////////////////////////////
+//A swap chain replaced by a resize together with the semaphores its presents wait on. Presents are not part of the graphics timeline,
+//so these are kept until an image acquired from a newer swap chain has been handed back and the frame drawn into it has finished
+struct RetiredPresentation {
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+	std::vector<VkSemaphore> renderFinishedSemaphores;
+};
+
+///////////////////////////////////////////
+//Command buffer recorded once for a single render target image, it is only rerecorded after being invalidated
+struct StaticCommandBuffer {
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	uint64_t timelineValue = 0; //Value signalled by the last submit of this buffer, it cannot be resubmitted or rerecorded before the GPU reaches it
+	bool bRecorded = false;
+};
+
+///////////////////////////////////////////
+//One entry in the list of draws recorded every frame
+struct DrawItem {
+	PipelineHandle pipeline = INVALID_PIPELINE_HANDLE;
+	uint32_t indexCount = 0;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	glm::vec4 transform = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f); //xy offset, zw scale in view space
+	float depth = 0.0f; //Distance in front of the camera, every vertex is at view space z = -depth
+};
+
+///////////////////////////////////////////
+//Matches the vertex inputs of shader.vert
+struct Vertex {
+	glm::vec2 position;
+	glm::vec3 color;
+
+	static VulkanVertexLayout GetLayout();
+};
+
+///////////////////////////////////////////
+//Per draw uniform data, matches the DrawConstants block in shader.vert (std140)
+struct DrawConstants {
+	glm::vec4 transform;
+	float depth;
+};
 
 ///////////////////////////////////////////
 class Application
 {
 public:
 
-	void Init(const int width, const int height, const char* appName);
+	void Init(const int width, const int height, const char* appName, const ApplicationSettings& settings = ApplicationSettings());
 
 	void Run();
 
+	//Draws a fixed amount of frames (or until the window is closed) and returns the elapsed time in seconds, renderedFrameCount is set to how many were drawn
+	double RunTimed(const uint32_t frameCount, uint32_t& renderedFrameCount);
+
+	//Warms up, records per frame CPU timings and writes the JSON report described by the benchmark settings
+	void RunBenchmark();
+
+	//Streams uploadBenchmarkMegabytes through the upload engine, including the graphics queue acquiring the data, and returns the bandwidth in MB/s
+	double RunUploadBenchmark();
+
 	void Cleanup();
 
+	//Per scope GPU timings of the frames recorded so far, for overlays and other tools
+	const VulkanGpuProfiler& GetGpuProfiler() const;
+	//Call whenever the scene changes, the static command buffers are rerecorded on their next use
+	void InvalidateStaticCommandBuffers();
+	//Average fragment shader invocations per frame across every measured pass, 0 without pipeline statistics
+	double GetFragmentsPerFrame() const;
+
 private:
 	//Helpers
-	static std::vector<char> ReadFile(const std::string& filename);
-
-	void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
-	VkShaderModule CreateShaderModule(const std::vector<char>& code);
+	//Prerecorded buffers are replayed for many frames, so they record no profiler queries and no secondaries tied to one frame slot
+	void RecordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex, bool bPrerecorded = false);
+	//Begins renderPass on the image's framebuffer and records the scene into it, wrapped in a profiler scope and statistics pass called name.
+	//bDepthOnly draws with the depth prepass pipelines, phase picks which culling results GPU driven rendering draws
+	void RecordScenePass(VkCommandBuffer commandBuffer, uint32_t imageIndex, VkRenderPass renderPass, const char* name, bool bPrerecorded, bool bDepthOnly, CullingPhase phase);
+	//Records draws [firstDraw, firstDraw + drawCount) of the draw list, called from worker threads when recording in parallel.
+	//Per frame recording writes the range's constants into the frame's uniform region, prerecorded buffers read the ones written once by WriteStaticDrawConstants().
+	//A valid pipelineOverride replaces every draw's own pipeline
+	void RecordDrawRange(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount, bool bPrerecorded, PipelineHandle pipelineOverride = INVALID_PIPELINE_HANDLE);
+	//Draws whatever the culling pass for phase recorded earlier in the command buffer left visible
+	void RecordIndirectDraws(VkCommandBuffer commandBuffer, CullingPhase phase, PipelineHandle pipeline);
+	//Secondary command buffers do not inherit dynamic state, so every range sets its own
+	void RecordViewportAndScissor(VkCommandBuffer commandBuffer);
 
 	//VK Objects
 	void CreateSurface();
+	void CreateOffscreenTarget();
+	//m_renderPass, plus the depth prepass and the late pass when they are enabled
 	void CreateRenderPass();
+	//A pass that clears is the first of the frame, a pass that presents the last. Passes in between keep color and depth in attachment layouts,
+	//and a pass that is not last leaves depth read only so compute can sample it. Every variant is compatible, so pipelines and framebuffers are shared
+	VkRenderPass BuildRenderPass(bool bFirstPass, bool bLastPass);
 	void CreateGraphicsPipeline();
+	//The single triangle, or the stress grid when stressTriangleCount is set. Uploaded through the upload engine and acquired by the first frame
+	void CreateSceneMesh();
+	//Perspective projection for the render target's aspect ratio, called again whenever the render target is resized
+	void UpdateProjection();
+	void BuildDrawList();
+	//Mirrors the draw list into the GPU culling object buffer
+	void UploadCullingObjects();
+	//One region per frame in flight plus one for the constants of static command buffers
+	void CreateUniformAllocator();
+	//Static command buffers are replayed by any frame slot, so their constants live in a region no frame rewinds
+	void WriteStaticDrawConstants();
+	//One depth image per render target image, along with the Hi-Z pyramid reading them when occlusion culling
+	void CreateDepthTarget();
 	void CreateFramebuffers();
-	void CreateCommandBuffer();
+	//Sets up the frame slots and their command allocator, one thread index for the primary plus one per parallel recording task
+	void CreateCommandBuffers();
+	//One per render target image, any previous set is freed once the GPU is done with it
+	void CreateStaticCommandBuffers();
+	//Returns the image's static command buffer, rerecording it first if it has been invalidated
+	VkCommandBuffer GetStaticCommandBuffer(uint32_t imageIndex);
 	void CreateCommandPool();
 	void CreateSyncObjects();
+	void CreatePresentSemaphores();
+	void CreateFragmentationTestBuffers();
+	//Random hierarchy of sceneNodeCount nodes and the host visible buffer it writes into, one region of sceneNodeCount matrices per frame in flight
+	void CreateSceneHierarchy();
+	//Moves sceneChangeRatio of the nodes and writes the changes into the current frame's region, the slot's previous frame has finished reading it
+	void UpdateSceneHierarchy();
+	//Flushes this frame's uploads, then records one command buffer that acquires them, runs the defragmenter's copies for the frame and initializes a new Hi-Z pyramid.
+	//Adds the transfer wait to waits, returns VK_NULL_HANDLE when there was nothing to record
+	VkCommandBuffer RecordFrameSetup(std::vector<TimelineWait>& waits);
+
+	//Builds a new swap chain from the old one, the old image views and framebuffers are retired through the timeline rather than waiting for the device to idle
+	void RecreateSwapChain();
+	//Destroys the retired swap chains covered by the acquire fence once it has signalled
+	void CollectRetiredPresentations();
+	void DestroyRetiredPresentations(std::vector<RetiredPresentation>& presentations);
+	static void FramebufferResizeCallback(GLFWwindow* pWindow, int width, int height);
 
 	void DrawFrame();
+	//Polls window events and draws one frame, timed by the frame recorder
+	void Tick();
+	void WriteBenchmarkReport(const std::string& path);
+
+	//Whatever we are rendering into, the swap chain or the offscreen target in headless mode
+	VkExtent2D GetRenderTargetExtents();
+	VkFormat GetRenderTargetFormat();
+	const std::vector<VkImageView>& GetRenderTargetImageViews();
+	bool ShouldClose();
 
 private:
 	//Application data
 	const char* m_pApplicationName;
 	int m_screenWidth;
 	int m_screenHeight;
+	ApplicationSettings m_settings;
 	//~Application data
 
 	//GLFW
 	GLFWwindow* m_pWindow = nullptr;
+	bool m_bFramebufferResized = false;
 	//~GLFW
 
 	//Abstracted Vulkan
 	VulkanInstance m_vulkanInstance;
 	VulkanDevice m_vulkanDevices;
 	VulkanSwapChain m_vulkanSwapchain;
+	VulkanTimeline m_graphicsTimeline;
+	VulkanOffscreenTarget m_offscreenTarget;
+	VulkanPipelineCache m_pipelineCache;
+	VulkanPipelineLibrary m_pipelineLibrary;
+	VulkanCommandAllocator m_commandAllocator;
+	VulkanUploadEngine m_uploadEngine;
+	VulkanDefragmenter m_defragmenter;
+	VulkanUniformAllocator m_uniformAllocator;
 	//~Abstracted Vulkan
 
+	//Threading
+	JobSystem m_jobSystem;
+	VulkanParallelRecorder m_parallelRecorder;
+	//~Threading
+
+	//Profiling
+	FrameRecorder m_frameRecorder;
+	VulkanGpuProfiler m_gpuProfiler;
+	VulkanPipelineStatistics m_pipelineStatistics;
+	double m_pipelineCreationMs = 0.0; //Time startup spent blocked on required pipelines, cold or warm depending on the pipeline cache
+	double m_uploadBandwidthMBps = 0.0; //Measured by RunUploadBenchmark(), 0 when it has not run
+	//~Profiling
+
 	//Raw Vulkan
 	VkRenderPass m_renderPass;
-	VkPipeline m_graphicsPipeline;
+	VkRenderPass m_latePassRenderPass = VK_NULL_HANDLE; //Draws what late occlusion culling found, loads what m_renderPass left
+	VkRenderPass m_depthPrepassRenderPass = VK_NULL_HANDLE; //Clears and fills depth before m_renderPass
+	PipelineHandle m_graphicsPipeline = INVALID_PIPELINE_HANDLE;
+	PipelineHandle m_depthPrepassPipeline = INVALID_PIPELINE_HANDLE; //No fragment shader and no color writes
 	VkPipelineLayout m_pipelineLayout;
+	//Set 0 is the culling pass's object buffer rather than the uniform allocator
+	PipelineHandle m_gpuDrivenPipeline = INVALID_PIPELINE_HANDLE;
+	PipelineHandle m_gpuDrivenPrepassPipeline = INVALID_PIPELINE_HANDLE;
+	//Objects found by late occlusion culling missed the prepass, so they are drawn with depth writes. The same pipeline as m_gpuDrivenPipeline without a prepass
+	PipelineHandle m_gpuDrivenLatePipeline = INVALID_PIPELINE_HANDLE;
+	VkPipelineLayout m_gpuDrivenPipelineLayout = VK_NULL_HANDLE;
+	VulkanGpuCulling m_gpuCulling;
+	VulkanDepthTarget m_depthTarget;
+	VkFormat m_depthFormat = VK_FORMAT_UNDEFINED; //Chosen before the render passes, which need it before the depth images exist
+	VulkanHiZPyramid m_hiZPyramid;
+	bool m_bHiZPyramidNeedsInitialize = false; //Set whenever the pyramid is recreated, its contents are undefined until the next frame setup clears them
 
-	VkSurfaceKHR m_surface;
+	VkSurfaceKHR m_surface = VK_NULL_HANDLE;
 
 	std::vector<VkFramebuffer> m_swapchainFramebuffers;
 
-	//Manages the memory that is used to store the buffers and command buffers allocated from them
+	//Long lived command buffers that are rerecorded individually, the per frame ones come from m_commandAllocator
 	VkCommandPool m_commandPool;
 
-	VkCommandBuffer m_commandBuffer;
+	VulkanMesh m_sceneMesh;
+	glm::vec4 m_sceneMeshBounds = glm::vec4(0.0f); //Bounding sphere of m_sceneMesh, xyz centre and w radius
+	glm::mat4 m_projection = glm::mat4(1.0f); //The camera sits at the origin of view space looking down -z, pushed to the vertex shaders
+	std::vector<DrawItem> m_drawList;
+	uint32_t m_staticConstantsOffset = UINT32_MAX; //Dynamic offset of the draw list's constants in the static region, UINT32_MAX until written
+
+	TransformHierarchy m_sceneHierarchy;
+	VulkanBuffer m_sceneTransformBuffer;
+	std::mt19937 m_sceneRandom;
+
+	std::vector<VulkanBuffer> m_fragmentationTestBuffers; //Never resized once registered with the defragmenter
+
+	std::vector<StaticCommandBuffer> m_staticCommandBuffers; //Indexed by render target image
+
+	std::vector<FrameContext> m_frames;
+	uint32_t m_currentFrame = 0;
+
+	//One per swap chain image rather than per slot. The present waits on it and nothing tells us when that wait is done,
+	//but the image cannot be acquired again before its present has finished, so the semaphore is free by the time the image comes back
+	std::vector<VkSemaphore> m_renderFinishedSemaphores;
 
-	VkSemaphore m_imageAvailableSemaphore;
-	VkSemaphore m_renderFinishedSemaphore;
-	VkFence m_inFlightFence;
+	//Swap chains waiting for the next acquire to be fenced, and those waiting on m_acquireFence and the frame that used that acquire (m_acquireFenceValue)
+	std::vector<RetiredPresentation> m_retiredPresentations;
+	std::vector<RetiredPresentation> m_fencedPresentations;
+	VkFence m_acquireFence = VK_NULL_HANDLE;
+	uint64_t m_acquireFenceValue = 0;
 	//~Vulkan
 };
 
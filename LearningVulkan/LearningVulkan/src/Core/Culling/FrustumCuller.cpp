@@ -0,0 +1,215 @@
+#include "FrustumCuller.h"
+
+#include <glm/simd/common.h>
+
+#include <cfloat>
+
+///////////////////////////////////////////
+//Widest batch any path reads, the arrays are always padded to a multiple of it
+constexpr size_t CULLING_BATCH_SIZE = 8;
+
+///////////////////////////////////////////
+void FrustumCuller::Reserve(size_t objectCount)
+{
+	size_t paddedCount = (objectCount + CULLING_BATCH_SIZE - 1) / CULLING_BATCH_SIZE * CULLING_BATCH_SIZE;
+	m_centreX.reserve(paddedCount);
+	m_centreY.reserve(paddedCount);
+	m_centreZ.reserve(paddedCount);
+	m_radius.reserve(paddedCount);
+}
+
+///////////////////////////////////////////
+void FrustumCuller::Clear()
+{
+	m_centreX.clear();
+	m_centreY.clear();
+	m_centreZ.clear();
+	m_radius.clear();
+	m_objectCount = 0;
+}
+
+///////////////////////////////////////////
+uint32_t FrustumCuller::AddSphere(const glm::vec3& centre, float radius)
+{
+	//A new batch is padded with spheres of radius -FLT_MAX, which every plane rejects
+	if (m_objectCount == m_radius.size()) {
+		size_t paddedCount = m_objectCount + CULLING_BATCH_SIZE;
+		m_centreX.resize(paddedCount, 0.0f);
+		m_centreY.resize(paddedCount, 0.0f);
+		m_centreZ.resize(paddedCount, 0.0f);
+		m_radius.resize(paddedCount, -FLT_MAX);
+	}
+
+	uint32_t index = static_cast<uint32_t>(m_objectCount++);
+	SetSphere(index, centre, radius);
+	return index;
+}
+
+///////////////////////////////////////////
+void FrustumCuller::SetSphere(uint32_t index, const glm::vec3& centre, float radius)
+{
+	m_centreX[index] = centre.x;
+	m_centreY[index] = centre.y;
+	m_centreZ[index] = centre.z;
+	m_radius[index] = radius;
+}
+
+///////////////////////////////////////////
+size_t FrustumCuller::GetObjectCount() const
+{
+	return m_objectCount;
+}
+
+///////////////////////////////////////////
+size_t FrustumCuller::CullScalar(const FrustumPlanes& planes, std::vector<uint32_t>& visibleIndices) const
+{
+	visibleIndices.clear();
+
+	for (size_t i = 0; i < m_objectCount; ++i) {
+		bool bVisible = true;
+		for (const glm::vec4& plane : planes) {
+			//Same order of operations as the SIMD path, so both agree on spheres exactly touching a plane
+			float distance = plane.x * m_centreX[i] + plane.w;
+			distance = plane.y * m_centreY[i] + distance;
+			distance = plane.z * m_centreZ[i] + distance;
+			if (distance < -m_radius[i]) {
+				bVisible = false;
+				break;
+			}
+		}
+
+		if (bVisible) {
+			visibleIndices.push_back(static_cast<uint32_t>(i));
+		}
+	}
+
+	return visibleIndices.size();
+}
+
+///////////////////////////////////////////
+size_t FrustumCuller::Cull(const FrustumPlanes& planes, std::vector<uint32_t>& visibleIndices) const
+{
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+	//Every object in the batch is written, and the count only advances past the visible ones, so compaction needs no branches
+	visibleIndices.resize(m_radius.size());
+	uint32_t* pVisible = visibleIndices.data();
+	size_t visibleCount = 0;
+
+#	if GLM_ARCH & GLM_ARCH_AVX_BIT
+	__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (size_t p = 0; p < planes.size(); ++p) {
+		planeX[p] = _mm256_set1_ps(planes[p].x);
+		planeY[p] = _mm256_set1_ps(planes[p].y);
+		planeZ[p] = _mm256_set1_ps(planes[p].z);
+		planeW[p] = _mm256_set1_ps(planes[p].w);
+	}
+
+	for (size_t i = 0; i < m_objectCount; i += 8) {
+		__m256 centreX = _mm256_loadu_ps(&m_centreX[i]);
+		__m256 centreY = _mm256_loadu_ps(&m_centreY[i]);
+		__m256 centreZ = _mm256_loadu_ps(&m_centreZ[i]);
+		__m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&m_radius[i]));
+
+		//Lanes stay set while the sphere is in front of, or crossing, every plane
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (size_t p = 0; p < planes.size(); ++p) {
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(planeX[p], centreX), planeW[p]);
+			distance = _mm256_add_ps(_mm256_mul_ps(planeY[p], centreY), distance);
+			distance = _mm256_add_ps(_mm256_mul_ps(planeZ[p], centreZ), distance);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+		}
+
+		int mask = _mm256_movemask_ps(inside);
+		for (uint32_t lane = 0; lane < 8; ++lane) {
+			pVisible[visibleCount] = static_cast<uint32_t>(i) + lane;
+			visibleCount += (mask >> lane) & 1;
+		}
+	}
+#	else
+	glm_vec4 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (size_t p = 0; p < planes.size(); ++p) {
+		planeX[p] = _mm_set1_ps(planes[p].x);
+		planeY[p] = _mm_set1_ps(planes[p].y);
+		planeZ[p] = _mm_set1_ps(planes[p].z);
+		planeW[p] = _mm_set1_ps(planes[p].w);
+	}
+
+	for (size_t i = 0; i < m_objectCount; i += 4) {
+		glm_vec4 centreX = _mm_loadu_ps(&m_centreX[i]);
+		glm_vec4 centreY = _mm_loadu_ps(&m_centreY[i]);
+		glm_vec4 centreZ = _mm_loadu_ps(&m_centreZ[i]);
+		glm_vec4 negativeRadius = glm_vec4_sub(_mm_setzero_ps(), _mm_loadu_ps(&m_radius[i]));
+
+		//Lanes stay set while the sphere is in front of, or crossing, every plane
+		glm_vec4 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (size_t p = 0; p < planes.size(); ++p) {
+			glm_vec4 distance = glm_vec4_fma(planeX[p], centreX, planeW[p]);
+			distance = glm_vec4_fma(planeY[p], centreY, distance);
+			distance = glm_vec4_fma(planeZ[p], centreZ, distance);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for (uint32_t lane = 0; lane < 4; ++lane) {
+			pVisible[visibleCount] = static_cast<uint32_t>(i) + lane;
+			visibleCount += (mask >> lane) & 1;
+		}
+	}
+#	endif
+
+	visibleIndices.resize(visibleCount);
+	return visibleCount;
+#else
+	return CullScalar(planes, visibleIndices);
+#endif
+}
+
+///////////////////////////////////////////
+uint32_t FrustumCuller::GetSimdWidth()
+{
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+	return 8;
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+	return 4;
+#else
+	return 1;
+#endif
+}
+
+///////////////////////////////////////////
+const char* FrustumCuller::GetSimdName()
+{
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+	return "AVX2";
+#elif GLM_ARCH & GLM_ARCH_AVX_BIT
+	return "AVX";
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+	return "SSE2";
+#else
+	return "Scalar";
+#endif
+}
+
+///////////////////////////////////////////
+FrustumPlanes FrustumCuller::ExtractFrustumPlanes(const glm::mat4& viewProjection)
+{
+	//Gribb/Hartmann, glm is column major so row i is m[0][i], m[1][i], m[2][i], m[3][i]
+	auto row = [&viewProjection](int i) {
+		return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	};
+
+	FrustumPlanes planes = {
+		row(3) + row(0), //Left
+		row(3) - row(0), //Right
+		row(3) + row(1), //Top, Vulkan's y points down
+		row(3) - row(1), //Bottom
+		row(2),          //Near, depth starts at 0 rather than -1
+		row(3) - row(2)  //Far
+	};
+
+	for (auto& plane : planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	return planes;
+}
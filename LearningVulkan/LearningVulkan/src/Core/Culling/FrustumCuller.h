@@ -0,0 +1,45 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <array>
+#include <vector>
+
+///////////////////////////////////////////
+//Six normalised planes pointing into the frustum: left, right, top, bottom, near, far
+typedef std::array<glm::vec4, 6> FrustumPlanes;
+
+///////////////////////////////////////////
+//Tests bounding spheres against a frustum on the CPU. Spheres are kept as structure of arrays so a SIMD register loads the same member of 4 (SSE) or 8 (AVX2) consecutive objects,
+//and each plane test is a handful of multiply adds for the whole batch. Survivors are written as a compact list of object indices.
+//The SIMD width is chosen at compile time from glm's GLM_ARCH, building with /arch:AVX2 (or -mavx2) enables the 8 wide path
+class FrustumCuller
+{
+public:
+	void Reserve(size_t objectCount);
+	void Clear();
+
+	//Returns the object's index, which is what ends up in the visible list
+	uint32_t AddSphere(const glm::vec3& centre, float radius);
+	void SetSphere(uint32_t index, const glm::vec3& centre, float radius);
+	size_t GetObjectCount() const;
+
+	//Replaces the contents of visibleIndices with the objects at least partly inside the frustum, in ascending order. Returns how many there are
+	size_t Cull(const FrustumPlanes& planes, std::vector<uint32_t>& visibleIndices) const;
+	//One object at a time, the reference the SIMD path is measured and checked against
+	size_t CullScalar(const FrustumPlanes& planes, std::vector<uint32_t>& visibleIndices) const;
+
+	//Objects tested per instruction by Cull(), 1 when glm has no SIMD backend for this build
+	static uint32_t GetSimdWidth();
+	static const char* GetSimdName();
+
+	//Planes of a Vulkan style (0 to 1 depth) view projection matrix, the identity gives the clip space volume
+	static FrustumPlanes ExtractFrustumPlanes(const glm::mat4& viewProjection);
+
+private:
+	//Padded up to a multiple of the widest SIMD batch with spheres that fail every test, so batches never need a scalar tail
+	std::vector<float> m_centreX;
+	std::vector<float> m_centreY;
+	std::vector<float> m_centreZ;
+	std::vector<float> m_radius;
+	size_t m_objectCount = 0;
+};
@@ -0,0 +1,153 @@
+#include "FrameRecorder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+///////////////////////////////////////////
+void FrameRecorder::SetRecording(bool bRecording)
+{
+	m_bRecording = bRecording;
+}
+
+///////////////////////////////////////////
+bool FrameRecorder::IsRecording() const
+{
+	return m_bRecording;
+}
+
+///////////////////////////////////////////
+void FrameRecorder::Clear()
+{
+	m_samples.clear();
+}
+
+///////////////////////////////////////////
+void FrameRecorder::BeginFrame()
+{
+	m_currentFrame = FrameSample();
+	m_frameStart = Clock::now();
+}
+
+///////////////////////////////////////////
+void FrameRecorder::EndFrame()
+{
+	if (!m_bRecording) {
+		return;
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = Clock::now() - m_frameStart;
+	m_currentFrame.frameMs = elapsed.count();
+	m_samples.push_back(m_currentFrame);
+}
+
+///////////////////////////////////////////
+void FrameRecorder::BeginPhase(FramePhase phase)
+{
+	m_phaseStarts[static_cast<size_t>(phase)] = Clock::now();
+}
+
+///////////////////////////////////////////
+void FrameRecorder::EndPhase(FramePhase phase)
+{
+	//Accumulated as a phase can run more than once a frame (e.g. submitting uploads and then the frame)
+	std::chrono::duration<double, std::milli> elapsed = Clock::now() - m_phaseStarts[static_cast<size_t>(phase)];
+	m_currentFrame.phaseMs[static_cast<size_t>(phase)] += elapsed.count();
+}
+
+///////////////////////////////////////////
+size_t FrameRecorder::GetSampleCount() const
+{
+	return m_samples.size();
+}
+
+///////////////////////////////////////////
+FrameStatistics FrameRecorder::GetFrameStatistics() const
+{
+	std::vector<double> values;
+	values.reserve(m_samples.size());
+	for (const auto& sample : m_samples) {
+		values.push_back(sample.frameMs);
+	}
+
+	return ComputeStatistics(std::move(values));
+}
+
+///////////////////////////////////////////
+FrameStatistics FrameRecorder::GetPhaseStatistics(FramePhase phase) const
+{
+	std::vector<double> values;
+	values.reserve(m_samples.size());
+	for (const auto& sample : m_samples) {
+		values.push_back(sample.phaseMs[static_cast<size_t>(phase)]);
+	}
+
+	return ComputeStatistics(std::move(values));
+}
+
+///////////////////////////////////////////
+void FrameRecorder::WriteJson(JsonWriter& writer) const
+{
+	auto writeStatistics = [&writer](const FrameStatistics& stats) {
+		writer.Write("mean", stats.mean);
+		writer.Write("min", stats.min);
+		writer.Write("max", stats.max);
+		writer.Write("p50", stats.p50);
+		writer.Write("p95", stats.p95);
+		writer.Write("p99", stats.p99);
+	};
+
+	writer.Write("sampleCount", static_cast<uint64_t>(m_samples.size()));
+
+	writer.BeginObject("frameTimeMs");
+	writeStatistics(GetFrameStatistics());
+	writer.EndObject();
+
+	writer.BeginObject("phasesMs");
+	for (size_t i = 0; i < static_cast<size_t>(FramePhase::Count); ++i) {
+		FramePhase phase = static_cast<FramePhase>(i);
+		writer.BeginObject(GetPhaseName(phase));
+		writeStatistics(GetPhaseStatistics(phase));
+		writer.EndObject();
+	}
+	writer.EndObject();
+}
+
+///////////////////////////////////////////
+const char* FrameRecorder::GetPhaseName(FramePhase phase)
+{
+	switch (phase) {
+	case FramePhase::Wait: return "fenceWait";
+	case FramePhase::Acquire: return "acquire";
+	case FramePhase::Record: return "record";
+	case FramePhase::Submit: return "submit";
+	case FramePhase::Present: return "present";
+	default: return "unknown";
+	}
+}
+
+///////////////////////////////////////////
+FrameStatistics FrameRecorder::ComputeStatistics(std::vector<double> values)
+{
+	FrameStatistics stats;
+	if (values.empty()) {
+		return stats;
+	}
+
+	std::sort(values.begin(), values.end());
+
+	//Nearest rank percentile
+	auto percentile = [&values](double p) {
+		size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+		return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+	};
+
+	stats.mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+	stats.min = values.front();
+	stats.max = values.back();
+	stats.p50 = percentile(0.50);
+	stats.p95 = percentile(0.95);
+	stats.p99 = percentile(0.99);
+
+	return stats;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "JsonWriter.h"
+
+#include <array>
+#include <chrono>
+#include <vector>
+
+///////////////////////////////////////////
+//The parts of DrawFrame that are timed individually
+enum class FramePhase {
+	Wait,		//Waiting for the ring slot's previous frame to finish on the GPU
+	Acquire,	//vkAcquireNextImageKHR
+	Record,		//Recording the frame's command buffers
+	Submit,		//vkQueueSubmit
+	Present,	//vkQueuePresentKHR
+	Count
+};
+
+///////////////////////////////////////////
+struct FrameStatistics {
+	double mean = 0.0;
+	double min = 0.0;
+	double max = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+};
+
+///////////////////////////////////////////
+//Records CPU frame times, and the time spent in each FramePhase, while recording is enabled
+class FrameRecorder
+{
+public:
+	void SetRecording(bool bRecording);
+	bool IsRecording() const;
+	void Clear();
+
+	void BeginFrame();
+	void EndFrame();
+
+	void BeginPhase(FramePhase phase);
+	void EndPhase(FramePhase phase);
+
+	size_t GetSampleCount() const;
+	FrameStatistics GetFrameStatistics() const;
+	FrameStatistics GetPhaseStatistics(FramePhase phase) const;
+
+	//Writes "frameTime" and "phases" objects (all in milliseconds) into the object the writer currently has open
+	void WriteJson(JsonWriter& writer) const;
+
+	static const char* GetPhaseName(FramePhase phase);
+	static FrameStatistics ComputeStatistics(std::vector<double> values);
+
+private:
+	using Clock = std::chrono::high_resolution_clock;
+
+	struct FrameSample {
+		double frameMs = 0.0;
+		std::array<double, static_cast<size_t>(FramePhase::Count)> phaseMs{};
+	};
+
+	bool m_bRecording = false;
+
+	Clock::time_point m_frameStart;
+	std::array<Clock::time_point, static_cast<size_t>(FramePhase::Count)> m_phaseStarts;
+	FrameSample m_currentFrame;
+
+	std::vector<FrameSample> m_samples;
+};
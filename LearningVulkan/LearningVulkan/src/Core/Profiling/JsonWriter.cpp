@@ -0,0 +1,176 @@
+#include "JsonWriter.h"
+
+#include <cmath>
+
+///////////////////////////////////////////
+JsonWriter::JsonWriter(std::ostream& stream) : m_stream(stream)
+{
+}
+
+///////////////////////////////////////////
+void JsonWriter::BeginObject()
+{
+	BeginValue(nullptr);
+	m_stream << "{";
+	m_scopeHasValues.push_back(false);
+}
+
+///////////////////////////////////////////
+void JsonWriter::BeginObject(const std::string& key)
+{
+	BeginValue(&key);
+	m_stream << "{";
+	m_scopeHasValues.push_back(false);
+}
+
+///////////////////////////////////////////
+void JsonWriter::EndObject()
+{
+	bool bHadValues = m_scopeHasValues.back();
+	m_scopeHasValues.pop_back();
+
+	if (bHadValues) {
+		m_stream << "\n";
+		Indent();
+	}
+	m_stream << "}";
+
+	if (m_scopeHasValues.empty()) {
+		m_stream << "\n";
+	}
+}
+
+///////////////////////////////////////////
+void JsonWriter::BeginArray()
+{
+	BeginValue(nullptr);
+	m_stream << "[";
+	m_scopeHasValues.push_back(false);
+}
+
+///////////////////////////////////////////
+void JsonWriter::BeginArray(const std::string& key)
+{
+	BeginValue(&key);
+	m_stream << "[";
+	m_scopeHasValues.push_back(false);
+}
+
+///////////////////////////////////////////
+void JsonWriter::EndArray()
+{
+	bool bHadValues = m_scopeHasValues.back();
+	m_scopeHasValues.pop_back();
+
+	if (bHadValues) {
+		m_stream << "\n";
+		Indent();
+	}
+	m_stream << "]";
+}
+
+///////////////////////////////////////////
+void JsonWriter::Write(const std::string& key, double value)
+{
+	BeginValue(&key);
+	//JSON has no representation for NaN or infinity
+	if (std::isfinite(value)) {
+		m_stream << value;
+	}
+	else {
+		m_stream << "null";
+	}
+}
+
+///////////////////////////////////////////
+void JsonWriter::Write(const std::string& key, uint64_t value)
+{
+	BeginValue(&key);
+	m_stream << value;
+}
+
+///////////////////////////////////////////
+void JsonWriter::Write(const std::string& key, uint32_t value)
+{
+	BeginValue(&key);
+	m_stream << value;
+}
+
+///////////////////////////////////////////
+void JsonWriter::Write(const std::string& key, bool value)
+{
+	BeginValue(&key);
+	m_stream << (value ? "true" : "false");
+}
+
+///////////////////////////////////////////
+void JsonWriter::Write(const std::string& key, const std::string& value)
+{
+	BeginValue(&key);
+	m_stream << "\"" << Escape(value) << "\"";
+}
+
+///////////////////////////////////////////
+void JsonWriter::Write(const std::string& key, const char* value)
+{
+	Write(key, std::string(value));
+}
+
+///////////////////////////////////////////
+void JsonWriter::Write(double value)
+{
+	BeginValue(nullptr);
+	if (std::isfinite(value)) {
+		m_stream << value;
+	}
+	else {
+		m_stream << "null";
+	}
+}
+
+///////////////////////////////////////////
+void JsonWriter::BeginValue(const std::string* pKey)
+{
+	if (m_scopeHasValues.empty()) {
+		return;
+	}
+
+	if (m_scopeHasValues.back()) {
+		m_stream << ",";
+	}
+	m_scopeHasValues.back() = true;
+
+	m_stream << "\n";
+	Indent();
+
+	if (pKey) {
+		m_stream << "\"" << Escape(*pKey) << "\": ";
+	}
+}
+
+///////////////////////////////////////////
+void JsonWriter::Indent()
+{
+	for (size_t i = 0; i < m_scopeHasValues.size(); ++i) {
+		m_stream << "\t";
+	}
+}
+
+///////////////////////////////////////////
+std::string JsonWriter::Escape(const std::string& text)
+{
+	std::string escaped;
+	escaped.reserve(text.size());
+
+	for (char c : text) {
+		switch (c) {
+		case '"': escaped += "\\\""; break;
+		case '\\': escaped += "\\\\"; break;
+		case '\n': escaped += "\\n"; break;
+		case '\t': escaped += "\\t"; break;
+		default: escaped += c; break;
+		}
+	}
+
+	return escaped;
+}
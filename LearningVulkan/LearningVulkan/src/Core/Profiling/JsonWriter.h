@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////
+//Minimal streaming JSON writer used for benchmark reports. Keeps track of commas and indentation so callers only describe the structure
+class JsonWriter
+{
+public:
+	JsonWriter(std::ostream& stream);
+
+	void BeginObject();
+	void BeginObject(const std::string& key);
+	void EndObject();
+
+	void BeginArray();
+	void BeginArray(const std::string& key);
+	void EndArray();
+
+	void Write(const std::string& key, double value);
+	void Write(const std::string& key, uint64_t value);
+	void Write(const std::string& key, uint32_t value);
+	void Write(const std::string& key, bool value);
+	void Write(const std::string& key, const std::string& value);
+	void Write(const std::string& key, const char* value);
+
+	//Array elements
+	void Write(double value);
+
+private:
+	void BeginValue(const std::string* pKey);
+	void Indent();
+	static std::string Escape(const std::string& text);
+
+private:
+	std::ostream& m_stream;
+
+	//One entry per open object/array, true once it has had its first value written
+	std::vector<bool> m_scopeHasValues;
+};
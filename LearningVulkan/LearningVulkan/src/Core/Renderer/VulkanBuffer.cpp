@@ -0,0 +1,84 @@
+#include "VulkanBuffer.h"
+
+#include <stdexcept>
+#include <utility>
+
+///////////////////////////////////////////
+void VulkanBuffer::InitBuffer(VulkanDevice* pDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties)
+{
+	m_pDevice = pDevice;
+	m_size = size;
+	m_usage = usage;
+	m_memoryProperties = memoryProperties;
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	//Buffers shared with the transfer or compute queue change hands through VulkanQueueOwnership
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(pDevice->GetLogicalDevice(), &bufferInfo, nullptr, &m_buffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create buffer!");
+	}
+
+	//Host visible memory comes back already mapped, the allocator maps each block once
+	m_allocation = pDevice->GetMemoryAllocator().AllocateForBuffer(m_buffer, memoryProperties);
+}
+
+///////////////////////////////////////////
+void VulkanBuffer::DestroyBuffer()
+{
+	if (m_buffer == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vkDestroyBuffer(m_pDevice->GetLogicalDevice(), m_buffer, nullptr);
+	m_pDevice->GetMemoryAllocator().Free(m_allocation);
+
+	m_buffer = VK_NULL_HANDLE;
+	m_size = 0;
+}
+
+///////////////////////////////////////////
+VkBuffer VulkanBuffer::GetBuffer() const
+{
+	return m_buffer;
+}
+
+///////////////////////////////////////////
+VkDeviceSize VulkanBuffer::GetSize() const
+{
+	return m_size;
+}
+
+///////////////////////////////////////////
+void* VulkanBuffer::GetMappedData() const
+{
+	return m_allocation.pMappedData;
+}
+
+///////////////////////////////////////////
+VkBufferUsageFlags VulkanBuffer::GetUsage() const
+{
+	return m_usage;
+}
+
+///////////////////////////////////////////
+VkMemoryPropertyFlags VulkanBuffer::GetMemoryProperties() const
+{
+	return m_memoryProperties;
+}
+
+///////////////////////////////////////////
+const MemoryAllocation& VulkanBuffer::GetAllocation() const
+{
+	return m_allocation;
+}
+
+///////////////////////////////////////////
+void VulkanBuffer::SwapStorage(VkBuffer& buffer, MemoryAllocation& allocation)
+{
+	std::swap(m_buffer, buffer);
+	std::swap(m_allocation, allocation);
+}
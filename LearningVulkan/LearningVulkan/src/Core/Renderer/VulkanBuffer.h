@@ -0,0 +1,34 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+
+///////////////////////////////////////////
+//A VkBuffer sub-allocated from the device's memory allocator. Host visible buffers are mapped for as long as they exist
+class VulkanBuffer
+{
+public:
+	void InitBuffer(VulkanDevice* pDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties);
+	void DestroyBuffer();
+
+	VkBuffer GetBuffer() const;
+	VkDeviceSize GetSize() const;
+	//nullptr unless the memory is host visible
+	void* GetMappedData() const;
+	VkBufferUsageFlags GetUsage() const;
+	VkMemoryPropertyFlags GetMemoryProperties() const;
+	const MemoryAllocation& GetAllocation() const;
+
+	//Points the buffer at a copy of its contents in other memory, buffer and allocation are given the old storage back for the caller to destroy once the GPU is done with it
+	void SwapStorage(VkBuffer& buffer, MemoryAllocation& allocation);
+
+private:
+	VulkanDevice* m_pDevice = nullptr;
+	VkBuffer m_buffer = VK_NULL_HANDLE;
+	MemoryAllocation m_allocation;
+	VkDeviceSize m_size = 0;
+	VkBufferUsageFlags m_usage = 0;
+	VkMemoryPropertyFlags m_memoryProperties = 0;
+};
@@ -0,0 +1,98 @@
+#include "VulkanCommandAllocator.h"
+
+#include <stdexcept>
+
+///////////////////////////////////////////
+void VulkanCommandAllocator::InitCommandAllocator(VulkanDevice* pDevices, uint32_t frameCount, uint32_t threadCount)
+{
+	m_logicalDevice = pDevices->GetLogicalDevice();
+	m_threadCount = threadCount;
+
+	QueueFamilyIndices queueFamilyIndices = pDevices->FindQueueFamiliesForPhysicalDevice();
+
+	m_frames.resize(frameCount);
+	for (auto& frame : m_frames) {
+		frame.resize(m_threadCount);
+		for (auto& threadPool : frame) {
+			VkCommandPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; //No RESET_COMMAND_BUFFER_BIT, buffers are only ever reset together with their pool
+			poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+			if (vkCreateCommandPool(m_logicalDevice, &poolInfo, nullptr, &threadPool.commandPool) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create frame command pool!");
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////
+void VulkanCommandAllocator::DestroyCommandAllocator()
+{
+	//Destroying a pool frees every buffer allocated from it
+	for (auto& frame : m_frames) {
+		for (auto& threadPool : frame) {
+			vkDestroyCommandPool(m_logicalDevice, threadPool.commandPool, nullptr);
+		}
+	}
+	m_frames.clear();
+}
+
+///////////////////////////////////////////
+void VulkanCommandAllocator::BeginFrame(uint32_t frameIndex)
+{
+	m_currentFrame = frameIndex;
+
+	for (auto& threadPool : m_frames[frameIndex]) {
+		vkResetCommandPool(m_logicalDevice, threadPool.commandPool, 0);
+		threadPool.primaries.nextFree = 0;
+		threadPool.secondaries.nextFree = 0;
+	}
+}
+
+///////////////////////////////////////////
+VkCommandBuffer VulkanCommandAllocator::Allocate(uint32_t threadIndex, VkCommandBufferLevel level)
+{
+	ThreadCommandPool& threadPool = m_frames[m_currentFrame][threadIndex];
+	CommandBufferList& list = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? threadPool.primaries : threadPool.secondaries;
+
+	//Buffers from earlier frames were reset along with the pool and can be recorded again straight away
+	if (list.nextFree < list.commandBuffers.size()) {
+		m_reusedCount.fetch_add(1, std::memory_order_relaxed);
+		return list.commandBuffers[list.nextFree++];
+	}
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = threadPool.commandPool;
+	allocInfo.level = level;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to Allocate Command Buffer");
+	}
+
+	m_allocatedCount.fetch_add(1, std::memory_order_relaxed);
+	list.commandBuffers.push_back(commandBuffer);
+	list.nextFree++;
+	return commandBuffer;
+}
+
+///////////////////////////////////////////
+uint32_t VulkanCommandAllocator::GetThreadCount() const
+{
+	return m_threadCount;
+}
+
+///////////////////////////////////////////
+uint64_t VulkanCommandAllocator::GetAllocatedCount() const
+{
+	return m_allocatedCount.load(std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////
+uint64_t VulkanCommandAllocator::GetReusedCount() const
+{
+	return m_reusedCount.load(std::memory_order_relaxed);
+}
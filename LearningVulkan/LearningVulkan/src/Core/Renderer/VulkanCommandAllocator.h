@@ -0,0 +1,53 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+
+#include <atomic>
+#include <vector>
+
+///////////////////////////////////////////
+//Hands out command buffers that live for a single frame. Every frame slot has one transient pool per recording thread,
+//the whole pool is reset with vkResetCommandPool once the slot's frame has finished and its buffers are handed out again in order.
+class VulkanCommandAllocator
+{
+public:
+	void InitCommandAllocator(VulkanDevice* pDevices, uint32_t frameCount, uint32_t threadCount);
+	void DestroyCommandAllocator();
+
+	//Call once the GPU has finished the frame that last used frameIndex
+	void BeginFrame(uint32_t frameIndex);
+
+	//Command pools are externally synchronised, so two threads may only allocate at the same time with different thread indices.
+	//The buffer is only valid until the slot's next BeginFrame
+	VkCommandBuffer Allocate(uint32_t threadIndex, VkCommandBufferLevel level);
+
+	uint32_t GetThreadCount() const;
+	//Buffers created with vkAllocateCommandBuffers vs handed out again after a pool reset, in steady state only the second should grow
+	uint64_t GetAllocatedCount() const;
+	uint64_t GetReusedCount() const;
+
+private:
+	struct CommandBufferList {
+		std::vector<VkCommandBuffer> commandBuffers;
+		size_t nextFree = 0;
+	};
+
+	struct ThreadCommandPool {
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		CommandBufferList primaries;
+		CommandBufferList secondaries;
+	};
+
+private:
+	VkDevice m_logicalDevice = VK_NULL_HANDLE;
+	uint32_t m_threadCount = 0;
+
+	std::vector<std::vector<ThreadCommandPool>> m_frames; //[frame in flight][thread]
+	uint32_t m_currentFrame = 0;
+
+	std::atomic<uint64_t> m_allocatedCount{ 0 };
+	std::atomic<uint64_t> m_reusedCount{ 0 };
+};
@@ -0,0 +1,238 @@
+#include "VulkanDefragmenter.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+
+///////////////////////////////////////////
+void VulkanDefragmenter::InitDefragmenter(VulkanDevice* pDevice, VulkanTimeline* pGraphicsTimeline, VkDeviceSize maxBytesPerFrame)
+{
+	m_pDevice = pDevice;
+	m_pGraphicsTimeline = pGraphicsTimeline;
+	m_maxBytesPerFrame = maxBytesPerFrame;
+	m_statistics = DefragmentationStatistics();
+}
+
+///////////////////////////////////////////
+void VulkanDefragmenter::DestroyDefragmenter()
+{
+	VkDevice logicalDevice = m_pDevice->GetLogicalDevice();
+	for (auto& move : m_pendingMoves) {
+		vkDestroyBuffer(logicalDevice, move.newBuffer, nullptr);
+		m_pDevice->GetMemoryAllocator().Free(move.newAllocation);
+	}
+
+	m_pendingMoves.clear();
+	m_buffers.clear();
+}
+
+///////////////////////////////////////////
+void VulkanDefragmenter::RegisterBuffer(VulkanBuffer* pBuffer)
+{
+	const VkBufferUsageFlags requiredUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	if ((pBuffer->GetUsage() & requiredUsage) != requiredUsage) {
+		throw std::runtime_error("Buffers registered for defragmentation need transfer source and destination usage!");
+	}
+
+	m_buffers.push_back(pBuffer);
+}
+
+///////////////////////////////////////////
+void VulkanDefragmenter::UnregisterBuffer(VulkanBuffer* pBuffer)
+{
+	m_buffers.erase(std::remove(m_buffers.begin(), m_buffers.end(), pBuffer), m_buffers.end());
+
+	//The copy may still be running, so the storage it writes to lives until the GPU has passed it
+	for (auto it = m_pendingMoves.begin(); it != m_pendingMoves.end();) {
+		if (it->pBuffer == pBuffer) {
+			RetireMove(*it, std::max(it->timelineValue, m_pGraphicsTimeline->GetLastSubmittedValue()));
+			it = m_pendingMoves.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+///////////////////////////////////////////
+uint32_t VulkanDefragmenter::CompleteMoves()
+{
+	uint32_t swapped = 0;
+
+	for (auto it = m_pendingMoves.begin(); it != m_pendingMoves.end();) {
+		if (it->timelineValue == 0 || !m_pGraphicsTimeline->IsValueComplete(it->timelineValue)) {
+			++it;
+			continue;
+		}
+
+		//After the swap the move holds the old storage, which frames already submitted may still be reading through the old handle
+		it->pBuffer->SwapStorage(it->newBuffer, it->newAllocation);
+		RetireMove(*it, m_pGraphicsTimeline->GetLastSubmittedValue());
+
+		it = m_pendingMoves.erase(it);
+		swapped++;
+	}
+
+	return swapped;
+}
+
+///////////////////////////////////////////
+uint32_t VulkanDefragmenter::PlanMoves()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	VulkanMemoryAllocator& allocator = m_pDevice->GetMemoryAllocator();
+	VkDevice logicalDevice = m_pDevice->GetLogicalDevice();
+
+	//Draining the sparsest blocks first is what lets whole blocks be freed
+	std::vector<std::pair<double, VulkanBuffer*>> candidates;
+	if (m_maxBytesPerFrame > 0) {
+		for (VulkanBuffer* pBuffer : m_buffers) {
+			double blockUsage = allocator.GetBlockUsage(pBuffer->GetAllocation());
+			if (blockUsage < 1.0 && !IsMoving(pBuffer)) {
+				candidates.push_back(std::make_pair(blockUsage, pBuffer));
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const std::pair<double, VulkanBuffer*>& a, const std::pair<double, VulkanBuffer*>& b) { return a.first < b.first; });
+	}
+
+	uint32_t plannedCount = 0;
+	VkDeviceSize budget = m_maxBytesPerFrame;
+	for (const auto& candidate : candidates) {
+		VulkanBuffer* pBuffer = candidate.second;
+		if (pBuffer->GetSize() > budget) {
+			continue;
+		}
+
+		MemoryAllocation newAllocation = allocator.AllocateForRelocation(pBuffer->GetAllocation());
+		if (!newAllocation.IsValid()) {
+			continue;
+		}
+
+		//Memory bindings cannot change, so the buffer is recreated with the same description on top of the new range
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = pBuffer->GetSize();
+		bufferInfo.usage = pBuffer->GetUsage();
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		PendingMove move{};
+		move.pBuffer = pBuffer;
+		move.newAllocation = newAllocation;
+		if (vkCreateBuffer(logicalDevice, &bufferInfo, nullptr, &move.newBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create defragmentation buffer!");
+		}
+		vkBindBufferMemory(logicalDevice, move.newBuffer, newAllocation.memory, newAllocation.offset);
+
+		m_pendingMoves.push_back(move);
+		budget -= pBuffer->GetSize();
+		plannedCount++;
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	m_planMs = elapsed.count();
+
+	//A frame with nothing to record still paid for looking
+	if (plannedCount == 0) {
+		m_statistics.lastFrameBytes = 0;
+		m_statistics.lastFrameMs = m_planMs;
+		m_statistics.maxFrameMs = std::max(m_statistics.maxFrameMs, m_planMs);
+	}
+
+	return plannedCount;
+}
+
+///////////////////////////////////////////
+void VulkanDefragmenter::RecordMoves(VkCommandBuffer commandBuffer)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	uint64_t timelineValue = m_pGraphicsTimeline->GetLastSubmittedValue() + 1;
+	VkDeviceSize frameBytes = 0;
+
+	for (auto& move : m_pendingMoves) {
+		if (move.timelineValue != 0) {
+			continue;
+		}
+
+		VkBufferCopy region{};
+		region.srcOffset = 0;
+		region.dstOffset = 0;
+		region.size = move.pBuffer->GetSize();
+		vkCmdCopyBuffer(commandBuffer, move.pBuffer->GetBuffer(), move.newBuffer, 1, &region);
+
+		move.timelineValue = timelineValue;
+		frameBytes += region.size;
+		m_statistics.moveCount++;
+	}
+
+	//One barrier makes every copy visible to whatever reads the buffers once they have been swapped in
+	VkMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.memoryBarrierCount = 1;
+	dependencyInfo.pMemoryBarriers = &barrier;
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	double frameMs = m_planMs + elapsed.count();
+
+	m_statistics.bytesMoved += frameBytes;
+	m_statistics.activeFrames++;
+	m_statistics.lastFrameBytes = frameBytes;
+	m_statistics.maxFrameBytes = std::max(m_statistics.maxFrameBytes, frameBytes);
+	m_statistics.lastFrameMs = frameMs;
+	m_statistics.maxFrameMs = std::max(m_statistics.maxFrameMs, frameMs);
+}
+
+///////////////////////////////////////////
+const DefragmentationStatistics& VulkanDefragmenter::GetStatistics() const
+{
+	return m_statistics;
+}
+
+///////////////////////////////////////////
+void VulkanDefragmenter::WriteJson(JsonWriter& writer) const
+{
+	writer.Write("maxBytesPerFrame", static_cast<uint64_t>(m_maxBytesPerFrame));
+	writer.Write("registeredBuffers", static_cast<uint64_t>(m_buffers.size()));
+	writer.Write("bytesMoved", m_statistics.bytesMoved);
+	writer.Write("moves", m_statistics.moveCount);
+	writer.Write("activeFrames", m_statistics.activeFrames);
+	writer.Write("blocksFreed", m_statistics.blocksFreed);
+	writer.Write("maxFrameBytes", static_cast<uint64_t>(m_statistics.maxFrameBytes));
+	writer.Write("maxFrameMs", m_statistics.maxFrameMs);
+	writer.Write("movesInFlight", static_cast<uint64_t>(m_pendingMoves.size()));
+}
+
+///////////////////////////////////////////
+bool VulkanDefragmenter::IsMoving(const VulkanBuffer* pBuffer) const
+{
+	return std::any_of(m_pendingMoves.begin(), m_pendingMoves.end(), [pBuffer](const PendingMove& move) { return move.pBuffer == pBuffer; });
+}
+
+///////////////////////////////////////////
+void VulkanDefragmenter::RetireMove(const PendingMove& move, uint64_t value)
+{
+	VkDevice logicalDevice = m_pDevice->GetLogicalDevice();
+	VulkanMemoryAllocator* pAllocator = &m_pDevice->GetMemoryAllocator();
+	VkBuffer buffer = move.newBuffer;
+	MemoryAllocation allocation = move.newAllocation;
+
+	m_pGraphicsTimeline->Retire(value, [this, logicalDevice, pAllocator, buffer, allocation]() mutable {
+		vkDestroyBuffer(logicalDevice, buffer, nullptr);
+
+		//The allocator gives a block back to the driver as soon as its last range is freed
+		uint32_t allocationCount = pAllocator->GetDeviceAllocationCount();
+		pAllocator->Free(allocation);
+		if (pAllocator->GetDeviceAllocationCount() < allocationCount) {
+			m_statistics.blocksFreed++;
+		}
+	});
+}
@@ -0,0 +1,75 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+#include "VulkanTimeline.h"
+#include "../Profiling/JsonWriter.h"
+
+#include <vector>
+
+///////////////////////////////////////////
+struct DefragmentationStatistics {
+	uint64_t bytesMoved = 0;
+	uint64_t moveCount = 0;
+	uint64_t activeFrames = 0; //Frames that recorded at least one move
+	uint32_t blocksFreed = 0;
+
+	VkDeviceSize lastFrameBytes = 0;
+	VkDeviceSize maxFrameBytes = 0;
+	double lastFrameMs = 0.0; //CPU time spent choosing and recording moves
+	double maxFrameMs = 0.0;
+};
+
+///////////////////////////////////////////
+//Compacts registered buffers a little every frame. Buffers in the sparsest blocks are copied by the GPU into free ranges of denser blocks,
+//and once the copy has finished the buffer is swapped to its new storage and the old range is freed. Blocks left empty are handed back to the driver by the allocator.
+//Moving a buffer replaces its VkBuffer handle, so anything holding the handle must be refreshed after CompleteMoves() reports a swap
+class VulkanDefragmenter
+{
+public:
+	//maxBytesPerFrame caps how much is copied each frame, 0 disables defragmentation
+	void InitDefragmenter(VulkanDevice* pDevice, VulkanTimeline* pGraphicsTimeline, VkDeviceSize maxBytesPerFrame);
+	//Call once the GPU is idle, moves that have not been swapped in are abandoned
+	void DestroyDefragmenter();
+
+	//Only device local buffers that the GPU never writes to can be moved, they need TRANSFER_SRC and TRANSFER_DST usage
+	void RegisterBuffer(VulkanBuffer* pBuffer);
+	//Must be called before the buffer is destroyed, a move in progress is cancelled
+	void UnregisterBuffer(VulkanBuffer* pBuffer);
+
+	//Swaps buffers whose copies the GPU has finished to their new storage. Returns how many were swapped
+	uint32_t CompleteMoves();
+	//Picks buffers to move this frame, up to the per frame budget, and reserves their new storage. Returns how many moves need recording
+	uint32_t PlanMoves();
+	//Records the copies of the planned moves. commandBuffer must go in the next submit on the graphics timeline
+	void RecordMoves(VkCommandBuffer commandBuffer);
+
+	const DefragmentationStatistics& GetStatistics() const;
+	void WriteJson(JsonWriter& writer) const;
+
+private:
+	struct PendingMove {
+		VulkanBuffer* pBuffer = nullptr;
+		VkBuffer newBuffer = VK_NULL_HANDLE;
+		MemoryAllocation newAllocation;
+		uint64_t timelineValue = 0; //0 until the copy has been recorded
+	};
+
+	bool IsMoving(const VulkanBuffer* pBuffer) const;
+	//Destroys the new storage of a move that will never be swapped in, once the GPU has passed value
+	void RetireMove(const PendingMove& move, uint64_t value);
+
+private:
+	VulkanDevice* m_pDevice = nullptr;
+	VulkanTimeline* m_pGraphicsTimeline = nullptr;
+	VkDeviceSize m_maxBytesPerFrame = 0;
+
+	std::vector<VulkanBuffer*> m_buffers;
+	std::vector<PendingMove> m_pendingMoves;
+	double m_planMs = 0.0; //Carried from PlanMoves() into the frame's cost
+
+	DefragmentationStatistics m_statistics;
+};
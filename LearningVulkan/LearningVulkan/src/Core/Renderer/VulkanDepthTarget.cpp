@@ -0,0 +1,92 @@
+#include "VulkanDepthTarget.h"
+
+#include <stdexcept>
+
+///////////////////////////////////////////
+void VulkanDepthTarget::InitDepthTarget(VulkanDevice* pDevices, VkExtent2D extents, VkFormat format, uint32_t imageCount, VkImageUsageFlags extraUsage)
+{
+	m_pDevices = pDevices;
+	m_extents = extents;
+	m_format = format;
+
+	m_images.resize(imageCount);
+	m_imageMemory.resize(imageCount);
+	m_imageViews.resize(imageCount);
+
+	VkDevice logicalDevice = pDevices->GetLogicalDevice();
+	for (uint32_t i = 0; i < imageCount; ++i) {
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = m_format;
+		imageInfo.extent = { m_extents.width, m_extents.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | extraUsage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(logicalDevice, &imageInfo, nullptr, &m_images[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create depth image!");
+		}
+
+		m_imageMemory[i] = pDevices->GetMemoryAllocator().AllocateForImage(m_images[i], imageInfo.tiling, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		//Depth only, the view can then be sampled as well as attached
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_images[i];
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = m_format;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(logicalDevice, &viewInfo, nullptr, &m_imageViews[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create depth image view!");
+		}
+	}
+}
+
+///////////////////////////////////////////
+void VulkanDepthTarget::DestroyDepthTarget()
+{
+	VkDevice logicalDevice = m_pDevices->GetLogicalDevice();
+	for (size_t i = 0; i < m_images.size(); ++i) {
+		vkDestroyImageView(logicalDevice, m_imageViews[i], nullptr);
+		vkDestroyImage(logicalDevice, m_images[i], nullptr);
+		m_pDevices->GetMemoryAllocator().Free(m_imageMemory[i]);
+	}
+
+	m_images.clear();
+	m_imageMemory.clear();
+	m_imageViews.clear();
+}
+
+///////////////////////////////////////////
+VkExtent2D VulkanDepthTarget::GetExtents() const
+{
+	return m_extents;
+}
+
+///////////////////////////////////////////
+VkFormat VulkanDepthTarget::GetFormat() const
+{
+	return m_format;
+}
+
+///////////////////////////////////////////
+const std::vector<VkImage>& VulkanDepthTarget::GetImages() const
+{
+	return m_images;
+}
+
+///////////////////////////////////////////
+const std::vector<VkImageView>& VulkanDepthTarget::GetImageViews() const
+{
+	return m_imageViews;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+
+#include <vector>
+
+///////////////////////////////////////////
+//One depth image per render target image, so each framebuffer owns its depth and frames in flight never share one.
+//Recreated along with the swap chain, the extents always match the color images
+class VulkanDepthTarget {
+public:
+	//extraUsage is added to DEPTH_STENCIL_ATTACHMENT, e.g. SAMPLED when a compute pass reads the depth afterwards
+	void InitDepthTarget(VulkanDevice* pDevices, VkExtent2D extents, VkFormat format, uint32_t imageCount, VkImageUsageFlags extraUsage = 0);
+	void DestroyDepthTarget();
+
+	VkExtent2D GetExtents() const;
+	VkFormat GetFormat() const;
+	const std::vector<VkImage>& GetImages() const;
+	const std::vector<VkImageView>& GetImageViews() const;
+
+private:
+	VulkanDevice* m_pDevices = nullptr;
+	VkExtent2D m_extents{};
+	VkFormat m_format = VK_FORMAT_UNDEFINED;
+	std::vector<VkImage> m_images;
+	std::vector<MemoryAllocation> m_imageMemory;
+	std::vector<VkImageView> m_imageViews;
+};
@@ -6,12 +6,20 @@
 #include <string>
 #include <map>
 #include <stdexcept>
+#include <algorithm>
+#include <cstring>
 
 ///////////////////////////////////////////
-void VulkanDevice::InitDevice(VkInstance instance, VkSurfaceKHR surface)
+void VulkanDevice::InitDevice(VkInstance instance, VkSurfaceKHR surface, const DeviceFeatureRequests& featureRequests)
 {
 	m_surface = surface;
 
+	//Without a surface there is nothing to present to so the swap chain extension is not needed
+	if (m_surface == VK_NULL_HANDLE) {
+		auto isSwapChainExtension = [](const char* extension) { return strcmp(extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME) == 0; };
+		m_deviceExtensions.erase(std::remove_if(m_deviceExtensions.begin(), m_deviceExtensions.end(), isSwapChainExtension), m_deviceExtensions.end());
+	}
+
 	uint32_t deviceCount = 0;
 	vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
 
@@ -35,10 +43,14 @@ void VulkanDevice::InitDevice(VkInstance instance, VkSurfaceKHR surface)
 		throw std::runtime_error("Failed to find a suitable GPU!");
 	}
 
+	vkGetPhysicalDeviceProperties(m_physicalDevice, &m_physicalDeviceProperties);
+
 	QueueFamilyIndices indices = FindQueueFamilies(m_physicalDevice);
+	m_queueFamilyIndices = indices;
 
+	//One queue per family, roles that share a family share its queue
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+	std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value(), indices.computeFamily.value(), indices.transferFamily.value() };
 
 	float queuePriority = 1.0f;
 
@@ -51,10 +63,40 @@ void VulkanDevice::InitDevice(VkInstance instance, VkSurfaceKHR surface)
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	VkPhysicalDeviceVulkan12Features supportedVulkan12Features{};
+	supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceFeatures2 supportedFeatures2{};
+	supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedFeatures2.pNext = &supportedVulkan12Features;
+	vkGetPhysicalDeviceFeatures2(m_physicalDevice, &supportedFeatures2);
+	const VkPhysicalDeviceFeatures& supportedFeatures = supportedFeatures2.features;
+
+	//Optional features are negotiated, requests the device cannot honour are left disabled rather than failing device creation
 	VkPhysicalDeviceFeatures deviceFeatures{};
+	deviceFeatures.pipelineStatisticsQuery = featureRequests.bPipelineStatistics && supportedFeatures.pipelineStatisticsQuery;
+	//Secondary command buffers may only execute inside an active statistics query when queries can be inherited
+	deviceFeatures.inheritedQueries = deviceFeatures.pipelineStatisticsQuery && supportedFeatures.inheritedQueries;
+	//Culled draws are written with their object index as firstInstance, so the count path is all or nothing
+	m_bDrawIndirectCount = featureRequests.bIndirectDrawCount && supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance && supportedVulkan12Features.drawIndirectCount;
+	deviceFeatures.multiDrawIndirect = m_bDrawIndirectCount;
+	deviceFeatures.drawIndirectFirstInstance = m_bDrawIndirectCount;
+
+	//Timeline semaphores let every submit be tracked with a single increasing value rather than a fence per frame
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.timelineSemaphore = VK_TRUE;
+	vulkan12Features.drawIndirectCount = m_bDrawIndirectCount;
+
+	//Synchronization2 gives us vkCmdWriteTimestamp2 for the GPU profiler
+	VkPhysicalDeviceVulkan13Features vulkan13Features{};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	vulkan13Features.synchronization2 = VK_TRUE;
+	vulkan12Features.pNext = &vulkan13Features;
 
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = &vulkan12Features;
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
@@ -77,13 +119,20 @@ void VulkanDevice::InitDevice(VkInstance instance, VkSurfaceKHR surface)
 		throw std::runtime_error("Failed to Create Logical Device!");
 	}
 
+	m_enabledFeatures = deviceFeatures;
+
 	vkGetDeviceQueue(m_logicalDevice, indices.graphicsFamily.value(), 0, &m_graphicsQueue);
 	vkGetDeviceQueue(m_logicalDevice, indices.presentFamily.value(), 0, &m_presentQueue);
+	vkGetDeviceQueue(m_logicalDevice, indices.computeFamily.value(), 0, &m_computeQueue);
+	vkGetDeviceQueue(m_logicalDevice, indices.transferFamily.value(), 0, &m_transferQueue);
+
+	m_memoryAllocator.InitMemoryAllocator(m_physicalDevice, m_logicalDevice);
 }
 
 ///////////////////////////////////////////
 void VulkanDevice::DestroyDevice()
 {
+	m_memoryAllocator.DestroyMemoryAllocator();
 	vkDestroyDevice(m_logicalDevice, nullptr);
 }
 
@@ -99,6 +148,24 @@ VkDevice VulkanDevice::GetLogicalDevice() const
 	return m_logicalDevice;
 }
 
+///////////////////////////////////////////
+const VkPhysicalDeviceProperties& VulkanDevice::GetPhysicalDeviceProperties() const
+{
+	return m_physicalDeviceProperties;
+}
+
+///////////////////////////////////////////
+const VkPhysicalDeviceFeatures& VulkanDevice::GetEnabledFeatures() const
+{
+	return m_enabledFeatures;
+}
+
+///////////////////////////////////////////
+bool VulkanDevice::IsDrawIndirectCountEnabled() const
+{
+	return m_bDrawIndirectCount;
+}
+
 ///////////////////////////////////////////
 VkQueue VulkanDevice::GetGraphicsQueue() const
 {
@@ -111,6 +178,18 @@ VkQueue VulkanDevice::GetPresentQueue() const
 	return m_presentQueue;
 }
 
+///////////////////////////////////////////
+VkQueue VulkanDevice::GetComputeQueue() const
+{
+	return m_computeQueue;
+}
+
+///////////////////////////////////////////
+VkQueue VulkanDevice::GetTransferQueue() const
+{
+	return m_transferQueue;
+}
+
 ///////////////////////////////////////////
 SwapChainSupportDetails VulkanDevice::QuerySwapChainSupport()
 {
@@ -120,7 +199,40 @@ SwapChainSupportDetails VulkanDevice::QuerySwapChainSupport()
 ///////////////////////////////////////////
 QueueFamilyIndices VulkanDevice::FindQueueFamiliesForPhysicalDevice()
 {
-	return FindQueueFamilies(m_physicalDevice);
+	return m_queueFamilyIndices;
+}
+
+///////////////////////////////////////////
+uint32_t VulkanDevice::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+	return m_memoryAllocator.FindMemoryType(typeFilter, properties);
+}
+
+///////////////////////////////////////////
+VkFormat VulkanDevice::FindSupportedFormat(const std::vector<VkFormat>& candidates, VkFormatFeatureFlags features) const
+{
+	for (VkFormat format : candidates) {
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &properties);
+		if ((properties.optimalTilingFeatures & features) == features) {
+			return format;
+		}
+	}
+
+	throw std::runtime_error("Failed to find a supported format!");
+}
+
+///////////////////////////////////////////
+VkFormat VulkanDevice::FindDepthFormat(VkFormatFeatureFlags extraFeatures) const
+{
+	//No stencil formats, depth views of them could not be attached on their own. D16 is always supported along with one of the 24 or 32 bit formats
+	return FindSupportedFormat({ VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM }, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | extraFeatures);
+}
+
+///////////////////////////////////////////
+VulkanMemoryAllocator& VulkanDevice::GetMemoryAllocator()
+{
+	return m_memoryAllocator;
 }
 
 ///////////////////////////////////////////
@@ -144,13 +256,29 @@ int VulkanDevice::RateDeviceSuitability(VkPhysicalDevice device)
 		return 0;
 	}
 
+	VkPhysicalDeviceVulkan13Features vulkan13Features{};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.pNext = &vulkan13Features;
+
+	VkPhysicalDeviceFeatures2 deviceFeatures2{};
+	deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	deviceFeatures2.pNext = &vulkan12Features;
+	vkGetPhysicalDeviceFeatures2(device, &deviceFeatures2);
+
+	if (!vulkan12Features.timelineSemaphore || !vulkan13Features.synchronization2) {
+		return 0;
+	}
+
 	bool extensionsSupported = CheckDeviceExtensionSupport(device);
 
 	bool swapChainAdaquate = false;
 	if (!extensionsSupported) {
 		return 0;
 	}
-	else {
+	else if (m_surface != VK_NULL_HANDLE) {
 		SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
 		swapChainAdaquate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 		score += 100;
@@ -194,24 +322,67 @@ QueueFamilyIndices VulkanDevice::FindQueueFamilies(VkPhysicalDevice device)
 	std::vector<VkQueueFamilyProperties> queueFamilies(QueueFamilyCount);
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &QueueFamilyCount, queueFamilies.data());
 
-	int i = 0;
-	for (const auto& queueFamily : queueFamilies) {
-		if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-			indices.graphicsFamily = i;
+	//Every family is looked at rather than stopping at the first match, the best family for each role may come later in the list
+	for (uint32_t i = 0; i < QueueFamilyCount; ++i) {
+		VkQueueFlags flags = queueFamilies[i].queueFlags;
+		if (queueFamilies[i].queueCount == 0) {
+			continue;
 		}
 
 		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
+		if (m_surface != VK_NULL_HANDLE) {
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
+		}
 
-		if (presentSupport) {
+		//A graphics family that can also present avoids transferring swap chain images between queues
+		bool bGraphics = (flags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		if (bGraphics && (!indices.graphicsFamily.has_value() || (presentSupport && indices.presentFamily != indices.graphicsFamily))) {
+			indices.graphicsFamily = i;
+			if (presentSupport) {
+				indices.presentFamily = i;
+			}
+		}
+
+		if (presentSupport && !indices.presentFamily.has_value()) {
 			indices.presentFamily = i;
 		}
 
-		if (indices.IsComplete()) {
-			break;
+		//Async compute, a family with compute but no graphics
+		if ((flags & VK_QUEUE_COMPUTE_BIT) && !bGraphics && !indices.computeFamily.has_value()) {
+			indices.computeFamily = i;
+		}
+
+		//DMA engine, a family that can only transfer. Compute families also accept transfer commands even when they do not report the bit
+		bool bTransfer = (flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) != 0;
+		bool bTransferOnly = bTransfer && !bGraphics && !(flags & VK_QUEUE_COMPUTE_BIT);
+		if (bTransferOnly && (!indices.transferFamily.has_value() || indices.transferFamily == indices.computeFamily)) {
+			indices.transferFamily = i;
+		}
+		else if (bTransfer && !bGraphics && !indices.transferFamily.has_value()) {
+			indices.transferFamily = i;
 		}
+	}
+
+	//Headless devices never present, the graphics family stands in so the rest of the renderer does not need to special case it
+	if (m_surface == VK_NULL_HANDLE) {
+		indices.presentFamily = indices.graphicsFamily;
+	}
 
-		i++;
+	//Without dedicated families the work shares the graphics queue. Any graphics family accepts transfer commands, but compute needs the bit
+	if (!indices.computeFamily.has_value() && indices.graphicsFamily.has_value()) {
+		if (queueFamilies[indices.graphicsFamily.value()].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+			indices.computeFamily = indices.graphicsFamily;
+		}
+		else {
+			for (uint32_t i = 0; i < QueueFamilyCount && !indices.computeFamily.has_value(); ++i) {
+				if (queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+					indices.computeFamily = i;
+				}
+			}
+		}
+	}
+	if (!indices.transferFamily.has_value()) {
+		indices.transferFamily = indices.graphicsFamily;
 	}
 
 	return indices;
@@ -3,16 +3,29 @@
 #include <GLFW/glfw3.h>
 #undef GLFW_INCLUDE_VULKAN
 
+#include "VulkanMemoryAllocator.h"
+
 #include <optional>
 #include <vector>
 
 ///////////////////////////////////////////
+//Compute and transfer prefer families without graphics support so their work can overlap the graphics queue, and fall back to the graphics family otherwise
 struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	std::optional<uint32_t> computeFamily;
+	std::optional<uint32_t> transferFamily;
 
 	bool IsComplete() {
-		return graphicsFamily.has_value() && presentFamily.has_value();
+		return graphicsFamily.has_value() && presentFamily.has_value() && computeFamily.has_value() && transferFamily.has_value();
+	}
+
+	bool HasDedicatedCompute() const {
+		return computeFamily.has_value() && computeFamily != graphicsFamily;
+	}
+
+	bool HasDedicatedTransfer() const {
+		return transferFamily.has_value() && transferFamily != graphicsFamily;
 	}
 };
 
@@ -23,22 +36,48 @@ struct SwapChainSupportDetails {
 	std::vector<VkPresentModeKHR> presentModes;
 };
 
+///////////////////////////////////////////
+//Optional features the renderer would like. They are enabled when the physical device supports them, check GetEnabledFeatures() for what was granted
+struct DeviceFeatureRequests {
+	bool bPipelineStatistics = false;
+	//multiDrawIndirect, drawIndirectFirstInstance and drawIndirectCount, everything GPU driven rendering needs. Granted only if all three are supported
+	bool bIndirectDrawCount = false;
+};
+
 ///////////////////////////////////////////
 class VulkanDevice
 {
 public:
-	void InitDevice(VkInstance instance, VkSurfaceKHR surface);
+	//Passing a null surface creates a headless device, no swap chain extension is required and presenting is not supported
+	void InitDevice(VkInstance instance, VkSurfaceKHR surface, const DeviceFeatureRequests& featureRequests = DeviceFeatureRequests());
 	void DestroyDevice();
 
 	VkPhysicalDevice GetPhysicalDevice() const;
 	VkDevice GetLogicalDevice() const;
+	const VkPhysicalDeviceProperties& GetPhysicalDeviceProperties() const;
+	const VkPhysicalDeviceFeatures& GetEnabledFeatures() const;
+	//Vulkan 1.2 feature, not part of GetEnabledFeatures()
+	bool IsDrawIndirectCountEnabled() const;
 
 	VkQueue GetGraphicsQueue() const;
 	VkQueue GetPresentQueue() const;
+	//The same queue as GetGraphicsQueue() when the device has no separate family for the work
+	VkQueue GetComputeQueue() const;
+	VkQueue GetTransferQueue() const;
 
 	SwapChainSupportDetails QuerySwapChainSupport();
+	//The families the logical device was created with
 	QueueFamilyIndices FindQueueFamiliesForPhysicalDevice();
 
+	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+	//First candidate whose optimal tiling supports every feature, throws when none does
+	VkFormat FindSupportedFormat(const std::vector<VkFormat>& candidates, VkFormatFeatureFlags features) const;
+	//Most precise depth only format that can be attached with the given extra features, e.g. SAMPLED_IMAGE to read it back.
+	//Float depth comes first as it is what makes reversed-Z worthwhile
+	VkFormat FindDepthFormat(VkFormatFeatureFlags extraFeatures = 0) const;
+	//Every buffer and image should get its memory from here rather than from vkAllocateMemory
+	VulkanMemoryAllocator& GetMemoryAllocator();
+
 private:
 	int RateDeviceSuitability(VkPhysicalDevice device);
 	bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
@@ -47,14 +86,22 @@ private:
 
 private: 
 	VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE; //Implicitely destroyed when the instance is destroyed
+	VkPhysicalDeviceProperties m_physicalDeviceProperties;
+	VkPhysicalDeviceFeatures m_enabledFeatures{};
+	bool m_bDrawIndirectCount = false;
 	VkDevice m_logicalDevice;
 
+	QueueFamilyIndices m_queueFamilyIndices;
 	VkQueue m_graphicsQueue;
 	VkQueue m_presentQueue;
+	VkQueue m_computeQueue;
+	VkQueue m_transferQueue;
 
 	VkSurfaceKHR m_surface;
 
-	const std::vector<const char*> m_deviceExtensions = {
+	VulkanMemoryAllocator m_memoryAllocator;
+
+	std::vector<const char*> m_deviceExtensions = {
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME
 	};
 };
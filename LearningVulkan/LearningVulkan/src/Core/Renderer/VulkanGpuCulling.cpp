@@ -0,0 +1,281 @@
+#include "VulkanGpuCulling.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+///////////////////////////////////////////
+//Matches local_size_x in cull.comp
+constexpr uint32_t CULLING_GROUP_SIZE = 64;
+
+///////////////////////////////////////////
+void VulkanGpuCulling::InitGpuCulling(VulkanDevice* pDevice, VulkanPipelineLibrary* pPipelineLibrary, uint32_t maxObjectCount, VkDescriptorSetLayout occlusionSetLayout)
+{
+	if (!pDevice->IsDrawIndirectCountEnabled()) {
+		throw std::runtime_error("GPU culling needs the drawIndirectCount, multiDrawIndirect and drawIndirectFirstInstance features!");
+	}
+	if (maxObjectCount > pDevice->GetPhysicalDeviceProperties().limits.maxDrawIndirectCount) {
+		throw std::runtime_error("GPU culling object count exceeds maxDrawIndirectCount!");
+	}
+
+	m_pDevice = pDevice;
+	m_maxObjectCount = std::max(maxObjectCount, 1u);
+	m_objectCount = 0;
+
+	//Everything stays on the GPU, the CPU only ever writes the objects through the upload engine
+	m_objectBuffer.InitBuffer(pDevice, sizeof(CullingObject) * m_maxObjectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	//Early commands start at 0 and Late commands at the object count, each phase counts into its own uint
+	m_drawCommandBuffer.InitBuffer(pDevice, sizeof(VkDrawIndexedIndirectCommand) * m_maxObjectCount * 2, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	m_drawCountBuffer.InitBuffer(pDevice, sizeof(uint32_t) * 2, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	m_occludedBuffer.InitBuffer(pDevice, sizeof(uint32_t) * m_maxObjectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	CreateDescriptorSet();
+	CreatePipelines(pPipelineLibrary, occlusionSetLayout);
+}
+
+///////////////////////////////////////////
+void VulkanGpuCulling::DestroyGpuCulling()
+{
+	VkDevice logicalDevice = m_pDevice->GetLogicalDevice();
+	vkDestroyPipelineLayout(logicalDevice, m_pipelineLayout, nullptr);
+	vkDestroyPipelineLayout(logicalDevice, m_occlusionPipelineLayout, nullptr);
+	m_occlusionPipelineLayout = VK_NULL_HANDLE;
+	m_occlusionPipeline = VK_NULL_HANDLE;
+	vkDestroyDescriptorPool(logicalDevice, m_descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(logicalDevice, m_descriptorSetLayout, nullptr);
+
+	m_objectBuffer.DestroyBuffer();
+	m_drawCommandBuffer.DestroyBuffer();
+	m_drawCountBuffer.DestroyBuffer();
+	m_occludedBuffer.DestroyBuffer();
+}
+
+///////////////////////////////////////////
+void VulkanGpuCulling::UploadObjects(VulkanUploadEngine* pUploadEngine, const std::vector<CullingObject>& objects)
+{
+	if (objects.size() > m_maxObjectCount) {
+		throw std::runtime_error("Too many objects for the GPU culling buffers!");
+	}
+
+	m_objectCount = static_cast<uint32_t>(objects.size());
+	if (m_objectCount > 0) {
+		pUploadEngine->UploadBuffer(m_objectBuffer.GetBuffer(), 0, objects.data(), sizeof(CullingObject) * objects.size());
+	}
+}
+
+///////////////////////////////////////////
+VkDescriptorSetLayout VulkanGpuCulling::GetDescriptorSetLayout() const
+{
+	return m_descriptorSetLayout;
+}
+
+///////////////////////////////////////////
+void VulkanGpuCulling::RecordCulling(VkCommandBuffer commandBuffer, const glm::mat4& projection, CullingPhase phase, const VulkanHiZPyramid* pPyramid)
+{
+	bool bOcclusion = phase != CullingPhase::All;
+	if (bOcclusion && (m_occlusionPipeline == VK_NULL_HANDLE || pPyramid == nullptr)) {
+		throw std::runtime_error("Occlusion culling phases need an occlusion layout and a Hi-Z pyramid!");
+	}
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.memoryBarrierCount = 1;
+
+	if (phase == CullingPhase::Late) {
+		//Only the occluded flags carry over from Early, the commands and count Late writes were cleared with Early's
+		VkMemoryBarrier2 flagsBarrier{};
+		flagsBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+		flagsBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		flagsBarrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+		flagsBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		flagsBarrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+		dependencyInfo.pMemoryBarriers = &flagsBarrier;
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+	}
+	else {
+		//The previous frame may still be drawing from the commands and count, and its culling pass wrote them
+		VkMemoryBarrier2 reuseBarrier{};
+		reuseBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+		reuseBarrier.srcStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		reuseBarrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+		reuseBarrier.dstStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		reuseBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+		dependencyInfo.pMemoryBarriers = &reuseBarrier;
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+		vkCmdFillBuffer(commandBuffer, m_drawCountBuffer.GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+		VkMemoryBarrier2 clearBarrier{};
+		clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+		clearBarrier.srcStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+		clearBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		clearBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		clearBarrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+		dependencyInfo.pMemoryBarriers = &clearBarrier;
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+	}
+
+	CullingConstants constants{};
+	constants.frustumPlanes = FrustumCuller::ExtractFrustumPlanes(projection);
+	constants.objectCount = m_objectCount;
+	constants.phase = static_cast<uint32_t>(phase);
+	constants.projection = glm::vec4(projection[0][0], projection[1][1], projection[2][2], projection[3][2]);
+
+	VkPipelineLayout layout = m_pipelineLayout;
+	if (bOcclusion) {
+		constants.reversedDepth = pPyramid->IsReversedDepth() ? 1 : 0;
+
+		layout = m_occlusionPipelineLayout;
+		VkDescriptorSet sets[2] = { m_descriptorSet, pPyramid->GetCullingDescriptorSet() };
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_occlusionPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 2, sets, 0, nullptr);
+	}
+	else {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout, 0, 1, &m_descriptorSet, 0, nullptr);
+	}
+
+	vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullingConstants), &constants);
+	vkCmdDispatch(commandBuffer, (m_objectCount + CULLING_GROUP_SIZE - 1) / CULLING_GROUP_SIZE, 1, 1);
+
+	VkMemoryBarrier2 drawBarrier{};
+	drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	drawBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	drawBarrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+	drawBarrier.dstStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+	drawBarrier.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+	dependencyInfo.pMemoryBarriers = &drawBarrier;
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+///////////////////////////////////////////
+void VulkanGpuCulling::RecordDraws(VkCommandBuffer commandBuffer, VkPipelineLayout layout, CullingPhase phase)
+{
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &m_descriptorSet, 0, nullptr);
+
+	//Late draws from the second half of the commands and the second count
+	VkDeviceSize phaseIndex = phase == CullingPhase::Late ? 1 : 0;
+	VkDeviceSize commandOffset = phaseIndex * m_objectCount * sizeof(VkDrawIndexedIndirectCommand);
+	VkDeviceSize countOffset = phaseIndex * sizeof(uint32_t);
+
+	//The count written by the culling pass is clamped to the object count, so the commands past it are never read
+	vkCmdDrawIndexedIndirectCount(commandBuffer, m_drawCommandBuffer.GetBuffer(), commandOffset, m_drawCountBuffer.GetBuffer(), countOffset, m_objectCount, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+///////////////////////////////////////////
+uint32_t VulkanGpuCulling::GetObjectCount() const
+{
+	return m_objectCount;
+}
+
+///////////////////////////////////////////
+bool VulkanGpuCulling::IsOcclusionCullingEnabled() const
+{
+	return m_occlusionPipeline != VK_NULL_HANDLE;
+}
+
+///////////////////////////////////////////
+void VulkanGpuCulling::CreateDescriptorSet()
+{
+	VkDevice logicalDevice = m_pDevice->GetLogicalDevice();
+
+	//0: objects, 1: draw commands, 2: draw counts, 3: occluded flags
+	std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+	for (uint32_t i = 0; i < bindings.size(); ++i) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	bindings[0].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = static_cast<uint32_t>(bindings.size());
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &m_descriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &m_descriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate culling descriptor set!");
+	}
+
+	std::array<VkDescriptorBufferInfo, 4> bufferInfos{};
+	bufferInfos[0].buffer = m_objectBuffer.GetBuffer();
+	bufferInfos[1].buffer = m_drawCommandBuffer.GetBuffer();
+	bufferInfos[2].buffer = m_drawCountBuffer.GetBuffer();
+	bufferInfos[3].buffer = m_occludedBuffer.GetBuffer();
+
+	std::array<VkWriteDescriptorSet, 4> writes{};
+	for (uint32_t i = 0; i < writes.size(); ++i) {
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = VK_WHOLE_SIZE;
+
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = m_descriptorSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+
+	vkUpdateDescriptorSets(logicalDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+///////////////////////////////////////////
+void VulkanGpuCulling::CreatePipelines(VulkanPipelineLibrary* pPipelineLibrary, VkDescriptorSetLayout occlusionSetLayout)
+{
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullingConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_pDevice->GetLogicalDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create culling pipeline layout!");
+	}
+
+	m_pipeline = pPipelineLibrary->CreateComputePipeline("shaders/cull.spv", m_pipelineLayout);
+
+	if (occlusionSetLayout == VK_NULL_HANDLE) {
+		return;
+	}
+
+	//The same shader compiled with OCCLUSION_CULLING, which adds the pyramid as set 1
+	VkDescriptorSetLayout setLayouts[2] = { m_descriptorSetLayout, occlusionSetLayout };
+	pipelineLayoutInfo.setLayoutCount = 2;
+	pipelineLayoutInfo.pSetLayouts = setLayouts;
+
+	if (vkCreatePipelineLayout(m_pDevice->GetLogicalDevice(), &pipelineLayoutInfo, nullptr, &m_occlusionPipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create occlusion culling pipeline layout!");
+	}
+
+	m_occlusionPipeline = pPipelineLibrary->CreateComputePipeline("shaders/cull_occlusion.spv", m_occlusionPipelineLayout);
+}
@@ -0,0 +1,102 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+#include "VulkanUploadEngine.h"
+#include "VulkanPipelineLibrary.h"
+#include "VulkanHiZPyramid.h"
+#include "../Culling/FrustumCuller.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <vector>
+
+///////////////////////////////////////////
+//One cullable object, matches the Object struct in cull.comp and indirect.vert (std430)
+struct CullingObject {
+	glm::vec4 transform = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f); //xy offset, zw scale in view space
+	glm::vec4 boundingSphere = glm::vec4(0.0f); //xyz centre and w radius, before the transform is applied
+	uint32_t indexCount = 0;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	float depth = 0.0f; //Distance in front of the camera, subtracted from the z of every vertex and of the bounding sphere
+};
+
+///////////////////////////////////////////
+//Two phase occlusion culling. Early tests against last frame's Hi-Z pyramid and draws what passes,
+//Late retests only what Early rejected against a pyramid built from the early draws, catching objects that have just come into view
+enum class CullingPhase : uint32_t {
+	All = 0, //Frustum only
+	Early = 1,
+	Late = 2
+};
+
+///////////////////////////////////////////
+//Matches the push constant block in cull.comp
+struct CullingConstants {
+	FrustumPlanes frustumPlanes; //View space
+	uint32_t objectCount = 0;
+	uint32_t phase = 0;
+	uint32_t reversedDepth = 0;
+	uint32_t padding = 0;
+	glm::vec4 projection = glm::vec4(0.0f); //[0][0], [1][1], [2][2] and [3][2] of the projection, all occlusion culling needs to project a sphere
+};
+
+///////////////////////////////////////////
+//GPU driven rendering. Objects live in a storage buffer, a compute pass tests each one against the frustum and appends a VkDrawIndexedIndirectCommand
+//for every survivor, and one vkCmdDrawIndexedIndirectCount() draws them all. The CPU records the same handful of commands whatever the object count.
+//Each command's firstInstance is its object index, so vertex shaders find their object through gl_InstanceIndex.
+//With an occlusion layout the Early and Late phases also test each object against a VulkanHiZPyramid, each phase has its own commands and count
+class VulkanGpuCulling
+{
+public:
+	//Needs VulkanDevice::IsDrawIndirectCountEnabled(). The compute pipelines are created straight away through the pipeline library,
+	//passing VulkanHiZPyramid::GetCullingDescriptorSetLayout() as occlusionSetLayout enables the Early and Late phases
+	void InitGpuCulling(VulkanDevice* pDevice, VulkanPipelineLibrary* pPipelineLibrary, uint32_t maxObjectCount, VkDescriptorSetLayout occlusionSetLayout = VK_NULL_HANDLE);
+	void DestroyGpuCulling();
+
+	//Replaces every object, the buffer is written through the upload engine so the next submit must wait on the engine's acquires
+	void UploadObjects(VulkanUploadEngine* pUploadEngine, const std::vector<CullingObject>& objects);
+
+	//Set 0 of graphics pipelines drawing the culled objects, binding 0 is the object buffer and is visible to the vertex stage
+	VkDescriptorSetLayout GetDescriptorSetLayout() const;
+
+	//Must be recorded outside a render pass. All and Early wait for the previous frame's draws to finish reading the commands before overwriting them,
+	//Late must follow Early in the same frame. Early and Late sample pPyramid, which must have been built or initialized earlier on the queue.
+	//Objects are in the view space of projection, a perspective projection with depth from 0 to 1 looking down -z
+	void RecordCulling(VkCommandBuffer commandBuffer, const glm::mat4& projection, CullingPhase phase = CullingPhase::All, const VulkanHiZPyramid* pPyramid = nullptr);
+	//Must be recorded inside a render pass after RecordCulling() for the same phase, with a pipeline using layout bound. Binds set 0 itself
+	void RecordDraws(VkCommandBuffer commandBuffer, VkPipelineLayout layout, CullingPhase phase = CullingPhase::All);
+
+	uint32_t GetObjectCount() const;
+	bool IsOcclusionCullingEnabled() const;
+
+private:
+	void CreateDescriptorSet();
+	void CreatePipelines(VulkanPipelineLibrary* pPipelineLibrary, VkDescriptorSetLayout occlusionSetLayout);
+
+private:
+	VulkanDevice* m_pDevice = nullptr;
+	uint32_t m_maxObjectCount = 0;
+	uint32_t m_objectCount = 0;
+
+	VulkanBuffer m_objectBuffer;
+	VulkanBuffer m_drawCommandBuffer;
+	VulkanBuffer m_drawCountBuffer;
+	VulkanBuffer m_occludedBuffer; //One flag per object, set by Early for the objects Late has to retest
+
+	VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+
+	VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline m_pipeline = VK_NULL_HANDLE; //Owned by the pipeline library
+
+	//Set 1 is the pyramid, both VK_NULL_HANDLE without occlusion culling
+	VkPipelineLayout m_occlusionPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline m_occlusionPipeline = VK_NULL_HANDLE;
+};
@@ -0,0 +1,176 @@
+#include "VulkanGpuProfiler.h"
+
+#include <numeric>
+#include <stdexcept>
+
+//How many frames of samples make up a scope's rolling average
+constexpr size_t GPU_PROFILER_HISTORY = 120;
+
+///////////////////////////////////////////
+void VulkanGpuProfiler::InitProfiler(VulkanDevice* pDevices, uint32_t frameCount, uint32_t maxScopesPerFrame)
+{
+	m_logicalDevice = pDevices->GetLogicalDevice();
+	m_maxScopesPerFrame = maxScopesPerFrame;
+
+	const VkPhysicalDeviceProperties& properties = pDevices->GetPhysicalDeviceProperties();
+	m_timestampPeriod = properties.limits.timestampPeriod;
+
+	//Timestamps are only meaningful if the graphics queue writes valid bits
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(pDevices->GetPhysicalDevice(), &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(pDevices->GetPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+	uint32_t validBits = queueFamilies[pDevices->FindQueueFamiliesForPhysicalDevice().graphicsFamily.value()].timestampValidBits;
+	m_bSupported = validBits > 0;
+	if (!m_bSupported) {
+		return;
+	}
+	m_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+	m_frames.resize(frameCount);
+	for (auto& frame : m_frames) {
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = m_maxScopesPerFrame * 2;
+
+		if (vkCreateQueryPool(m_logicalDevice, &poolInfo, nullptr, &frame.queryPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create timestamp query pool!");
+		}
+	}
+}
+
+///////////////////////////////////////////
+void VulkanGpuProfiler::DestroyProfiler()
+{
+	for (auto& frame : m_frames) {
+		vkDestroyQueryPool(m_logicalDevice, frame.queryPool, nullptr);
+	}
+	m_frames.clear();
+}
+
+///////////////////////////////////////////
+void VulkanGpuProfiler::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	if (!m_bSupported) {
+		return;
+	}
+
+	m_currentFrame = frameIndex;
+	m_openScopes.clear();
+
+	CollectResults(frameIndex);
+
+	//Must be recorded outside of a render pass
+	FrameQueries& frame = m_frames[frameIndex];
+	vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0, m_maxScopesPerFrame * 2);
+	frame.scopeNames.clear();
+}
+
+///////////////////////////////////////////
+void VulkanGpuProfiler::BeginScope(VkCommandBuffer commandBuffer, const char* name)
+{
+	if (!m_bSupported) {
+		return;
+	}
+
+	FrameQueries& frame = m_frames[m_currentFrame];
+	if (frame.scopeNames.size() >= m_maxScopesPerFrame) {
+		throw std::runtime_error("Too many GPU profiler scopes in one frame!");
+	}
+
+	uint32_t scopeIndex = static_cast<uint32_t>(frame.scopeNames.size());
+	frame.scopeNames.push_back(name);
+	m_openScopes.push_back(scopeIndex);
+
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, frame.queryPool, scopeIndex * 2);
+}
+
+///////////////////////////////////////////
+void VulkanGpuProfiler::EndScope(VkCommandBuffer commandBuffer)
+{
+	if (!m_bSupported) {
+		return;
+	}
+
+	uint32_t scopeIndex = m_openScopes.back();
+	m_openScopes.pop_back();
+
+	//Bottom of pipe waits for all previously recorded work to finish before writing
+	FrameQueries& frame = m_frames[m_currentFrame];
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, frame.queryPool, scopeIndex * 2 + 1);
+	frame.bHasResults = true;
+}
+
+///////////////////////////////////////////
+bool VulkanGpuProfiler::IsSupported() const
+{
+	return m_bSupported;
+}
+
+///////////////////////////////////////////
+const std::map<std::string, GpuScopeStats>& VulkanGpuProfiler::GetScopeStats() const
+{
+	return m_scopeStats;
+}
+
+///////////////////////////////////////////
+void VulkanGpuProfiler::WriteJson(JsonWriter& writer) const
+{
+	writer.Write("supported", m_bSupported);
+	writer.BeginObject("scopesMs");
+	for (const auto& scope : m_scopeStats) {
+		writer.BeginObject(scope.first);
+		writer.Write("last", scope.second.lastMs);
+		writer.Write("average", scope.second.averageMs);
+		writer.Write("samples", scope.second.sampleCount);
+		writer.EndObject();
+	}
+	writer.EndObject();
+}
+
+///////////////////////////////////////////
+void VulkanGpuProfiler::CollectResults(uint32_t frameIndex)
+{
+	FrameQueries& frame = m_frames[frameIndex];
+	if (!frame.bHasResults || frame.scopeNames.empty()) {
+		return;
+	}
+	frame.bHasResults = false;
+
+	//Each query is a timestamp followed by its availability, we never pass the wait bit so this cannot block
+	uint32_t queryCount = static_cast<uint32_t>(frame.scopeNames.size()) * 2;
+	std::vector<uint64_t> results(queryCount * 2);
+	VkResult result = vkGetQueryPoolResults(m_logicalDevice, frame.queryPool, 0, queryCount, results.size() * sizeof(uint64_t), results.data(),
+		sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+	if (result != VK_SUCCESS && result != VK_NOT_READY) {
+		throw std::runtime_error("Failed to read back GPU timestamps!");
+	}
+
+	for (size_t i = 0; i < frame.scopeNames.size(); ++i) {
+		uint64_t begin = results[i * 4 + 0];
+		bool bBeginAvailable = results[i * 4 + 1] != 0;
+		uint64_t end = results[i * 4 + 2];
+		bool bEndAvailable = results[i * 4 + 3] != 0;
+
+		if (!bBeginAvailable || !bEndAvailable) {
+			continue;
+		}
+
+		uint64_t ticks = ((end & m_timestampMask) - (begin & m_timestampMask)) & m_timestampMask;
+		double milliseconds = static_cast<double>(ticks) * m_timestampPeriod / 1000000.0;
+
+		std::deque<double>& history = m_history[frame.scopeNames[i]];
+		history.push_back(milliseconds);
+		if (history.size() > GPU_PROFILER_HISTORY) {
+			history.pop_front();
+		}
+
+		GpuScopeStats& stats = m_scopeStats[frame.scopeNames[i]];
+		stats.lastMs = milliseconds;
+		stats.averageMs = std::accumulate(history.begin(), history.end(), 0.0) / history.size();
+		stats.sampleCount++;
+	}
+}
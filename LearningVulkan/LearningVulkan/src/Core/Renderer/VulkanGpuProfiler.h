@@ -0,0 +1,66 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+#include "../Profiling/JsonWriter.h"
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////
+struct GpuScopeStats {
+	double lastMs = 0.0;
+	double averageMs = 0.0; //Average over the last GPU_PROFILER_HISTORY frames the scope was recorded in
+	uint64_t sampleCount = 0;
+};
+
+///////////////////////////////////////////
+//Times named scopes of a command buffer with pairs of vkCmdWriteTimestamp2.
+//There is one query pool per frame in flight, a slot's results are read back when the slot is reused so the GPU has already finished with them and reading never stalls.
+class VulkanGpuProfiler
+{
+public:
+	void InitProfiler(VulkanDevice* pDevices, uint32_t frameCount, uint32_t maxScopesPerFrame = 32);
+	void DestroyProfiler();
+
+	//Call once the GPU has finished the frame that last used frameIndex. Collects that frame's results and resets its queries
+	void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	//Scopes may be nested but must be closed in the order they were opened, within the same command buffer
+	void BeginScope(VkCommandBuffer commandBuffer, const char* name);
+	void EndScope(VkCommandBuffer commandBuffer);
+
+	bool IsSupported() const;
+	const std::map<std::string, GpuScopeStats>& GetScopeStats() const;
+
+	//Writes one object per scope into the object the writer currently has open
+	void WriteJson(JsonWriter& writer) const;
+
+private:
+	void CollectResults(uint32_t frameIndex);
+
+private:
+	struct FrameQueries {
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		std::vector<std::string> scopeNames; //Scope i uses queries 2i and 2i + 1
+		bool bHasResults = false;
+	};
+
+	VkDevice m_logicalDevice = VK_NULL_HANDLE;
+	bool m_bSupported = false;
+
+	double m_timestampPeriod = 1.0; //Nanoseconds per timestamp tick
+	uint64_t m_timestampMask = ~0ull;
+	uint32_t m_maxScopesPerFrame = 0;
+
+	std::vector<FrameQueries> m_frames;
+	uint32_t m_currentFrame = 0;
+	std::vector<uint32_t> m_openScopes; //Stack of scope indices waiting for EndScope
+
+	std::map<std::string, std::deque<double>> m_history;
+	std::map<std::string, GpuScopeStats> m_scopeStats;
+};
@@ -0,0 +1,434 @@
+#include "VulkanHiZPyramid.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+///////////////////////////////////////////
+//Matches local_size_x/y in hiz.comp
+constexpr uint32_t HIZ_GROUP_SIZE = 8;
+
+///////////////////////////////////////////
+//Matches the push constant block in hiz.comp
+struct HiZReduceConstants {
+	int32_t sourceWidth;
+	int32_t sourceHeight;
+	int32_t destinationWidth;
+	int32_t destinationHeight;
+	uint32_t reversedDepth;
+};
+
+///////////////////////////////////////////
+static uint32_t PreviousPowerOfTwo(uint32_t value)
+{
+	uint32_t result = 1;
+	while (result * 2 <= value) {
+		result *= 2;
+	}
+	return result;
+}
+
+///////////////////////////////////////////
+void VulkanHiZPyramid::InitHiZPyramid(VulkanDevice* pDevice, VulkanPipelineLibrary* pPipelineLibrary, VulkanTimeline* pGraphicsTimeline, bool bReversedDepth)
+{
+	m_pDevice = pDevice;
+	m_pGraphicsTimeline = pGraphicsTimeline;
+	m_bReversedDepth = bReversedDepth;
+
+	CreateLayouts();
+	m_reducePipeline = pPipelineLibrary->CreateComputePipeline("shaders/hiz.spv", m_reducePipelineLayout);
+}
+
+///////////////////////////////////////////
+void VulkanHiZPyramid::DestroyHiZPyramid()
+{
+	DestroyResources(m_resources);
+	m_resources = PyramidResources();
+
+	VkDevice logicalDevice = m_pDevice->GetLogicalDevice();
+	vkDestroyPipelineLayout(logicalDevice, m_reducePipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(logicalDevice, m_cullingSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(logicalDevice, m_reduceSetLayout, nullptr);
+	vkDestroySampler(logicalDevice, m_sampler, nullptr);
+}
+
+///////////////////////////////////////////
+void VulkanHiZPyramid::ResizePyramid(VkExtent2D depthExtents, const std::vector<VkImageView>& depthViews)
+{
+	//Frames already submitted may still build or sample the old pyramid
+	if (m_resources.image != VK_NULL_HANDLE) {
+		PyramidResources retired = m_resources;
+		m_pGraphicsTimeline->Retire(m_pGraphicsTimeline->GetLastSubmittedValue(), [this, retired]() mutable { DestroyResources(retired); });
+	}
+
+	m_resources = PyramidResources();
+	m_depthExtents = depthExtents;
+	CreateImage(m_resources, depthExtents);
+	CreateDescriptorSets(m_resources, depthViews);
+}
+
+///////////////////////////////////////////
+void VulkanHiZPyramid::RecordInitialize(VkCommandBuffer commandBuffer)
+{
+	VkImageSubresourceRange range{};
+	range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	range.baseMipLevel = 0;
+	range.levelCount = m_resources.mipLevels;
+	range.baseArrayLayer = 0;
+	range.layerCount = 1;
+
+	VkImageMemoryBarrier2 toGeneral{};
+	toGeneral.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	toGeneral.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+	toGeneral.srcAccessMask = VK_ACCESS_2_NONE;
+	toGeneral.dstStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+	toGeneral.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	toGeneral.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	toGeneral.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	toGeneral.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toGeneral.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toGeneral.image = m_resources.image;
+	toGeneral.subresourceRange = range;
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.imageMemoryBarrierCount = 1;
+	dependencyInfo.pImageMemoryBarriers = &toGeneral;
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+	float farDepth = m_bReversedDepth ? 0.0f : 1.0f;
+	VkClearColorValue farPlane = { { farDepth, farDepth, farDepth, farDepth } };
+	vkCmdClearColorImage(commandBuffer, m_resources.image, VK_IMAGE_LAYOUT_GENERAL, &farPlane, 1, &range);
+
+	VkMemoryBarrier2 clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	clearBarrier.srcStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+	clearBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	clearBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+	dependencyInfo.imageMemoryBarrierCount = 0;
+	dependencyInfo.pImageMemoryBarriers = nullptr;
+	dependencyInfo.memoryBarrierCount = 1;
+	dependencyInfo.pMemoryBarriers = &clearBarrier;
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+///////////////////////////////////////////
+void VulkanHiZPyramid::RecordBuild(VkCommandBuffer commandBuffer, uint32_t depthIndex)
+{
+	//The pyramid stays in GENERAL, so plain memory barriers order the levels. The first one waits for culling to finish sampling the old contents
+	VkMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_NONE;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.memoryBarrierCount = 1;
+	dependencyInfo.pMemoryBarriers = &barrier;
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_reducePipeline);
+
+	//Each level is written by one dispatch and read by the next
+	barrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+	VkExtent2D sourceExtents = m_depthExtents;
+	VkExtent2D destinationExtents = m_resources.extents;
+	for (uint32_t level = 0; level < m_resources.mipLevels; ++level) {
+		VkDescriptorSet set = level == 0 ? m_resources.depthReduceSets[depthIndex] : m_resources.mipReduceSets[level - 1];
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_reducePipelineLayout, 0, 1, &set, 0, nullptr);
+
+		HiZReduceConstants constants{};
+		constants.sourceWidth = static_cast<int32_t>(sourceExtents.width);
+		constants.sourceHeight = static_cast<int32_t>(sourceExtents.height);
+		constants.destinationWidth = static_cast<int32_t>(destinationExtents.width);
+		constants.destinationHeight = static_cast<int32_t>(destinationExtents.height);
+		constants.reversedDepth = m_bReversedDepth ? 1 : 0;
+		vkCmdPushConstants(commandBuffer, m_reducePipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZReduceConstants), &constants);
+
+		vkCmdDispatch(commandBuffer, (destinationExtents.width + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (destinationExtents.height + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+		vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+		sourceExtents = destinationExtents;
+		destinationExtents.width = std::max(destinationExtents.width / 2, 1u);
+		destinationExtents.height = std::max(destinationExtents.height / 2, 1u);
+	}
+}
+
+///////////////////////////////////////////
+VkDescriptorSetLayout VulkanHiZPyramid::GetCullingDescriptorSetLayout() const
+{
+	return m_cullingSetLayout;
+}
+
+///////////////////////////////////////////
+VkDescriptorSet VulkanHiZPyramid::GetCullingDescriptorSet() const
+{
+	return m_resources.cullingSet;
+}
+
+///////////////////////////////////////////
+VkExtent2D VulkanHiZPyramid::GetExtents() const
+{
+	return m_resources.extents;
+}
+
+///////////////////////////////////////////
+uint32_t VulkanHiZPyramid::GetMipLevels() const
+{
+	return m_resources.mipLevels;
+}
+
+///////////////////////////////////////////
+bool VulkanHiZPyramid::IsReversedDepth() const
+{
+	return m_bReversedDepth;
+}
+
+///////////////////////////////////////////
+void VulkanHiZPyramid::CreateLayouts()
+{
+	VkDevice logicalDevice = m_pDevice->GetLogicalDevice();
+
+	//Nearest so a sample returns exactly one texel's farthest depth, never a blend that could be nearer than the truth
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	if (vkCreateSampler(logicalDevice, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Hi-Z sampler!");
+	}
+
+	//0: source (depth or the previous level), 1: destination level
+	VkDescriptorSetLayoutBinding reduceBindings[2]{};
+	reduceBindings[0].binding = 0;
+	reduceBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	reduceBindings[0].descriptorCount = 1;
+	reduceBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	reduceBindings[1].binding = 1;
+	reduceBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	reduceBindings[1].descriptorCount = 1;
+	reduceBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 2;
+	layoutInfo.pBindings = reduceBindings;
+
+	if (vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &m_reduceSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Hi-Z reduce descriptor set layout!");
+	}
+
+	VkDescriptorSetLayoutBinding cullingBinding{};
+	cullingBinding.binding = 0;
+	cullingBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	cullingBinding.descriptorCount = 1;
+	cullingBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &cullingBinding;
+
+	if (vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, nullptr, &m_cullingSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Hi-Z culling descriptor set layout!");
+	}
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(HiZReduceConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_reduceSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &m_reducePipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Hi-Z pipeline layout!");
+	}
+}
+
+///////////////////////////////////////////
+void VulkanHiZPyramid::CreateImage(PyramidResources& resources, VkExtent2D depthExtents)
+{
+	VkDevice logicalDevice = m_pDevice->GetLogicalDevice();
+
+	//Rounding down keeps every level an exact halving of the one above, level 0 texels cover a little more than one depth texel
+	resources.extents.width = PreviousPowerOfTwo(std::max(depthExtents.width, 1u));
+	resources.extents.height = PreviousPowerOfTwo(std::max(depthExtents.height, 1u));
+	resources.mipLevels = 1;
+	while ((std::max(resources.extents.width, resources.extents.height) >> resources.mipLevels) > 0) {
+		resources.mipLevels++;
+	}
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = VK_FORMAT_R32_SFLOAT;
+	imageInfo.extent = { resources.extents.width, resources.extents.height, 1 };
+	imageInfo.mipLevels = resources.mipLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(logicalDevice, &imageInfo, nullptr, &resources.image) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Hi-Z image!");
+	}
+
+	resources.memory = m_pDevice->GetMemoryAllocator().AllocateForImage(resources.image, imageInfo.tiling, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = resources.image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R32_SFLOAT;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = resources.mipLevels;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(logicalDevice, &viewInfo, nullptr, &resources.fullView) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Hi-Z image view!");
+	}
+
+	//Single level views, storage images can only be written through one level at a time
+	resources.mipViews.resize(resources.mipLevels);
+	viewInfo.subresourceRange.levelCount = 1;
+	for (uint32_t level = 0; level < resources.mipLevels; ++level) {
+		viewInfo.subresourceRange.baseMipLevel = level;
+		if (vkCreateImageView(logicalDevice, &viewInfo, nullptr, &resources.mipViews[level]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Hi-Z mip view!");
+		}
+	}
+}
+
+///////////////////////////////////////////
+void VulkanHiZPyramid::CreateDescriptorSets(PyramidResources& resources, const std::vector<VkImageView>& depthViews)
+{
+	VkDevice logicalDevice = m_pDevice->GetLogicalDevice();
+
+	uint32_t reduceSetCount = static_cast<uint32_t>(depthViews.size()) + resources.mipLevels - 1;
+
+	VkDescriptorPoolSize poolSizes[2]{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = reduceSetCount + 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = reduceSetCount;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = reduceSetCount + 1;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(logicalDevice, &poolInfo, nullptr, &resources.descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Hi-Z descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> reduceLayouts(reduceSetCount, m_reduceSetLayout);
+	std::vector<VkDescriptorSet> reduceSets(reduceSetCount);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = resources.descriptorPool;
+	allocInfo.descriptorSetCount = reduceSetCount;
+	allocInfo.pSetLayouts = reduceLayouts.data();
+
+	if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, reduceSets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate Hi-Z descriptor sets!");
+	}
+
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &m_cullingSetLayout;
+	if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &resources.cullingSet) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate Hi-Z descriptor sets!");
+	}
+
+	resources.depthReduceSets.assign(reduceSets.begin(), reduceSets.begin() + depthViews.size());
+	resources.mipReduceSets.assign(reduceSets.begin() + depthViews.size(), reduceSets.end());
+
+	for (size_t i = 0; i < depthViews.size(); ++i) {
+		WriteReduceSet(resources.depthReduceSets[i], depthViews[i], VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, resources.mipViews[0]);
+	}
+	for (uint32_t level = 1; level < resources.mipLevels; ++level) {
+		WriteReduceSet(resources.mipReduceSets[level - 1], resources.mipViews[level - 1], VK_IMAGE_LAYOUT_GENERAL, resources.mipViews[level]);
+	}
+
+	VkDescriptorImageInfo pyramidInfo{};
+	pyramidInfo.sampler = m_sampler;
+	pyramidInfo.imageView = resources.fullView;
+	pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = resources.cullingSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &pyramidInfo;
+	vkUpdateDescriptorSets(logicalDevice, 1, &write, 0, nullptr);
+}
+
+///////////////////////////////////////////
+void VulkanHiZPyramid::WriteReduceSet(VkDescriptorSet set, VkImageView source, VkImageLayout sourceLayout, VkImageView destination)
+{
+	VkDescriptorImageInfo sourceInfo{};
+	sourceInfo.sampler = m_sampler;
+	sourceInfo.imageView = source;
+	sourceInfo.imageLayout = sourceLayout;
+
+	VkDescriptorImageInfo destinationInfo{};
+	destinationInfo.imageView = destination;
+	destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkWriteDescriptorSet writes[2]{};
+	writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writes[0].dstSet = set;
+	writes[0].dstBinding = 0;
+	writes[0].descriptorCount = 1;
+	writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	writes[0].pImageInfo = &sourceInfo;
+
+	writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writes[1].dstSet = set;
+	writes[1].dstBinding = 1;
+	writes[1].descriptorCount = 1;
+	writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	writes[1].pImageInfo = &destinationInfo;
+
+	vkUpdateDescriptorSets(m_pDevice->GetLogicalDevice(), 2, writes, 0, nullptr);
+}
+
+///////////////////////////////////////////
+void VulkanHiZPyramid::DestroyResources(PyramidResources& resources)
+{
+	if (resources.image == VK_NULL_HANDLE) {
+		return;
+	}
+
+	//Destroying the pool frees its sets
+	VkDevice logicalDevice = m_pDevice->GetLogicalDevice();
+	vkDestroyDescriptorPool(logicalDevice, resources.descriptorPool, nullptr);
+	for (VkImageView view : resources.mipViews) {
+		vkDestroyImageView(logicalDevice, view, nullptr);
+	}
+	vkDestroyImageView(logicalDevice, resources.fullView, nullptr);
+	vkDestroyImage(logicalDevice, resources.image, nullptr);
+	m_pDevice->GetMemoryAllocator().Free(resources.memory);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+#include "VulkanTimeline.h"
+#include "VulkanPipelineLibrary.h"
+
+#include <vector>
+
+///////////////////////////////////////////
+//Hierarchical Z buffer. A compute pass reduces a depth image into an R32_SFLOAT mip chain where every texel holds the farthest depth under it,
+//so an object's bounds can be tested against the whole area they cover with four samples of the right mip.
+//Level 0 is the depth size rounded down to a power of two, each level halves it down to 1x1. With reversed depth the farthest value is the smallest, so the reduction takes the minimum
+class VulkanHiZPyramid
+{
+public:
+	void InitHiZPyramid(VulkanDevice* pDevice, VulkanPipelineLibrary* pPipelineLibrary, VulkanTimeline* pGraphicsTimeline, bool bReversedDepth = false);
+	void DestroyHiZPyramid();
+
+	//Builds the pyramid for a new set of depth images, any previous pyramid is retired once the GPU has passed the last submitted value.
+	//The new pyramid's contents are undefined until RecordInitialize() has run
+	void ResizePyramid(VkExtent2D depthExtents, const std::vector<VkImageView>& depthViews);
+	//Moves the pyramid to the GENERAL layout it always stays in and clears it to the far plane, so nothing is occluded until the first build
+	void RecordInitialize(VkCommandBuffer commandBuffer);
+
+	//Reduces depth image depthIndex into the pyramid. The depth must be in DEPTH_STENCIL_READ_ONLY_OPTIMAL with its writes made visible to compute,
+	//afterwards the pyramid is ready to be sampled by compute shaders
+	void RecordBuild(VkCommandBuffer commandBuffer, uint32_t depthIndex);
+
+	//Binding 0 is the whole mip chain as a combined image sampler with nearest filtering, for culling shaders
+	VkDescriptorSetLayout GetCullingDescriptorSetLayout() const;
+	VkDescriptorSet GetCullingDescriptorSet() const;
+
+	VkExtent2D GetExtents() const;
+	uint32_t GetMipLevels() const;
+	bool IsReversedDepth() const;
+
+private:
+	//Everything that depends on the depth size, replaced as a whole on resize
+	struct PyramidResources {
+		VkImage image = VK_NULL_HANDLE;
+		MemoryAllocation memory;
+		VkImageView fullView = VK_NULL_HANDLE;
+		std::vector<VkImageView> mipViews;
+		VkExtent2D extents{};
+		uint32_t mipLevels = 0;
+
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> depthReduceSets; //Depth image i into level 0
+		std::vector<VkDescriptorSet> mipReduceSets;   //Level i into level i + 1
+		VkDescriptorSet cullingSet = VK_NULL_HANDLE;
+	};
+
+	void CreateLayouts();
+	void CreateImage(PyramidResources& resources, VkExtent2D depthExtents);
+	void CreateDescriptorSets(PyramidResources& resources, const std::vector<VkImageView>& depthViews);
+	void WriteReduceSet(VkDescriptorSet set, VkImageView source, VkImageLayout sourceLayout, VkImageView destination);
+	void DestroyResources(PyramidResources& resources);
+
+private:
+	VulkanDevice* m_pDevice = nullptr;
+	VulkanTimeline* m_pGraphicsTimeline = nullptr;
+	bool m_bReversedDepth = false;
+
+	VkSampler m_sampler = VK_NULL_HANDLE;
+	VkDescriptorSetLayout m_reduceSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout m_cullingSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout m_reducePipelineLayout = VK_NULL_HANDLE;
+	VkPipeline m_reducePipeline = VK_NULL_HANDLE; //Owned by the pipeline library
+
+	PyramidResources m_resources;
+	VkExtent2D m_depthExtents{};
+};
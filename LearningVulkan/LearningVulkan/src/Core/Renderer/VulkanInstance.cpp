@@ -21,7 +21,7 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(
 }
 
 ///////////////////////////////////////////
-void VulkanInstance::CreateInstance(const char* pApplicationName)
+void VulkanInstance::CreateInstance(const char* pApplicationName, bool bHeadless)
 {
 	//We need to create these information structs to tell Vulkan information about our program. 
 	VkApplicationInfo appInfo{};
@@ -36,7 +36,7 @@ void VulkanInstance::CreateInstance(const char* pApplicationName)
 	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	createInfo.pApplicationInfo = &appInfo;
 
-	auto extensions = GetRequiredExtensions();
+	auto extensions = GetRequiredExtensions(bHeadless);
 	if (!ValidateInstanceExtensionSupport(extensions)) {
 		std::cerr << "Required Extensions are not supported by instance!\n";
 	}
@@ -107,13 +107,17 @@ VkInstance VulkanInstance::GetInstanceObject() const
 }
 
 ///////////////////////////////////////////
-std::vector<const char*> VulkanInstance::GetRequiredExtensions()
+std::vector<const char*> VulkanInstance::GetRequiredExtensions(bool bHeadless)
 {
-	uint32_t extensionCount = 0;
-	const char** glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&extensionCount);
+	std::vector<const char*> extensions;
+
+	if (!bHeadless) {
+		uint32_t extensionCount = 0;
+		const char** glfwExtensions;
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&extensionCount);
 
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + extensionCount);
+		extensions.assign(glfwExtensions, glfwExtensions + extensionCount);
+	}
 
 	if (VulkanValidationLayer::IsValidationLayerEnabled()) { //Allows our debugging utils to be added when we are running a development build
 		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -8,7 +8,8 @@
 class VulkanInstance
 {
 public:
-	void CreateInstance(const char* pApplicationName);
+	//Headless instances do not ask GLFW for its surface extensions, so GLFW does not need to be initialized
+	void CreateInstance(const char* pApplicationName, bool bHeadless = false);
 	void DestroyDebugMessenger();
 	void DestroyInstance();
 
@@ -20,7 +21,7 @@ private:
 	void OutputSupportedExtensions();
 	bool ValidateInstanceExtensionSupport(const std::vector<const char*>& extensions);
 	bool ValidateValidationLayersSupport();
-	std::vector<const char*> GetRequiredExtensions();
+	std::vector<const char*> GetRequiredExtensions(bool bHeadless);
 
 private:
 	VkInstance m_instance;
@@ -0,0 +1,477 @@
+#include "VulkanMemoryAllocator.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <algorithm>
+
+///////////////////////////////////////////
+//Smallest power of two that is at least value
+static VkDeviceSize NextPowerOfTwo(VkDeviceSize value)
+{
+	VkDeviceSize result = 1;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
+///////////////////////////////////////////
+static uint32_t Log2(VkDeviceSize value)
+{
+	uint32_t result = 0;
+	while (value > 1) {
+		value >>= 1;
+		result++;
+	}
+	return result;
+}
+
+///////////////////////////////////////////
+void VulkanMemoryAllocator::InitMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkDeviceSize blockSize)
+{
+	m_logicalDevice = logicalDevice;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	m_bufferImageGranularity = properties.limits.bufferImageGranularity;
+	m_maxDeviceAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+	//Every range starts and ends on a multiple of MIN_ALLOCATION_SIZE, so a granularity no bigger than that can never put a buffer and an optimal image on the same page
+	m_bSeparateOptimalPools = m_bufferImageGranularity > MIN_ALLOCATION_SIZE;
+
+	//Small heaps (such as the 256MB host visible device local heap on many GPUs) get smaller blocks so one block cannot take most of the heap
+	VkDeviceSize defaultBlockSize = NextPowerOfTwo(std::max(blockSize, MIN_ALLOCATION_SIZE));
+	for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; ++i) {
+		VkDeviceSize heapBlockSize = defaultBlockSize;
+		while (heapBlockSize > m_memoryProperties.memoryHeaps[i].size / 8 && heapBlockSize > MIN_ALLOCATION_SIZE * 1024) {
+			heapBlockSize >>= 1;
+		}
+		m_blockSizes[i] = heapBlockSize;
+	}
+
+	m_pools.clear();
+	m_pools.resize(static_cast<size_t>(m_memoryProperties.memoryTypeCount) * 2);
+	m_deviceAllocationCount = 0;
+}
+
+///////////////////////////////////////////
+void VulkanMemoryAllocator::DestroyMemoryAllocator()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	size_t leakedAllocations = 0;
+	for (auto& pool : m_pools) {
+		for (auto& pBlock : pool) {
+			leakedAllocations += pBlock->allocations.size();
+			DestroyBlock(pBlock.get());
+		}
+		pool.clear();
+	}
+
+	if (leakedAllocations > 0) {
+		std::cerr << leakedAllocations << " device memory allocations were not freed before the allocator was destroyed\n";
+	}
+}
+
+///////////////////////////////////////////
+MemoryAllocation VulkanMemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool bLinear)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	uint32_t memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, properties);
+	uint32_t heapIndex = m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	VkDeviceSize blockSize = m_blockSizes[heapIndex];
+
+	std::vector<std::unique_ptr<MemoryBlock>>& pool = m_pools[GetPoolIndex(memoryTypeIndex, bLinear)];
+
+	MemoryBlock* pBlock = nullptr;
+	VkDeviceSize offset = 0;
+	uint32_t order = 0;
+
+	//Ranges are aligned to their own size, so rounding up to the alignment covers it
+	VkDeviceSize rangeSize = NextPowerOfTwo(std::max({ requirements.size, requirements.alignment, MIN_ALLOCATION_SIZE }));
+	if (rangeSize > blockSize / 2) {
+		//Would waste most of a block, allocated on its own instead
+		pool.push_back(CreateBlock(memoryTypeIndex, requirements.size, bLinear, true));
+		pBlock = pool.back().get();
+		pBlock->allocations[0] = 0;
+		pBlock->allocatedBytes = requirements.size;
+	}
+	else {
+		order = Log2(rangeSize / MIN_ALLOCATION_SIZE);
+
+		for (auto& pCandidate : pool) {
+			if (!pCandidate->bDedicated && AllocateFromBlock(pCandidate.get(), order, offset)) {
+				pBlock = pCandidate.get();
+				break;
+			}
+		}
+
+		if (pBlock == nullptr) {
+			pool.push_back(CreateBlock(memoryTypeIndex, blockSize, bLinear, false));
+			pBlock = pool.back().get();
+			AllocateFromBlock(pBlock, order, offset);
+		}
+	}
+
+	pBlock->requestedBytes += requirements.size;
+
+	MemoryAllocation allocation{};
+	allocation.memory = pBlock->memory;
+	allocation.offset = offset;
+	allocation.size = requirements.size;
+	allocation.pMappedData = pBlock->pMappedData != nullptr ? static_cast<uint8_t*>(pBlock->pMappedData) + offset : nullptr;
+	allocation.pBlock = pBlock;
+	allocation.order = order;
+	return allocation;
+}
+
+///////////////////////////////////////////
+MemoryAllocation VulkanMemoryAllocator::AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties)
+{
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(m_logicalDevice, buffer, &memoryRequirements);
+
+	MemoryAllocation allocation = Allocate(memoryRequirements, properties, true);
+	vkBindBufferMemory(m_logicalDevice, buffer, allocation.memory, allocation.offset);
+	return allocation;
+}
+
+///////////////////////////////////////////
+MemoryAllocation VulkanMemoryAllocator::AllocateForImage(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties)
+{
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(m_logicalDevice, image, &memoryRequirements);
+
+	MemoryAllocation allocation = Allocate(memoryRequirements, properties, tiling == VK_IMAGE_TILING_LINEAR);
+	vkBindImageMemory(m_logicalDevice, image, allocation.memory, allocation.offset);
+	return allocation;
+}
+
+///////////////////////////////////////////
+void VulkanMemoryAllocator::Free(MemoryAllocation& allocation)
+{
+	if (allocation.pBlock == nullptr) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	MemoryBlock* pBlock = allocation.pBlock;
+	pBlock->requestedBytes -= allocation.size;
+
+	if (pBlock->bDedicated) {
+		pBlock->allocations.clear();
+	}
+	else {
+		FreeToBlock(pBlock, allocation.offset, allocation.order);
+	}
+
+	//Empty blocks are given back to the driver, except the last one in the pool so a free followed by an allocate does not thrash vkAllocateMemory
+	std::vector<std::unique_ptr<MemoryBlock>>& pool = m_pools[GetPoolIndex(pBlock->memoryTypeIndex, pBlock->bLinear)];
+	size_t sharedBlockCount = std::count_if(pool.begin(), pool.end(), [](const std::unique_ptr<MemoryBlock>& pCandidate) { return !pCandidate->bDedicated; });
+	if (pBlock->allocations.empty() && (pBlock->bDedicated || sharedBlockCount > 1)) {
+		DestroyBlock(pBlock);
+		pool.erase(std::find_if(pool.begin(), pool.end(), [pBlock](const std::unique_ptr<MemoryBlock>& pCandidate) { return pCandidate.get() == pBlock; }));
+	}
+
+	allocation = MemoryAllocation();
+}
+
+///////////////////////////////////////////
+MemoryAllocation VulkanMemoryAllocator::AllocateForRelocation(const MemoryAllocation& allocation)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	MemoryBlock* pSource = allocation.pBlock;
+	if (pSource == nullptr || pSource->bDedicated) {
+		return MemoryAllocation();
+	}
+
+	//Moving strictly from sparser to denser blocks means the sparse ones drain and repeated passes always settle
+	MemoryBlock* pBlock = nullptr;
+	VkDeviceSize offset = 0;
+	std::vector<std::unique_ptr<MemoryBlock>>& pool = m_pools[GetPoolIndex(pSource->memoryTypeIndex, pSource->bLinear)];
+
+	std::vector<MemoryBlock*> candidates;
+	for (auto& pCandidate : pool) {
+		if (!pCandidate->bDedicated && pCandidate.get() != pSource && pCandidate->allocatedBytes > pSource->allocatedBytes) {
+			candidates.push_back(pCandidate.get());
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const MemoryBlock* pA, const MemoryBlock* pB) { return pA->allocatedBytes > pB->allocatedBytes; });
+
+	for (MemoryBlock* pCandidate : candidates) {
+		if (AllocateFromBlock(pCandidate, allocation.order, offset)) {
+			pBlock = pCandidate;
+			break;
+		}
+	}
+
+	if (pBlock == nullptr) {
+		return MemoryAllocation();
+	}
+
+	pBlock->requestedBytes += allocation.size;
+
+	MemoryAllocation relocated{};
+	relocated.memory = pBlock->memory;
+	relocated.offset = offset;
+	relocated.size = allocation.size;
+	relocated.pMappedData = pBlock->pMappedData != nullptr ? static_cast<uint8_t*>(pBlock->pMappedData) + offset : nullptr;
+	relocated.pBlock = pBlock;
+	relocated.order = allocation.order;
+	return relocated;
+}
+
+///////////////////////////////////////////
+double VulkanMemoryAllocator::GetBlockUsage(const MemoryAllocation& allocation) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (allocation.pBlock == nullptr || allocation.pBlock->bDedicated) {
+		return 1.0;
+	}
+	return static_cast<double>(allocation.pBlock->allocatedBytes) / allocation.pBlock->size;
+}
+
+///////////////////////////////////////////
+uint32_t VulkanMemoryAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	//typeFilter is a bitmask of the memory types the resource can live in, we want the first of those that has every requested property
+	for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+		if ((typeFilter & (1 << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+
+	throw std::runtime_error("Failed to find a suitable memory type!");
+}
+
+///////////////////////////////////////////
+std::vector<MemoryHeapStatistics> VulkanMemoryAllocator::GetHeapStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::vector<MemoryHeapStatistics> heaps(m_memoryProperties.memoryHeapCount);
+	for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; ++i) {
+		heaps[i].heapIndex = i;
+		heaps[i].heapSize = m_memoryProperties.memoryHeaps[i].size;
+		heaps[i].bDeviceLocal = (m_memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+	}
+
+	for (const auto& pool : m_pools) {
+		for (const auto& pBlock : pool) {
+			MemoryHeapStatistics& heap = heaps[m_memoryProperties.memoryTypes[pBlock->memoryTypeIndex].heapIndex];
+			if (pBlock->bDedicated) {
+				heap.dedicatedAllocationCount++;
+			}
+			else {
+				heap.blockCount++;
+			}
+			heap.allocationCount += static_cast<uint32_t>(pBlock->allocations.size());
+			heap.blockBytes += pBlock->size;
+			heap.allocatedBytes += pBlock->allocatedBytes;
+			heap.requestedBytes += pBlock->requestedBytes;
+		}
+	}
+
+	return heaps;
+}
+
+///////////////////////////////////////////
+std::vector<MemoryFragmentationReport> VulkanMemoryAllocator::GetFragmentationReport() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::vector<MemoryFragmentationReport> reports;
+	for (size_t poolIndex = 0; poolIndex < m_pools.size(); ++poolIndex) {
+		MemoryFragmentationReport report{};
+		report.memoryTypeIndex = static_cast<uint32_t>(poolIndex / 2);
+		report.bLinear = poolIndex % 2 == 0;
+
+		//Dedicated allocations have no free space and no rounding, they would only hide the state of the shared blocks
+		VkDeviceSize allocatedBytes = 0;
+		VkDeviceSize requestedBytes = 0;
+		for (const auto& pBlock : m_pools[poolIndex]) {
+			if (pBlock->bDedicated) {
+				continue;
+			}
+
+			report.blockCount++;
+			allocatedBytes += pBlock->allocatedBytes;
+			requestedBytes += pBlock->requestedBytes;
+
+			for (uint32_t order = 0; order <= pBlock->maxOrder; ++order) {
+				VkDeviceSize rangeSize = MIN_ALLOCATION_SIZE << order;
+				report.freeRangeCount += static_cast<uint32_t>(pBlock->freeLists[order].size());
+				report.freeBytes += rangeSize * pBlock->freeLists[order].size();
+				if (!pBlock->freeLists[order].empty()) {
+					report.largestFreeRange = std::max(report.largestFreeRange, rangeSize);
+				}
+			}
+		}
+
+		if (report.blockCount == 0) {
+			continue;
+		}
+
+		report.externalFragmentation = report.freeBytes > 0 ? 1.0 - static_cast<double>(report.largestFreeRange) / report.freeBytes : 0.0;
+		report.internalFragmentation = allocatedBytes > 0 ? 1.0 - static_cast<double>(requestedBytes) / allocatedBytes : 0.0;
+		reports.push_back(report);
+	}
+
+	return reports;
+}
+
+///////////////////////////////////////////
+uint32_t VulkanMemoryAllocator::GetDeviceAllocationCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_deviceAllocationCount;
+}
+
+///////////////////////////////////////////
+void VulkanMemoryAllocator::WriteJson(JsonWriter& writer) const
+{
+	writer.Write("deviceAllocations", GetDeviceAllocationCount());
+	writer.Write("maxDeviceAllocations", m_maxDeviceAllocationCount);
+	writer.Write("bufferImageGranularity", static_cast<uint64_t>(m_bufferImageGranularity));
+
+	writer.BeginArray("heaps");
+	for (const auto& heap : GetHeapStatistics()) {
+		writer.BeginObject();
+		writer.Write("heapIndex", heap.heapIndex);
+		writer.Write("heapSize", static_cast<uint64_t>(heap.heapSize));
+		writer.Write("deviceLocal", heap.bDeviceLocal);
+		writer.Write("blocks", heap.blockCount);
+		writer.Write("dedicatedAllocations", heap.dedicatedAllocationCount);
+		writer.Write("allocations", heap.allocationCount);
+		writer.Write("blockBytes", static_cast<uint64_t>(heap.blockBytes));
+		writer.Write("allocatedBytes", static_cast<uint64_t>(heap.allocatedBytes));
+		writer.Write("requestedBytes", static_cast<uint64_t>(heap.requestedBytes));
+		writer.EndObject();
+	}
+	writer.EndArray();
+
+	writer.BeginArray("pools");
+	for (const auto& report : GetFragmentationReport()) {
+		writer.BeginObject();
+		writer.Write("memoryTypeIndex", report.memoryTypeIndex);
+		writer.Write("linear", report.bLinear);
+		writer.Write("blocks", report.blockCount);
+		writer.Write("freeBytes", static_cast<uint64_t>(report.freeBytes));
+		writer.Write("largestFreeRange", static_cast<uint64_t>(report.largestFreeRange));
+		writer.Write("freeRanges", report.freeRangeCount);
+		writer.Write("externalFragmentation", report.externalFragmentation);
+		writer.Write("internalFragmentation", report.internalFragmentation);
+		writer.EndObject();
+	}
+	writer.EndArray();
+}
+
+///////////////////////////////////////////
+std::unique_ptr<MemoryBlock> VulkanMemoryAllocator::CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool bLinear, bool bDedicated)
+{
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	std::unique_ptr<MemoryBlock> pBlock = std::make_unique<MemoryBlock>();
+	if (vkAllocateMemory(m_logicalDevice, &allocInfo, nullptr, &pBlock->memory) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate device memory block!");
+	}
+	m_deviceAllocationCount++;
+
+	if (m_deviceAllocationCount == m_maxDeviceAllocationCount) {
+		std::cerr << "Device memory allocations have reached maxMemoryAllocationCount (" << m_maxDeviceAllocationCount << ")\n";
+	}
+
+	pBlock->size = size;
+	pBlock->memoryTypeIndex = memoryTypeIndex;
+	pBlock->bLinear = bLinear;
+	pBlock->bDedicated = bDedicated;
+
+	//Host visible blocks are mapped once for their whole lifetime, every allocation in them just offsets the pointer
+	if (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		if (vkMapMemory(m_logicalDevice, pBlock->memory, 0, VK_WHOLE_SIZE, 0, &pBlock->pMappedData) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to map device memory block!");
+		}
+	}
+
+	if (!bDedicated) {
+		pBlock->maxOrder = Log2(size / MIN_ALLOCATION_SIZE);
+		pBlock->freeLists.resize(pBlock->maxOrder + 1);
+		pBlock->freeLists[pBlock->maxOrder].insert(0);
+	}
+
+	return pBlock;
+}
+
+///////////////////////////////////////////
+void VulkanMemoryAllocator::DestroyBlock(MemoryBlock* pBlock)
+{
+	//Freeing the memory implicitly unmaps it
+	vkFreeMemory(m_logicalDevice, pBlock->memory, nullptr);
+	pBlock->memory = VK_NULL_HANDLE;
+	m_deviceAllocationCount--;
+}
+
+///////////////////////////////////////////
+bool VulkanMemoryAllocator::AllocateFromBlock(MemoryBlock* pBlock, uint32_t order, VkDeviceSize& offset)
+{
+	if (order > pBlock->maxOrder) {
+		return false;
+	}
+
+	//Take the smallest free range that fits and split it in halves until it is the right size, the upper halves stay free
+	uint32_t freeOrder = order;
+	while (freeOrder <= pBlock->maxOrder && pBlock->freeLists[freeOrder].empty()) {
+		freeOrder++;
+	}
+
+	if (freeOrder > pBlock->maxOrder) {
+		return false;
+	}
+
+	offset = *pBlock->freeLists[freeOrder].begin();
+	pBlock->freeLists[freeOrder].erase(pBlock->freeLists[freeOrder].begin());
+
+	while (freeOrder > order) {
+		freeOrder--;
+		pBlock->freeLists[freeOrder].insert(offset + (MIN_ALLOCATION_SIZE << freeOrder));
+	}
+
+	pBlock->allocations[offset] = order;
+	pBlock->allocatedBytes += MIN_ALLOCATION_SIZE << order;
+	return true;
+}
+
+///////////////////////////////////////////
+void VulkanMemoryAllocator::FreeToBlock(MemoryBlock* pBlock, VkDeviceSize offset, uint32_t order)
+{
+	pBlock->allocations.erase(offset);
+	pBlock->allocatedBytes -= MIN_ALLOCATION_SIZE << order;
+
+	//Merge with the buddy for as long as it is free, the buddy of a range differs from it only in the bit of the range's size
+	while (order < pBlock->maxOrder) {
+		VkDeviceSize buddyOffset = offset ^ (MIN_ALLOCATION_SIZE << order);
+		if (pBlock->freeLists[order].erase(buddyOffset) == 0) {
+			break;
+		}
+
+		offset = std::min(offset, buddyOffset);
+		order++;
+	}
+
+	pBlock->freeLists[order].insert(offset);
+}
+
+///////////////////////////////////////////
+size_t VulkanMemoryAllocator::GetPoolIndex(uint32_t memoryTypeIndex, bool bLinear) const
+{
+	bool bOptimalPool = m_bSeparateOptimalPools && !bLinear;
+	return static_cast<size_t>(memoryTypeIndex) * 2 + (bOptimalPool ? 1 : 0);
+}
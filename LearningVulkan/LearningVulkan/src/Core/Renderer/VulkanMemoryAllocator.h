@@ -0,0 +1,141 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "../Profiling/JsonWriter.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+///////////////////////////////////////////
+//Smallest range the allocator hands out, every size class is this doubled some number of times
+constexpr VkDeviceSize MIN_ALLOCATION_SIZE = 256;
+//Blocks are this big unless the heap is small, anything over half a block gets its own dedicated vkAllocateMemory
+constexpr VkDeviceSize DEFAULT_MEMORY_BLOCK_SIZE = 64 * 1024 * 1024;
+
+struct MemoryBlock;
+
+///////////////////////////////////////////
+//A range of device memory handed out by VulkanMemoryAllocator, resources are bound to memory at offset
+struct MemoryAllocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0; //What was asked for, the range reserved is rounded up to its size class
+	void* pMappedData = nullptr; //Already offset, null unless the memory is host visible
+
+	MemoryBlock* pBlock = nullptr;
+	uint32_t order = 0; //Size class, the reserved range is MIN_ALLOCATION_SIZE << order
+
+	bool IsValid() const {
+		return memory != VK_NULL_HANDLE;
+	}
+};
+
+///////////////////////////////////////////
+//One VkDeviceMemory split into power of two ranges with a buddy scheme. Ranges are aligned to their own size, so any power of two alignment up to the range size comes for free
+struct MemoryBlock {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize size = 0;
+	void* pMappedData = nullptr;
+	uint32_t memoryTypeIndex = 0;
+	bool bLinear = true; //Buffers and linear images, kept apart from optimal images when bufferImageGranularity requires it
+	bool bDedicated = false; //A single allocation with no buddy bookkeeping
+
+	uint32_t maxOrder = 0;
+	std::vector<std::set<VkDeviceSize>> freeLists; //Free range offsets per order, kept sorted so the lowest address is reused first
+	std::map<VkDeviceSize, uint32_t> allocations; //Live range offset to order
+
+	VkDeviceSize allocatedBytes = 0;
+	VkDeviceSize requestedBytes = 0;
+};
+
+///////////////////////////////////////////
+struct MemoryHeapStatistics {
+	uint32_t heapIndex = 0;
+	VkDeviceSize heapSize = 0;
+	bool bDeviceLocal = false;
+
+	uint32_t blockCount = 0;
+	uint32_t dedicatedAllocationCount = 0;
+	uint32_t allocationCount = 0;
+
+	VkDeviceSize blockBytes = 0; //Reserved from the driver
+	VkDeviceSize allocatedBytes = 0; //Handed out, including rounding up to a size class
+	VkDeviceSize requestedBytes = 0;
+};
+
+///////////////////////////////////////////
+//Free space of one pool, a memory type plus whether it holds linear or optimal resources
+struct MemoryFragmentationReport {
+	uint32_t memoryTypeIndex = 0;
+	bool bLinear = true; //Always true when linear and optimal resources share blocks
+	uint32_t blockCount = 0;
+
+	VkDeviceSize freeBytes = 0;
+	VkDeviceSize largestFreeRange = 0;
+	uint32_t freeRangeCount = 0;
+
+	double externalFragmentation = 0.0; //1 - largestFreeRange / freeBytes, 0 when all free space could serve a single allocation
+	double internalFragmentation = 0.0; //Share of allocated bytes lost to rounding up to a size class
+};
+
+///////////////////////////////////////////
+//Sub-allocates buffers and images from large blocks per memory type so the renderer stays far below maxMemoryAllocationCount.
+//Owned by VulkanDevice, every method is safe to call from any thread.
+class VulkanMemoryAllocator
+{
+public:
+	void InitMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkDeviceSize blockSize = DEFAULT_MEMORY_BLOCK_SIZE);
+	//Reports anything still allocated to std::cerr before freeing every block
+	void DestroyMemoryAllocator();
+
+	//bLinear is false only for images with optimal tiling
+	MemoryAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool bLinear);
+	//Allocate and bind in one go
+	MemoryAllocation AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties);
+	MemoryAllocation AllocateForImage(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties);
+	//Resets the allocation, its range can be handed out again straight away so the GPU must be done with it
+	void Free(MemoryAllocation& allocation);
+
+	//For the defragmenter. Reserves a range of the same size class in the fullest block of the pool that is fuller than the allocation's own, never creating a block.
+	//Returns an invalid allocation when there is nowhere denser to move to
+	MemoryAllocation AllocateForRelocation(const MemoryAllocation& allocation);
+	//Share of the allocation's block currently handed out, 1 for dedicated allocations
+	double GetBlockUsage(const MemoryAllocation& allocation) const;
+
+	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+	std::vector<MemoryHeapStatistics> GetHeapStatistics() const;
+	std::vector<MemoryFragmentationReport> GetFragmentationReport() const;
+	//Live vkAllocateMemory calls, compare with maxMemoryAllocationCount
+	uint32_t GetDeviceAllocationCount() const;
+	void WriteJson(JsonWriter& writer) const;
+
+private:
+	std::unique_ptr<MemoryBlock> CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool bLinear, bool bDedicated);
+	void DestroyBlock(MemoryBlock* pBlock);
+
+	//Returns false when the block has no free range of the order
+	bool AllocateFromBlock(MemoryBlock* pBlock, uint32_t order, VkDeviceSize& offset);
+	void FreeToBlock(MemoryBlock* pBlock, VkDeviceSize offset, uint32_t order);
+
+	//Linear and optimal resources only share blocks when no two size classes can ever share a bufferImageGranularity page
+	size_t GetPoolIndex(uint32_t memoryTypeIndex, bool bLinear) const;
+
+private:
+	VkDevice m_logicalDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+	VkDeviceSize m_bufferImageGranularity = 1;
+	uint32_t m_maxDeviceAllocationCount = 0;
+	VkDeviceSize m_blockSizes[VK_MAX_MEMORY_HEAPS] = {};
+	bool m_bSeparateOptimalPools = false;
+
+	std::vector<std::vector<std::unique_ptr<MemoryBlock>>> m_pools; //[memory type * 2 + optimal]
+	uint32_t m_deviceAllocationCount = 0;
+
+	mutable std::mutex m_mutex;
+};
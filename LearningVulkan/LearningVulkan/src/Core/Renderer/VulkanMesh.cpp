@@ -0,0 +1,78 @@
+#include "VulkanMesh.h"
+
+#include <stdexcept>
+
+///////////////////////////////////////////
+void VulkanMesh::InitMesh(VulkanDevice* pDevice, VulkanUploadEngine* pUploadEngine, const void* pVertices, uint32_t vertexCount, uint32_t vertexStride, const std::vector<uint32_t>& indices)
+{
+	if (vertexCount == 0 || indices.empty()) {
+		throw std::runtime_error("Meshes need at least one vertex and one index!");
+	}
+
+	m_vertexCount = vertexCount;
+	m_indexCount = static_cast<uint32_t>(indices.size());
+
+	const VkBufferUsageFlags transferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	VkDeviceSize vertexSize = static_cast<VkDeviceSize>(vertexCount) * vertexStride;
+	VkDeviceSize indexSize = static_cast<VkDeviceSize>(m_indexCount) * sizeof(uint32_t);
+
+	m_vertexBuffer.InitBuffer(pDevice, vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | transferUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	m_indexBuffer.InitBuffer(pDevice, indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | transferUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	pUploadEngine->UploadBuffer(m_vertexBuffer.GetBuffer(), 0, pVertices, vertexSize);
+	pUploadEngine->UploadBuffer(m_indexBuffer.GetBuffer(), 0, indices.data(), indexSize);
+}
+
+///////////////////////////////////////////
+void VulkanMesh::DestroyMesh()
+{
+	m_vertexBuffer.DestroyBuffer();
+	m_indexBuffer.DestroyBuffer();
+	m_vertexCount = 0;
+	m_indexCount = 0;
+}
+
+///////////////////////////////////////////
+void VulkanMesh::Bind(VkCommandBuffer commandBuffer) const
+{
+	VkBuffer vertexBuffer = m_vertexBuffer.GetBuffer();
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer.GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+///////////////////////////////////////////
+uint32_t VulkanMesh::GetVertexCount() const
+{
+	return m_vertexCount;
+}
+
+///////////////////////////////////////////
+uint32_t VulkanMesh::GetIndexCount() const
+{
+	return m_indexCount;
+}
+
+///////////////////////////////////////////
+uint32_t VulkanMesh::GetTriangleCount() const
+{
+	return m_indexCount / 3;
+}
+
+///////////////////////////////////////////
+VkDeviceSize VulkanMesh::GetSizeInBytes() const
+{
+	return m_vertexBuffer.GetSize() + m_indexBuffer.GetSize();
+}
+
+///////////////////////////////////////////
+VulkanBuffer* VulkanMesh::GetVertexBuffer()
+{
+	return &m_vertexBuffer;
+}
+
+///////////////////////////////////////////
+VulkanBuffer* VulkanMesh::GetIndexBuffer()
+{
+	return &m_indexBuffer;
+}
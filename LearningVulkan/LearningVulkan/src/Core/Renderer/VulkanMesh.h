@@ -0,0 +1,38 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+#include "VulkanUploadEngine.h"
+
+#include <vector>
+
+///////////////////////////////////////////
+//Interleaved vertices and 32 bit indices in device local buffers. The contents go through the upload engine,
+//so the first submit drawing the mesh must also wait on the engine's acquires (Application::RecordFrameSetup() does this every frame)
+class VulkanMesh
+{
+public:
+	void InitMesh(VulkanDevice* pDevice, VulkanUploadEngine* pUploadEngine, const void* pVertices, uint32_t vertexCount, uint32_t vertexStride, const std::vector<uint32_t>& indices);
+	void DestroyMesh();
+
+	//Binds the vertex buffer to binding 0 and the index buffer, the handles are read at record time so buffers moved by the defragmenter are picked up
+	void Bind(VkCommandBuffer commandBuffer) const;
+
+	uint32_t GetVertexCount() const;
+	uint32_t GetIndexCount() const;
+	uint32_t GetTriangleCount() const;
+	VkDeviceSize GetSizeInBytes() const;
+
+	//Both buffers have transfer source and destination usage so they can be registered with the defragmenter
+	VulkanBuffer* GetVertexBuffer();
+	VulkanBuffer* GetIndexBuffer();
+
+private:
+	VulkanBuffer m_vertexBuffer;
+	VulkanBuffer m_indexBuffer;
+	uint32_t m_vertexCount = 0;
+	uint32_t m_indexCount = 0;
+};
@@ -0,0 +1,91 @@
+#include "VulkanOffscreenTarget.h"
+
+#include <stdexcept>
+
+///////////////////////////////////////////
+void VulkanOffscreenTarget::InitOffscreenTarget(VulkanDevice* pDevices, VkExtent2D extents, VkFormat format, uint32_t imageCount)
+{
+	m_pDevices = pDevices;
+	m_extents = extents;
+	m_imageFormat = format;
+
+	m_images.resize(imageCount);
+	m_imageMemory.resize(imageCount);
+	m_imageViews.resize(imageCount);
+
+	VkDevice logicalDevice = pDevices->GetLogicalDevice();
+	for (uint32_t i = 0; i < imageCount; ++i) {
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = m_imageFormat;
+		imageInfo.extent = { m_extents.width, m_extents.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		//Transfer source so a frame can be copied out for inspection
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(logicalDevice, &imageInfo, nullptr, &m_images[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create offscreen image!");
+		}
+
+		m_imageMemory[i] = pDevices->GetMemoryAllocator().AllocateForImage(m_images[i], imageInfo.tiling, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_images[i];
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = m_imageFormat;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(logicalDevice, &viewInfo, nullptr, &m_imageViews[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create offscreen image view!");
+		}
+	}
+}
+
+///////////////////////////////////////////
+void VulkanOffscreenTarget::DestroyOffscreenTarget(VkDevice logicalDevice)
+{
+	for (size_t i = 0; i < m_images.size(); ++i) {
+		vkDestroyImageView(logicalDevice, m_imageViews[i], nullptr);
+		vkDestroyImage(logicalDevice, m_images[i], nullptr);
+		m_pDevices->GetMemoryAllocator().Free(m_imageMemory[i]);
+	}
+
+	m_images.clear();
+	m_imageMemory.clear();
+	m_imageViews.clear();
+}
+
+///////////////////////////////////////////
+VkExtent2D VulkanOffscreenTarget::GetExtents() const
+{
+	return m_extents;
+}
+
+///////////////////////////////////////////
+VkFormat VulkanOffscreenTarget::GetImageFormat() const
+{
+	return m_imageFormat;
+}
+
+///////////////////////////////////////////
+const std::vector<VkImage>& VulkanOffscreenTarget::GetImages() const
+{
+	return m_images;
+}
+
+///////////////////////////////////////////
+const std::vector<VkImageView>& VulkanOffscreenTarget::GetImageViews() const
+{
+	return m_imageViews;
+}
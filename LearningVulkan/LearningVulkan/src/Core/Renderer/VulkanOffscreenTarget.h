@@ -0,0 +1,30 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+
+#include <vector>
+
+///////////////////////////////////////////
+//Device local color images the renderer draws into when there is no surface or swap chain (headless mode).
+//Mirrors the getters of VulkanSwapChain so framebuffer and render pass creation do not care which one they are given.
+class VulkanOffscreenTarget {
+public:
+	void InitOffscreenTarget(VulkanDevice* pDevices, VkExtent2D extents, VkFormat format, uint32_t imageCount);
+	void DestroyOffscreenTarget(VkDevice logicalDevice);
+
+	VkExtent2D GetExtents() const;
+	VkFormat GetImageFormat() const;
+	const std::vector<VkImage>& GetImages() const;
+	const std::vector<VkImageView>& GetImageViews() const;
+
+private:
+	VulkanDevice* m_pDevices = nullptr;
+	VkExtent2D m_extents;
+	VkFormat m_imageFormat;
+	std::vector<VkImage> m_images;
+	std::vector<MemoryAllocation> m_imageMemory;
+	std::vector<VkImageView> m_imageViews;
+};
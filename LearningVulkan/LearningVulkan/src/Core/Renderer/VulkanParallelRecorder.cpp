@@ -0,0 +1,104 @@
+#include "VulkanParallelRecorder.h"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+///////////////////////////////////////////
+void VulkanParallelRecorder::InitParallelRecorder(VulkanCommandAllocator* pCommandAllocator, uint32_t firstThreadIndex, JobSystem* pJobSystem, uint32_t minDrawsPerTask)
+{
+	m_pCommandAllocator = pCommandAllocator;
+	m_firstThreadIndex = firstThreadIndex;
+	m_pJobSystem = pJobSystem;
+	m_minDrawsPerTask = std::max(minDrawsPerTask, 1u);
+
+	if (m_firstThreadIndex + GetTaskCapacity() > m_pCommandAllocator->GetThreadCount()) {
+		throw std::runtime_error("Command allocator has too few thread pools for the parallel recorder!");
+	}
+}
+
+///////////////////////////////////////////
+const std::vector<VkCommandBuffer>& VulkanParallelRecorder::RecordSecondaries(const VkCommandBufferInheritanceInfo& inheritanceInfo, uint32_t drawCount, const RecordDrawRangeFunction& recordRange)
+{
+	uint32_t taskCount = std::clamp((drawCount + m_minDrawsPerTask - 1) / m_minDrawsPerTask, 1u, GetTaskCapacity());
+	uint32_t drawsPerTask = (drawCount + taskCount - 1) / taskCount;
+
+	//Every task writes its own element, so the workers never touch the same memory
+	m_recordedCommandBuffers.assign(taskCount, VK_NULL_HANDLE);
+
+	//Jobs must not throw, so a failure is carried back to this thread and rethrown once every task has finished
+	std::vector<std::exception_ptr> errors(taskCount);
+
+	//Hand every range but the last to the workers, the main thread would only be waiting otherwise
+	JobCounter counter;
+	for (uint32_t i = 0; i < taskCount; ++i) {
+		uint32_t firstDraw = std::min(i * drawsPerTask, drawCount);
+		uint32_t rangeCount = std::min(drawsPerTask, drawCount - firstDraw);
+
+		auto task = [this, i, &inheritanceInfo, firstDraw, rangeCount, &recordRange, &errors]() {
+			try {
+				m_recordedCommandBuffers[i] = RecordTask(i, inheritanceInfo, firstDraw, rangeCount, recordRange);
+			}
+			catch (...) {
+				errors[i] = std::current_exception();
+			}
+		};
+
+		if (i + 1 < taskCount) {
+			m_pJobSystem->Run(task, &counter);
+		}
+		else {
+			task();
+		}
+	}
+	m_pJobSystem->Wait(&counter);
+
+	for (auto& error : errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	return m_recordedCommandBuffers;
+}
+
+///////////////////////////////////////////
+uint32_t VulkanParallelRecorder::GetTaskCapacity() const
+{
+	return GetTaskCapacity(m_pJobSystem);
+}
+
+///////////////////////////////////////////
+uint32_t VulkanParallelRecorder::GetTaskCapacity(const JobSystem* pJobSystem)
+{
+	return (pJobSystem != nullptr ? pJobSystem->GetThreadCount() : 0) + 1;
+}
+
+///////////////////////////////////////////
+uint32_t VulkanParallelRecorder::GetLastTaskCount() const
+{
+	return static_cast<uint32_t>(m_recordedCommandBuffers.size());
+}
+
+///////////////////////////////////////////
+VkCommandBuffer VulkanParallelRecorder::RecordTask(uint32_t taskIndex, const VkCommandBufferInheritanceInfo& inheritanceInfo, uint32_t firstDraw, uint32_t drawCount, const RecordDrawRangeFunction& recordRange)
+{
+	VkCommandBuffer commandBuffer = m_pCommandAllocator->Allocate(m_firstThreadIndex + taskIndex, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin secondary command buffer!");
+	}
+
+	recordRange(commandBuffer, firstDraw, drawCount);
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record secondary command buffer!");
+	}
+
+	return commandBuffer;
+}
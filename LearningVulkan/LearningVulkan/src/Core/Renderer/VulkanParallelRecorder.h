@@ -0,0 +1,44 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanCommandAllocator.h"
+#include "../Threading/JobSystem.h"
+
+#include <functional>
+#include <vector>
+
+///////////////////////////////////////////
+//Records a contiguous range of the draw list. The command buffer has already been begun to continue the render pass, and is ended by the recorder
+typedef std::function<void(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount)> RecordDrawRangeFunction;
+
+///////////////////////////////////////////
+//Splits a draw list across the job system, each task recording its own secondary command buffer for the primary to execute.
+//Command pools are externally synchronised, so every task allocates from its own thread index of the command allocator and no locking is needed while recording.
+class VulkanParallelRecorder
+{
+public:
+	//Tasks use allocator thread indices [firstThreadIndex, firstThreadIndex + GetTaskCapacity()), leaving the lower ones to whoever records the primary.
+	//Small draw lists are not worth waking the workers for, a task is only created for every minDrawsPerTask draws
+	void InitParallelRecorder(VulkanCommandAllocator* pCommandAllocator, uint32_t firstThreadIndex, JobSystem* pJobSystem, uint32_t minDrawsPerTask = 256);
+
+	//Blocks until every range is recorded, the main thread records the last one itself. The buffers are returned in draw order ready for vkCmdExecuteCommands
+	const std::vector<VkCommandBuffer>& RecordSecondaries(const VkCommandBufferInheritanceInfo& inheritanceInfo, uint32_t drawCount, const RecordDrawRangeFunction& recordRange);
+
+	//The workers plus the main thread
+	uint32_t GetTaskCapacity() const;
+	static uint32_t GetTaskCapacity(const JobSystem* pJobSystem);
+	uint32_t GetLastTaskCount() const;
+
+private:
+	VkCommandBuffer RecordTask(uint32_t taskIndex, const VkCommandBufferInheritanceInfo& inheritanceInfo, uint32_t firstDraw, uint32_t drawCount, const RecordDrawRangeFunction& recordRange);
+
+private:
+	VulkanCommandAllocator* m_pCommandAllocator = nullptr;
+	uint32_t m_firstThreadIndex = 0;
+	JobSystem* m_pJobSystem = nullptr;
+	uint32_t m_minDrawsPerTask = 0;
+
+	std::vector<VkCommandBuffer> m_recordedCommandBuffers; //[task]
+};
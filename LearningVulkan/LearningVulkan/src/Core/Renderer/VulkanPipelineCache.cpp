@@ -0,0 +1,147 @@
+#include "VulkanPipelineCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x4350564C; //"LVPC"
+constexpr uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+///////////////////////////////////////////
+void VulkanPipelineCache::InitPipelineCache(VulkanDevice* pDevices, const std::string& path)
+{
+	m_logicalDevice = pDevices->GetLogicalDevice();
+	m_deviceProperties = pDevices->GetPhysicalDeviceProperties();
+	m_path = path;
+	m_bLoadedFromDisk = false;
+
+	std::vector<char> cacheData;
+	if (!m_path.empty()) {
+		std::ifstream file(m_path, std::ios::ate | std::ios::binary);
+		if (file.is_open()) {
+			size_t fileSize = (size_t)file.tellg();
+			std::vector<char> fileData(fileSize);
+			file.seekg(0);
+			file.read(fileData.data(), fileSize);
+
+			m_bLoadedFromDisk = ValidateCacheData(fileData, cacheData);
+			if (!m_bLoadedFromDisk) {
+				std::cerr << "Discarding pipeline cache " << m_path << ", it was written by a different device or driver\n";
+				cacheData.clear();
+			}
+		}
+	}
+
+	VkPipelineCacheCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = cacheData.size();
+	createInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+
+	if (vkCreatePipelineCache(m_logicalDevice, &createInfo, nullptr, &m_pipelineCache) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create pipeline cache!");
+	}
+}
+
+///////////////////////////////////////////
+void VulkanPipelineCache::SaveToDisk()
+{
+	if (m_path.empty()) {
+		return;
+	}
+
+	size_t dataSize = 0;
+	vkGetPipelineCacheData(m_logicalDevice, m_pipelineCache, &dataSize, nullptr);
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(m_logicalDevice, m_pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+		std::cerr << "Failed to read pipeline cache data, it will not be saved\n";
+		return;
+	}
+
+	FileHeader header{};
+	header.magic = PIPELINE_CACHE_MAGIC;
+	header.headerVersion = PIPELINE_CACHE_FILE_VERSION;
+	header.vendorID = m_deviceProperties.vendorID;
+	header.deviceID = m_deviceProperties.deviceID;
+	header.driverVersion = m_deviceProperties.driverVersion;
+	memcpy(header.pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = dataSize;
+
+	std::string tempPath = m_path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			std::cerr << "Failed to open " << tempPath << " to save the pipeline cache\n";
+			return;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), dataSize);
+		if (!file.good()) {
+			std::cerr << "Failed to write pipeline cache to " << tempPath << "\n";
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, m_path, error);
+	if (error) {
+		std::cerr << "Failed to replace pipeline cache " << m_path << ": " << error.message() << "\n";
+		std::filesystem::remove(tempPath, error);
+	}
+}
+
+///////////////////////////////////////////
+void VulkanPipelineCache::DestroyPipelineCache()
+{
+	vkDestroyPipelineCache(m_logicalDevice, m_pipelineCache, nullptr);
+	m_pipelineCache = VK_NULL_HANDLE;
+}
+
+///////////////////////////////////////////
+VkPipelineCache VulkanPipelineCache::GetPipelineCache() const
+{
+	return m_pipelineCache;
+}
+
+///////////////////////////////////////////
+bool VulkanPipelineCache::WasLoadedFromDisk() const
+{
+	return m_bLoadedFromDisk;
+}
+
+///////////////////////////////////////////
+bool VulkanPipelineCache::ValidateCacheData(const std::vector<char>& fileData, std::vector<char>& outCacheData) const
+{
+	if (fileData.size() < sizeof(FileHeader)) {
+		return false;
+	}
+
+	FileHeader header;
+	memcpy(&header, fileData.data(), sizeof(header));
+
+	if (header.magic != PIPELINE_CACHE_MAGIC || header.headerVersion != PIPELINE_CACHE_FILE_VERSION ||
+		header.vendorID != m_deviceProperties.vendorID || header.deviceID != m_deviceProperties.deviceID ||
+		header.driverVersion != m_deviceProperties.driverVersion ||
+		memcmp(header.pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0 ||
+		header.dataSize != fileData.size() - sizeof(FileHeader)) {
+		return false;
+	}
+
+	//Double check the driver's own header agrees before handing it the blob
+	VkPipelineCacheHeaderVersionOne driverHeader;
+	if (header.dataSize < sizeof(driverHeader)) {
+		return false;
+	}
+	memcpy(&driverHeader, fileData.data() + sizeof(FileHeader), sizeof(driverHeader));
+
+	if (driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+		driverHeader.vendorID != m_deviceProperties.vendorID || driverHeader.deviceID != m_deviceProperties.deviceID ||
+		memcmp(driverHeader.pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+		return false;
+	}
+
+	outCacheData.assign(fileData.begin() + sizeof(FileHeader), fileData.end());
+	return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////
+//A VkPipelineCache persisted to disk between runs so pipelines are not recompiled from scratch every launch.
+//The file is only trusted if it was written by the same vendor, device, driver version and pipelineCacheUUID.
+class VulkanPipelineCache
+{
+public:
+	//An empty path keeps the cache in memory only
+	void InitPipelineCache(VulkanDevice* pDevices, const std::string& path);
+	//Writes the cache to a temporary file and renames it over the old one, so a crash mid write never leaves a corrupt cache behind
+	void SaveToDisk();
+	void DestroyPipelineCache();
+
+	VkPipelineCache GetPipelineCache() const;
+	bool WasLoadedFromDisk() const;
+
+private:
+	bool ValidateCacheData(const std::vector<char>& fileData, std::vector<char>& outCacheData) const;
+
+private:
+	//Written in front of the driver's blob. Vulkan's own header has no driver version so we store it ourselves
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t headerVersion;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+	};
+
+	VkDevice m_logicalDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties m_deviceProperties;
+	VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+
+	std::string m_path;
+	bool m_bLoadedFromDisk = false;
+};
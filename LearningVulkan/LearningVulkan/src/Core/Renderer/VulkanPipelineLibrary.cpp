@@ -0,0 +1,457 @@
+#include "VulkanPipelineLibrary.h"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+///////////////////////////////////////////
+//FNV-1a, folded one value at a time so the description never has to be laid out contiguously
+static void HashCombine(size_t& hash, uint64_t value)
+{
+	const uint64_t prime = 1099511628211ull;
+	for (int i = 0; i < 8; ++i) {
+		hash ^= static_cast<size_t>((value >> (i * 8)) & 0xFF);
+		hash = static_cast<size_t>(hash * prime);
+	}
+}
+
+///////////////////////////////////////////
+static void HashCombine(size_t& hash, const std::string& value)
+{
+	for (char c : value) {
+		HashCombine(hash, static_cast<uint64_t>(c));
+	}
+	HashCombine(hash, static_cast<uint64_t>(value.size()));
+}
+
+///////////////////////////////////////////
+bool GraphicsPipelineDescription::operator==(const GraphicsPipelineDescription& other) const
+{
+	auto bindingsEqual = [](const VkVertexInputBindingDescription& a, const VkVertexInputBindingDescription& b) {
+		return a.binding == b.binding && a.stride == b.stride && a.inputRate == b.inputRate;
+	};
+	auto attributesEqual = [](const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b) {
+		return a.location == b.location && a.binding == b.binding && a.format == b.format && a.offset == b.offset;
+	};
+
+	if (vertexBindings.size() != other.vertexBindings.size() || vertexAttributes.size() != other.vertexAttributes.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < vertexBindings.size(); ++i) {
+		if (!bindingsEqual(vertexBindings[i], other.vertexBindings[i])) {
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < vertexAttributes.size(); ++i) {
+		if (!attributesEqual(vertexAttributes[i], other.vertexAttributes[i])) {
+			return false;
+		}
+	}
+
+	return vertexShaderPath == other.vertexShaderPath && fragmentShaderPath == other.fragmentShaderPath &&
+		topology == other.topology &&
+		polygonMode == other.polygonMode && cullMode == other.cullMode && frontFace == other.frontFace &&
+		bBlendEnable == other.bBlendEnable &&
+		srcColorBlendFactor == other.srcColorBlendFactor && dstColorBlendFactor == other.dstColorBlendFactor && colorBlendOp == other.colorBlendOp &&
+		srcAlphaBlendFactor == other.srcAlphaBlendFactor && dstAlphaBlendFactor == other.dstAlphaBlendFactor && alphaBlendOp == other.alphaBlendOp &&
+		colorWriteMask == other.colorWriteMask &&
+		bDepthTestEnable == other.bDepthTestEnable && bDepthWriteEnable == other.bDepthWriteEnable && depthCompareOp == other.depthCompareOp &&
+		layout == other.layout && renderPass == other.renderPass && subpass == other.subpass && colorFormat == other.colorFormat;
+}
+
+///////////////////////////////////////////
+size_t GraphicsPipelineDescription::Hash() const
+{
+	size_t hash = static_cast<size_t>(14695981039346656037ull);
+
+	HashCombine(hash, vertexShaderPath);
+	HashCombine(hash, fragmentShaderPath);
+
+	for (const auto& binding : vertexBindings) {
+		HashCombine(hash, binding.binding);
+		HashCombine(hash, binding.stride);
+		HashCombine(hash, binding.inputRate);
+	}
+	for (const auto& attribute : vertexAttributes) {
+		HashCombine(hash, attribute.location);
+		HashCombine(hash, attribute.binding);
+		HashCombine(hash, attribute.format);
+		HashCombine(hash, attribute.offset);
+	}
+	HashCombine(hash, topology);
+
+	HashCombine(hash, polygonMode);
+	HashCombine(hash, cullMode);
+	HashCombine(hash, frontFace);
+
+	HashCombine(hash, bBlendEnable);
+	HashCombine(hash, srcColorBlendFactor);
+	HashCombine(hash, dstColorBlendFactor);
+	HashCombine(hash, colorBlendOp);
+	HashCombine(hash, srcAlphaBlendFactor);
+	HashCombine(hash, dstAlphaBlendFactor);
+	HashCombine(hash, alphaBlendOp);
+	HashCombine(hash, colorWriteMask);
+
+	HashCombine(hash, bDepthTestEnable);
+	HashCombine(hash, bDepthWriteEnable);
+	HashCombine(hash, depthCompareOp);
+
+	HashCombine(hash, reinterpret_cast<uint64_t>(layout));
+	HashCombine(hash, reinterpret_cast<uint64_t>(renderPass));
+	HashCombine(hash, subpass);
+	HashCombine(hash, colorFormat);
+
+	return hash;
+}
+
+///////////////////////////////////////////
+void VulkanPipelineLibrary::InitPipelineLibrary(VulkanDevice* pDevices, VkPipelineCache pipelineCache, JobSystem* pJobSystem)
+{
+	m_logicalDevice = pDevices->GetLogicalDevice();
+	m_pipelineCache = pipelineCache;
+	m_pJobSystem = pJobSystem;
+}
+
+///////////////////////////////////////////
+void VulkanPipelineLibrary::DestroyPipelineLibrary()
+{
+	for (auto& entry : m_entries) {
+		if (m_pJobSystem != nullptr) {
+			m_pJobSystem->Wait(&entry->compileCounter);
+		}
+		if (entry->pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(m_logicalDevice, entry->pipeline, nullptr);
+		}
+	}
+	m_entries.clear();
+	m_lookup.clear();
+
+	for (VkPipeline pipeline : m_computePipelines) {
+		vkDestroyPipeline(m_logicalDevice, pipeline, nullptr);
+	}
+	m_computePipelines.clear();
+
+	for (auto& shaderModule : m_shaderModules) {
+		vkDestroyShaderModule(m_logicalDevice, shaderModule.second, nullptr);
+	}
+	m_shaderModules.clear();
+}
+
+///////////////////////////////////////////
+PipelineHandle VulkanPipelineLibrary::RequestPipeline(const GraphicsPipelineDescription& description, PipelinePriority priority)
+{
+	auto it = m_lookup.find(description);
+	if (it != m_lookup.end()) {
+		m_cacheHits++;
+		//An optional pipeline that something now depends on is promoted rather than compiled twice
+		if (priority == PipelinePriority::Required) {
+			m_entries[it->second]->bRequired = true;
+		}
+		return it->second;
+	}
+
+	m_cacheMisses++;
+	PipelineHandle handle = static_cast<PipelineHandle>(m_entries.size());
+
+	m_entries.push_back(std::make_unique<PipelineEntry>());
+	PipelineEntry* pEntry = m_entries.back().get();
+	pEntry->description = description;
+	pEntry->bRequired = priority == PipelinePriority::Required;
+	m_lookup.emplace(description, handle);
+
+	//Compiles can take far longer than a frame, as background jobs they never hold up a frame waiting on its own jobs
+	if (m_pJobSystem != nullptr) {
+		m_pJobSystem->Run([this, pEntry]() { CompileEntry(pEntry); }, &pEntry->compileCounter, JobPriority::Background);
+	}
+	else {
+		CompileEntry(pEntry);
+	}
+
+	return handle;
+}
+
+///////////////////////////////////////////
+VkPipeline VulkanPipelineLibrary::GetOrCreatePipeline(const GraphicsPipelineDescription& description)
+{
+	PipelineHandle handle = RequestPipeline(description, PipelinePriority::Required);
+	WaitForPipeline(handle);
+	return GetPipeline(handle);
+}
+
+///////////////////////////////////////////
+bool VulkanPipelineLibrary::IsPipelineReady(PipelineHandle handle) const
+{
+	return handle < m_entries.size() && m_entries[handle]->state.load(std::memory_order_acquire) == PipelineState::Ready;
+}
+
+///////////////////////////////////////////
+VkPipeline VulkanPipelineLibrary::GetPipeline(PipelineHandle handle) const
+{
+	return IsPipelineReady(handle) ? m_entries[handle]->pipeline : VK_NULL_HANDLE;
+}
+
+///////////////////////////////////////////
+VkPipeline VulkanPipelineLibrary::GetPipelineOrFallback(PipelineHandle handle, PipelineHandle fallback) const
+{
+	VkPipeline pipeline = GetPipeline(handle);
+	return pipeline != VK_NULL_HANDLE ? pipeline : GetPipeline(fallback);
+}
+
+///////////////////////////////////////////
+VkPipeline VulkanPipelineLibrary::CreateComputePipeline(const std::string& shaderPath, VkPipelineLayout layout)
+{
+	VkPipelineShaderStageCreateInfo stageInfo{};
+	stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	stageInfo.module = GetOrCreateShaderModule(shaderPath);
+	stageInfo.pName = "main";
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = stageInfo;
+	pipelineInfo.layout = layout;
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	if (vkCreateComputePipelines(m_logicalDevice, m_pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create compute pipeline: " + shaderPath);
+	}
+
+	m_computePipelines.push_back(pipeline);
+	return pipeline;
+}
+
+///////////////////////////////////////////
+void VulkanPipelineLibrary::WaitForPipeline(PipelineHandle handle)
+{
+	PipelineEntry& entry = *m_entries[handle];
+	if (m_pJobSystem != nullptr) {
+		m_pJobSystem->Wait(&entry.compileCounter);
+	}
+
+	if (entry.state.load(std::memory_order_acquire) == PipelineState::Failed) {
+		throw std::runtime_error("Failed to compile pipeline " + entry.description.vertexShaderPath + "/" + entry.description.fragmentShaderPath + ": " + entry.error);
+	}
+}
+
+///////////////////////////////////////////
+void VulkanPipelineLibrary::WaitForRequiredPipelines()
+{
+	for (PipelineHandle handle = 0; handle < m_entries.size(); ++handle) {
+		if (m_entries[handle]->bRequired) {
+			WaitForPipeline(handle);
+		}
+	}
+}
+
+///////////////////////////////////////////
+size_t VulkanPipelineLibrary::GetPipelineCount() const
+{
+	return m_entries.size();
+}
+
+///////////////////////////////////////////
+size_t VulkanPipelineLibrary::GetPendingCount() const
+{
+	size_t pending = 0;
+	for (const auto& entry : m_entries) {
+		if (entry->state.load(std::memory_order_acquire) == PipelineState::Pending) {
+			pending++;
+		}
+	}
+	return pending;
+}
+
+///////////////////////////////////////////
+uint64_t VulkanPipelineLibrary::GetCacheHits() const
+{
+	return m_cacheHits;
+}
+
+///////////////////////////////////////////
+uint64_t VulkanPipelineLibrary::GetCacheMisses() const
+{
+	return m_cacheMisses;
+}
+
+///////////////////////////////////////////
+void VulkanPipelineLibrary::CompileEntry(PipelineEntry* pEntry)
+{
+	//Runs on a worker, the pipeline cache is internally synchronised so workers can share it
+	try {
+		pEntry->pipeline = CreatePipeline(pEntry->description);
+		pEntry->state.store(PipelineState::Ready, std::memory_order_release);
+	}
+	catch (const std::exception& e) {
+		pEntry->error = e.what();
+		pEntry->state.store(PipelineState::Failed, std::memory_order_release);
+		std::cerr << "Pipeline compile failed: " << pEntry->error << "\n";
+	}
+}
+
+///////////////////////////////////////////
+VkPipeline VulkanPipelineLibrary::CreatePipeline(const GraphicsPipelineDescription& description)
+{
+	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vertShaderStageInfo.module = GetOrCreateShaderModule(description.vertexShaderPath);
+	vertShaderStageInfo.pName = "main";
+
+	VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	fragShaderStageInfo.module = GetOrCreateShaderModule(description.fragmentShaderPath);
+	fragShaderStageInfo.pName = "main";
+
+	//A depth only pipeline has no fragment shader
+	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+	uint32_t stageCount = description.fragmentShaderPath.empty() ? 1 : 2;
+
+	std::vector<VkDynamicState> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(description.vertexBindings.size());
+	vertexInputInfo.pVertexBindingDescriptions = description.vertexBindings.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(description.vertexAttributes.size());
+	vertexInputInfo.pVertexAttributeDescriptions = description.vertexAttributes.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = description.topology;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	//Viewport and scissor are set when recording, only the counts matter here
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = description.polygonMode;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = description.cullMode;
+	rasterizer.frontFace = description.frontFace;
+	rasterizer.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampling.minSampleShading = 1.0f;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = description.bDepthTestEnable ? VK_TRUE : VK_FALSE;
+	depthStencil.depthWriteEnable = description.bDepthWriteEnable ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = description.depthCompareOp;
+	depthStencil.depthBoundsTestEnable = VK_FALSE;
+	depthStencil.stencilTestEnable = VK_FALSE;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.colorWriteMask = description.colorWriteMask;
+	colorBlendAttachment.blendEnable = description.bBlendEnable ? VK_TRUE : VK_FALSE;
+	colorBlendAttachment.srcColorBlendFactor = description.srcColorBlendFactor;
+	colorBlendAttachment.dstColorBlendFactor = description.dstColorBlendFactor;
+	colorBlendAttachment.colorBlendOp = description.colorBlendOp;
+	colorBlendAttachment.srcAlphaBlendFactor = description.srcAlphaBlendFactor;
+	colorBlendAttachment.dstAlphaBlendFactor = description.dstAlphaBlendFactor;
+	colorBlendAttachment.alphaBlendOp = description.alphaBlendOp;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.logicOp = VK_LOGIC_OP_COPY;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = stageCount;
+	pipelineInfo.pStages = shaderStages;
+
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = &depthStencil;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.layout = description.layout;
+	pipelineInfo.renderPass = description.renderPass;
+	pipelineInfo.subpass = description.subpass;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline;
+	if (vkCreateGraphicsPipelines(m_logicalDevice, m_pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create graphics pipeline!");
+	}
+
+	return pipeline;
+}
+
+///////////////////////////////////////////
+VkShaderModule VulkanPipelineLibrary::GetOrCreateShaderModule(const std::string& path)
+{
+	if (path.empty()) {
+		return VK_NULL_HANDLE;
+	}
+
+	std::lock_guard<std::mutex> lock(m_shaderModuleMutex);
+	auto it = m_shaderModules.find(path);
+	if (it != m_shaderModules.end()) {
+		return it->second;
+	}
+
+	std::vector<char> code = ReadFile(path);
+
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = code.size();
+	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(m_logicalDevice, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create shader module!");
+	}
+
+	m_shaderModules.emplace(path, shaderModule);
+	return shaderModule;
+}
+
+///////////////////////////////////////////
+std::vector<char> VulkanPipelineLibrary::ReadFile(const std::string& filename)
+{
+	//std::ios::ate (start reading at end of file) std::ios::binary(read as a binary file and avoid text transformations)
+	std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open file: " + filename);
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> buffer(fileSize);
+
+	file.seekg(0);
+	file.read(buffer.data(), fileSize);
+
+	file.close();
+
+	return buffer;
+}
@@ -0,0 +1,154 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+#include "../Threading/JobSystem.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+///////////////////////////////////////////
+//Everything that makes one graphics pipeline different from another. Two equal descriptions always share the same VkPipeline.
+//Viewport and scissor are always dynamic and multisampling is always off, so they are not part of the description.
+struct GraphicsPipelineDescription {
+	//Shaders
+	std::string vertexShaderPath;
+	std::string fragmentShaderPath;
+
+	//Vertex layout
+	std::vector<VkVertexInputBindingDescription> vertexBindings;
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	//Raster
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	//Blend
+	bool bBlendEnable = false;
+	VkBlendFactor srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	VkBlendFactor dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+	VkBlendOp colorBlendOp = VK_BLEND_OP_ADD;
+	VkBlendFactor srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	VkBlendFactor dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	VkBlendOp alphaBlendOp = VK_BLEND_OP_ADD;
+	VkColorComponentFlags colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	//Depth
+	bool bDepthTestEnable = false;
+	bool bDepthWriteEnable = false;
+	VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+	//Layout and render pass/format compatibility
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	uint32_t subpass = 0;
+	VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+
+	bool operator==(const GraphicsPipelineDescription& other) const;
+	size_t Hash() const;
+};
+
+///////////////////////////////////////////
+struct GraphicsPipelineDescriptionHasher {
+	size_t operator()(const GraphicsPipelineDescription& description) const {
+		return description.Hash();
+	}
+};
+
+///////////////////////////////////////////
+//Index of a pipeline request, stays valid until the library is destroyed
+typedef uint32_t PipelineHandle;
+constexpr PipelineHandle INVALID_PIPELINE_HANDLE = UINT32_MAX;
+
+///////////////////////////////////////////
+enum class PipelinePriority {
+	Required, //Startup blocks until it is compiled
+	Optional  //Compiled in the background, draws using it are skipped or fall back until it is ready
+};
+
+///////////////////////////////////////////
+enum class PipelineState {
+	Pending,
+	Ready,
+	Failed
+};
+
+///////////////////////////////////////////
+//Owns every graphics pipeline and shader module. Asking for a state that already exists is a hash lookup rather than a driver compile.
+//New states are compiled as background jobs so the main thread only ever blocks on pipelines it explicitly waits for.
+class VulkanPipelineLibrary
+{
+public:
+	//Without a job system every pipeline is compiled on the calling thread
+	void InitPipelineLibrary(VulkanDevice* pDevices, VkPipelineCache pipelineCache, JobSystem* pJobSystem = nullptr);
+	//Waits for compiles still running on the workers before destroying anything
+	void DestroyPipelineLibrary();
+
+	//Returns straight away, the pipeline is compiled in the background if this description has not been seen before
+	PipelineHandle RequestPipeline(const GraphicsPipelineDescription& description, PipelinePriority priority = PipelinePriority::Optional);
+	//Blocking request, for code that cannot do anything useful without the pipeline
+	VkPipeline GetOrCreatePipeline(const GraphicsPipelineDescription& description);
+
+	bool IsPipelineReady(PipelineHandle handle) const;
+	//VK_NULL_HANDLE until the compile has finished
+	VkPipeline GetPipeline(PipelineHandle handle) const;
+	//The fallback is used while the requested pipeline is still compiling, VK_NULL_HANDLE means neither is ready and the draw should be skipped
+	VkPipeline GetPipelineOrFallback(PipelineHandle handle, PipelineHandle fallback) const;
+
+	//Compute pipelines are few and needed straight away, so they are compiled on the calling thread and are not deduplicated.
+	//They share the library's shader modules and pipeline cache and are destroyed with it
+	VkPipeline CreateComputePipeline(const std::string& shaderPath, VkPipelineLayout layout);
+
+	void WaitForPipeline(PipelineHandle handle);
+	//Throws if a required pipeline failed to compile
+	void WaitForRequiredPipelines();
+
+	size_t GetPipelineCount() const;
+	size_t GetPendingCount() const;
+	uint64_t GetCacheHits() const;
+	uint64_t GetCacheMisses() const;
+
+private:
+	struct PipelineEntry {
+		GraphicsPipelineDescription description;
+		bool bRequired = false;
+
+		//Written by the worker before state is released as Ready, so a reader that sees Ready also sees the pipeline
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		std::atomic<PipelineState> state{ PipelineState::Pending };
+		std::string error;
+
+		JobCounter compileCounter;
+	};
+
+	void CompileEntry(PipelineEntry* pEntry);
+	VkPipeline CreatePipeline(const GraphicsPipelineDescription& description);
+	VkShaderModule GetOrCreateShaderModule(const std::string& path);
+
+	static std::vector<char> ReadFile(const std::string& filename);
+
+private:
+	VkDevice m_logicalDevice = VK_NULL_HANDLE;
+	VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+	JobSystem* m_pJobSystem = nullptr;
+
+	//Only touched by the thread making requests, workers are handed a pointer to their entry
+	std::vector<std::unique_ptr<PipelineEntry>> m_entries;
+	std::unordered_map<GraphicsPipelineDescription, PipelineHandle, GraphicsPipelineDescriptionHasher> m_lookup;
+	std::vector<VkPipeline> m_computePipelines;
+
+	//Workers compiling different pipelines can share a shader module
+	std::unordered_map<std::string, VkShaderModule> m_shaderModules;
+	std::mutex m_shaderModuleMutex;
+
+	uint64_t m_cacheHits = 0;
+	uint64_t m_cacheMisses = 0;
+};
@@ -0,0 +1,193 @@
+#include "VulkanPipelineStatistics.h"
+
+#include <stdexcept>
+
+constexpr VkQueryPipelineStatisticFlags COLLECTED_STATISTICS =
+	VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+constexpr size_t STATISTIC_COUNT = static_cast<size_t>(PipelineStatistic::Count);
+
+///////////////////////////////////////////
+void VulkanPipelineStatistics::InitPipelineStatistics(VulkanDevice* pDevices, uint32_t frameCount, uint32_t maxPassesPerFrame)
+{
+	m_logicalDevice = pDevices->GetLogicalDevice();
+	m_maxPassesPerFrame = maxPassesPerFrame;
+
+	m_bEnabled = pDevices->GetEnabledFeatures().pipelineStatisticsQuery == VK_TRUE;
+	m_bInheritedQueries = pDevices->GetEnabledFeatures().inheritedQueries == VK_TRUE;
+	if (!m_bEnabled) {
+		return;
+	}
+
+	m_frames.resize(frameCount);
+	for (auto& frame : m_frames) {
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		poolInfo.queryCount = m_maxPassesPerFrame;
+		poolInfo.pipelineStatistics = COLLECTED_STATISTICS;
+
+		if (vkCreateQueryPool(m_logicalDevice, &poolInfo, nullptr, &frame.queryPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create pipeline statistics query pool!");
+		}
+	}
+}
+
+///////////////////////////////////////////
+void VulkanPipelineStatistics::DestroyPipelineStatistics()
+{
+	for (auto& frame : m_frames) {
+		vkDestroyQueryPool(m_logicalDevice, frame.queryPool, nullptr);
+	}
+	m_frames.clear();
+}
+
+///////////////////////////////////////////
+void VulkanPipelineStatistics::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+	if (!m_bEnabled) {
+		return;
+	}
+
+	m_currentFrame = frameIndex;
+	CollectResults(frameIndex);
+
+	FrameQueries& frame = m_frames[frameIndex];
+	vkCmdResetQueryPool(commandBuffer, frame.queryPool, 0, m_maxPassesPerFrame);
+	frame.passNames.clear();
+}
+
+///////////////////////////////////////////
+void VulkanPipelineStatistics::BeginPass(VkCommandBuffer commandBuffer, const char* name)
+{
+	if (!m_bEnabled) {
+		return;
+	}
+
+	FrameQueries& frame = m_frames[m_currentFrame];
+	if (frame.passNames.size() >= m_maxPassesPerFrame) {
+		throw std::runtime_error("Too many pipeline statistics passes in one frame!");
+	}
+
+	uint32_t queryIndex = static_cast<uint32_t>(frame.passNames.size());
+	frame.passNames.push_back(name);
+
+	vkCmdBeginQuery(commandBuffer, frame.queryPool, queryIndex, 0);
+}
+
+///////////////////////////////////////////
+void VulkanPipelineStatistics::EndPass(VkCommandBuffer commandBuffer)
+{
+	if (!m_bEnabled) {
+		return;
+	}
+
+	FrameQueries& frame = m_frames[m_currentFrame];
+	vkCmdEndQuery(commandBuffer, frame.queryPool, static_cast<uint32_t>(frame.passNames.size()) - 1);
+}
+
+///////////////////////////////////////////
+bool VulkanPipelineStatistics::IsEnabled() const
+{
+	return m_bEnabled;
+}
+
+///////////////////////////////////////////
+bool VulkanPipelineStatistics::SupportsSecondaryCommandBuffers() const
+{
+	return m_bEnabled && m_bInheritedQueries;
+}
+
+///////////////////////////////////////////
+VkQueryPipelineStatisticFlags VulkanPipelineStatistics::GetInheritedStatistics() const
+{
+	return SupportsSecondaryCommandBuffers() ? COLLECTED_STATISTICS : 0;
+}
+
+///////////////////////////////////////////
+const std::map<std::string, PassStatistics>& VulkanPipelineStatistics::GetPassStatistics() const
+{
+	return m_passStatistics;
+}
+
+///////////////////////////////////////////
+void VulkanPipelineStatistics::WriteJson(JsonWriter& writer) const
+{
+	writer.Write("enabled", m_bEnabled);
+	writer.BeginObject("passes");
+	for (const auto& pass : m_passStatistics) {
+		writer.BeginObject(pass.first);
+		writer.Write("frames", pass.second.frameCount);
+
+		writer.BeginObject("last");
+		for (size_t i = 0; i < STATISTIC_COUNT; ++i) {
+			writer.Write(GetStatisticName(static_cast<PipelineStatistic>(i)), pass.second.last[i]);
+		}
+		writer.EndObject();
+
+		writer.BeginObject("averagePerFrame");
+		for (size_t i = 0; i < STATISTIC_COUNT; ++i) {
+			double average = pass.second.frameCount > 0 ? static_cast<double>(pass.second.total[i]) / pass.second.frameCount : 0.0;
+			writer.Write(GetStatisticName(static_cast<PipelineStatistic>(i)), average);
+		}
+		writer.EndObject();
+
+		writer.EndObject();
+	}
+	writer.EndObject();
+}
+
+///////////////////////////////////////////
+const char* VulkanPipelineStatistics::GetStatisticName(PipelineStatistic statistic)
+{
+	switch (statistic) {
+	case PipelineStatistic::InputAssemblyVertices: return "inputAssemblyVertices";
+	case PipelineStatistic::InputAssemblyPrimitives: return "inputAssemblyPrimitives";
+	case PipelineStatistic::VertexShaderInvocations: return "vertexShaderInvocations";
+	case PipelineStatistic::ClippingInvocations: return "clippingInvocations";
+	case PipelineStatistic::ClippingPrimitives: return "clippingPrimitives";
+	case PipelineStatistic::FragmentShaderInvocations: return "fragmentShaderInvocations";
+	default: return "unknown";
+	}
+}
+
+///////////////////////////////////////////
+void VulkanPipelineStatistics::CollectResults(uint32_t frameIndex)
+{
+	FrameQueries& frame = m_frames[frameIndex];
+	if (frame.passNames.empty()) {
+		return;
+	}
+
+	//Each query is STATISTIC_COUNT counters followed by its availability
+	const size_t stride = STATISTIC_COUNT + 1;
+	uint32_t queryCount = static_cast<uint32_t>(frame.passNames.size());
+	std::vector<uint64_t> results(queryCount * stride);
+	VkResult result = vkGetQueryPoolResults(m_logicalDevice, frame.queryPool, 0, queryCount, results.size() * sizeof(uint64_t), results.data(),
+		stride * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+	if (result != VK_SUCCESS && result != VK_NOT_READY) {
+		throw std::runtime_error("Failed to read back pipeline statistics!");
+	}
+
+	for (size_t i = 0; i < frame.passNames.size(); ++i) {
+		const uint64_t* pCounters = &results[i * stride];
+		if (pCounters[STATISTIC_COUNT] == 0) {
+			continue;
+		}
+
+		PassStatistics& stats = m_passStatistics[frame.passNames[i]];
+		for (size_t counter = 0; counter < STATISTIC_COUNT; ++counter) {
+			stats.last[counter] = pCounters[counter];
+			stats.total[counter] += pCounters[counter];
+		}
+		stats.frameCount++;
+	}
+
+	frame.passNames.clear();
+}
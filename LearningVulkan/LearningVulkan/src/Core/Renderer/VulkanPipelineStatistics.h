@@ -0,0 +1,79 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+#include "../Profiling/JsonWriter.h"
+
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////
+//The counters we collect for every pass, in the order Vulkan writes them (ascending flag bit)
+enum class PipelineStatistic {
+	InputAssemblyVertices,
+	InputAssemblyPrimitives,
+	VertexShaderInvocations,
+	ClippingInvocations,
+	ClippingPrimitives,
+	FragmentShaderInvocations,
+	Count
+};
+
+///////////////////////////////////////////
+struct PassStatistics {
+	std::array<uint64_t, static_cast<size_t>(PipelineStatistic::Count)> last{};
+	std::array<uint64_t, static_cast<size_t>(PipelineStatistic::Count)> total{};
+	uint64_t frameCount = 0;
+};
+
+///////////////////////////////////////////
+//Opt in VK_QUERY_TYPE_PIPELINE_STATISTICS collector wrapped around render passes. Uses the same per frame in flight ring as VulkanGpuProfiler so results are read back without stalling.
+//Requires the pipelineStatisticsQuery device feature, every call is a no-op when it was not enabled.
+class VulkanPipelineStatistics
+{
+public:
+	void InitPipelineStatistics(VulkanDevice* pDevices, uint32_t frameCount, uint32_t maxPassesPerFrame = 8);
+	void DestroyPipelineStatistics();
+
+	//Call once the GPU has finished the frame that last used frameIndex. Collects that frame's counters and resets its queries
+	void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	//Passes cannot be nested, vkCmdBeginQuery only allows one active query of a type at a time
+	void BeginPass(VkCommandBuffer commandBuffer, const char* name);
+	void EndPass(VkCommandBuffer commandBuffer);
+
+	bool IsEnabled() const;
+	//Whether passes recorded through secondary command buffers can be measured, needs the inheritedQueries feature
+	bool SupportsSecondaryCommandBuffers() const;
+	//Passed in VkCommandBufferInheritanceInfo::pipelineStatistics by secondaries executed inside a pass
+	VkQueryPipelineStatisticFlags GetInheritedStatistics() const;
+	const std::map<std::string, PassStatistics>& GetPassStatistics() const;
+
+	//Writes one object per pass (last frame and per frame average counters) into the object the writer currently has open
+	void WriteJson(JsonWriter& writer) const;
+
+	static const char* GetStatisticName(PipelineStatistic statistic);
+
+private:
+	void CollectResults(uint32_t frameIndex);
+
+private:
+	struct FrameQueries {
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		std::vector<std::string> passNames; //Pass i uses query i
+	};
+
+	VkDevice m_logicalDevice = VK_NULL_HANDLE;
+	bool m_bEnabled = false;
+	bool m_bInheritedQueries = false;
+	uint32_t m_maxPassesPerFrame = 0;
+
+	std::vector<FrameQueries> m_frames;
+	uint32_t m_currentFrame = 0;
+
+	std::map<std::string, PassStatistics> m_passStatistics;
+};
@@ -0,0 +1,78 @@
+#include "VulkanQueueOwnership.h"
+
+///////////////////////////////////////////
+void VulkanQueueOwnership::ReleaseBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const QueueOwnershipTransfer& transfer)
+{
+	if (transfer.IsRequired()) {
+		RecordBufferBarrier(commandBuffer, buffer, offset, size, transfer, true, false);
+	}
+}
+
+///////////////////////////////////////////
+void VulkanQueueOwnership::AcquireBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const QueueOwnershipTransfer& transfer)
+{
+	//On a single family the acquire is the only barrier so it has to cover the source work as well
+	RecordBufferBarrier(commandBuffer, buffer, offset, size, transfer, !transfer.IsRequired(), true);
+}
+
+///////////////////////////////////////////
+void VulkanQueueOwnership::ReleaseImage(VkCommandBuffer commandBuffer, VkImage image, const VkImageSubresourceRange& range, const QueueOwnershipTransfer& transfer)
+{
+	if (transfer.IsRequired()) {
+		RecordImageBarrier(commandBuffer, image, range, transfer, true, false);
+	}
+}
+
+///////////////////////////////////////////
+void VulkanQueueOwnership::AcquireImage(VkCommandBuffer commandBuffer, VkImage image, const VkImageSubresourceRange& range, const QueueOwnershipTransfer& transfer)
+{
+	RecordImageBarrier(commandBuffer, image, range, transfer, !transfer.IsRequired(), true);
+}
+
+///////////////////////////////////////////
+void VulkanQueueOwnership::RecordBufferBarrier(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const QueueOwnershipTransfer& transfer, bool bRelease, bool bAcquire)
+{
+	//Each half only describes its own queue's side, the other side's scope is ignored by the driver
+	VkBufferMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+	barrier.srcStageMask = bRelease ? transfer.srcStage : VK_PIPELINE_STAGE_2_NONE;
+	barrier.srcAccessMask = bRelease ? transfer.srcAccess : VK_ACCESS_2_NONE;
+	barrier.dstStageMask = bAcquire ? transfer.dstStage : VK_PIPELINE_STAGE_2_NONE;
+	barrier.dstAccessMask = bAcquire ? transfer.dstAccess : VK_ACCESS_2_NONE;
+	barrier.srcQueueFamilyIndex = transfer.IsRequired() ? transfer.srcQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = transfer.IsRequired() ? transfer.dstQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = buffer;
+	barrier.offset = offset;
+	barrier.size = size;
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.bufferMemoryBarrierCount = 1;
+	dependencyInfo.pBufferMemoryBarriers = &barrier;
+
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+///////////////////////////////////////////
+void VulkanQueueOwnership::RecordImageBarrier(VkCommandBuffer commandBuffer, VkImage image, const VkImageSubresourceRange& range, const QueueOwnershipTransfer& transfer, bool bRelease, bool bAcquire)
+{
+	VkImageMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = bRelease ? transfer.srcStage : VK_PIPELINE_STAGE_2_NONE;
+	barrier.srcAccessMask = bRelease ? transfer.srcAccess : VK_ACCESS_2_NONE;
+	barrier.dstStageMask = bAcquire ? transfer.dstStage : VK_PIPELINE_STAGE_2_NONE;
+	barrier.dstAccessMask = bAcquire ? transfer.dstAccess : VK_ACCESS_2_NONE;
+	barrier.oldLayout = transfer.oldLayout;
+	barrier.newLayout = transfer.newLayout;
+	barrier.srcQueueFamilyIndex = transfer.IsRequired() ? transfer.srcQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = transfer.IsRequired() ? transfer.dstQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = range;
+
+	VkDependencyInfo dependencyInfo{};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.imageMemoryBarrierCount = 1;
+	dependencyInfo.pImageMemoryBarriers = &barrier;
+
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+///////////////////////////////////////////
+//Describes handing a resource from one queue family to another. The source half is the work that last used it, the destination half the work that uses it next
+struct QueueOwnershipTransfer {
+	uint32_t srcQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+	uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+
+	VkPipelineStageFlags2 srcStage = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 srcAccess = VK_ACCESS_2_NONE;
+	VkPipelineStageFlags2 dstStage = VK_PIPELINE_STAGE_2_NONE;
+	VkAccessFlags2 dstAccess = VK_ACCESS_2_NONE;
+
+	//Images only, the transition is performed once. Both halves must be given the same layouts
+	VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkImageLayout newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	bool IsRequired() const {
+		return srcQueueFamily != dstQueueFamily;
+	}
+};
+
+///////////////////////////////////////////
+//Release/acquire barrier pairs for resources created with VK_SHARING_MODE_EXCLUSIVE that move between the graphics, compute and transfer queues.
+//Record Release on the source queue and Acquire on the destination queue, the acquiring submit must wait on a semaphore signalled by the releasing one.
+//When both families are the same no ownership changes hands, Release records nothing and Acquire records an ordinary barrier covering both halves.
+class VulkanQueueOwnership
+{
+public:
+	static void ReleaseBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const QueueOwnershipTransfer& transfer);
+	static void AcquireBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const QueueOwnershipTransfer& transfer);
+
+	static void ReleaseImage(VkCommandBuffer commandBuffer, VkImage image, const VkImageSubresourceRange& range, const QueueOwnershipTransfer& transfer);
+	static void AcquireImage(VkCommandBuffer commandBuffer, VkImage image, const VkImageSubresourceRange& range, const QueueOwnershipTransfer& transfer);
+
+private:
+	static void RecordBufferBarrier(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size, const QueueOwnershipTransfer& transfer, bool bRelease, bool bAcquire);
+	static void RecordImageBarrier(VkCommandBuffer commandBuffer, VkImage image, const VkImageSubresourceRange& range, const QueueOwnershipTransfer& transfer, bool bRelease, bool bAcquire);
+};
@@ -4,7 +4,7 @@
 #include <algorithm>
 
 ///////////////////////////////////////////
-void VulkanSwapChain::InitSwapChain(GLFWwindow* pWindow, VulkanDevice* pDevices, VkSurfaceKHR surface)
+void VulkanSwapChain::InitSwapChain(GLFWwindow* pWindow, VulkanDevice* pDevices, VkSurfaceKHR surface, VkSwapchainKHR oldSwapChain)
 {
 	SwapChainSupportDetails details = pDevices->QuerySwapChainSupport();
 
@@ -50,7 +50,8 @@ void VulkanSwapChain::InitSwapChain(GLFWwindow* pWindow, VulkanDevice* pDevices,
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
 
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	//Handing over the old swap chain lets the driver reuse its resources and keep presenting its images while we switch over
+	createInfo.oldSwapchain = oldSwapChain;
 
 	VkDevice logicalDevice = pDevices->GetLogicalDevice();
 	if (vkCreateSwapchainKHR(logicalDevice, &createInfo, nullptr, &m_swapChain) != VK_SUCCESS) {
@@ -65,6 +66,20 @@ void VulkanSwapChain::InitSwapChain(GLFWwindow* pWindow, VulkanDevice* pDevices,
 	m_swapchainExtents = extent;
 }
 
+///////////////////////////////////////////
+RetiredSwapChain VulkanSwapChain::RecreateSwapChain(GLFWwindow* pWindow, VulkanDevice* pDevices, VkSurfaceKHR surface)
+{
+	RetiredSwapChain retired;
+	retired.swapChain = m_swapChain;
+	retired.imageViews = std::move(m_swapchainImageViews);
+	m_swapchainImageViews.clear();
+
+	InitSwapChain(pWindow, pDevices, surface, retired.swapChain);
+	CreateImageViews(pDevices->GetLogicalDevice());
+
+	return retired;
+}
+
 ///////////////////////////////////////////
 void VulkanSwapChain::CreateImageViews(VkDevice logicalDevice)
 {
@@ -5,10 +5,19 @@
 
 #include "VulkanDevice.h"
 
+///////////////////////////////////////////
+//Objects from a replaced swap chain that must stay alive until the GPU has finished the frames that used them
+struct RetiredSwapChain {
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+	std::vector<VkImageView> imageViews;
+};
+
 ///////////////////////////////////////////
 class VulkanSwapChain {
 public:
-	void InitSwapChain(GLFWwindow* pWindow, VulkanDevice* pDevices, VkSurfaceKHR surface);
+	void InitSwapChain(GLFWwindow* pWindow, VulkanDevice* pDevices, VkSurfaceKHR surface, VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
+	//Creates a new swap chain (and image views) handing the current one over as oldSwapchain. The returned objects are no longer owned by this class
+	RetiredSwapChain RecreateSwapChain(GLFWwindow* pWindow, VulkanDevice* pDevices, VkSurfaceKHR surface);
 	void CreateImageViews(VkDevice logicalDevice);
 	void DestroyImageViews(VkDevice logicalDevice);
 	void DestroySwapChain(VkDevice logicalDevice);
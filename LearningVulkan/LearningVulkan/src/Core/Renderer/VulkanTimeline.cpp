@@ -0,0 +1,161 @@
+#include "VulkanTimeline.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+///////////////////////////////////////////
+void VulkanTimeline::InitTimeline(VulkanDevice* pDevice)
+{
+	m_logicalDevice = pDevice->GetLogicalDevice();
+	m_lastSubmittedValue = 0;
+	m_completedValue = 0;
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	createInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(m_logicalDevice, &createInfo, nullptr, &m_timelineSemaphore) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create timeline semaphore!");
+	}
+}
+
+///////////////////////////////////////////
+void VulkanTimeline::DestroyTimeline()
+{
+	//Everything still waiting to be retired is safe to destroy once the last submit has finished
+	WaitForValue(m_lastSubmittedValue);
+	CollectRetired();
+
+	vkDestroySemaphore(m_logicalDevice, m_timelineSemaphore, nullptr);
+	m_timelineSemaphore = VK_NULL_HANDLE;
+}
+
+///////////////////////////////////////////
+uint64_t VulkanTimeline::Submit(VkQueue queue, const std::vector<VkCommandBuffer>& commandBuffers, const std::vector<TimelineWait>& waits, const std::vector<VkSemaphore>& binarySignals)
+{
+	uint64_t signalValue = m_lastSubmittedValue + 1;
+
+	std::vector<VkSemaphore> waitSemaphores;
+	std::vector<uint64_t> waitValues;
+	std::vector<VkPipelineStageFlags> waitStages;
+	for (const auto& wait : waits) {
+		waitSemaphores.push_back(wait.semaphore);
+		waitValues.push_back(wait.value);
+		waitStages.push_back(wait.stage);
+	}
+
+	//Binary semaphores are given a value of 0 which the driver ignores
+	std::vector<VkSemaphore> signalSemaphores(binarySignals.begin(), binarySignals.end());
+	std::vector<uint64_t> signalValues(binarySignals.size(), 0);
+	signalSemaphores.push_back(m_timelineSemaphore);
+	signalValues.push_back(signalValue);
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+	timelineInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+	timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
+
+	submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+	submitInfo.pCommandBuffers = commandBuffers.data();
+
+	submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+	submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+	if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit to timeline!");
+	}
+
+	m_lastSubmittedValue = signalValue;
+	return signalValue;
+}
+
+///////////////////////////////////////////
+void VulkanTimeline::WaitForValue(uint64_t value)
+{
+	if (IsValueComplete(value)) {
+		return;
+	}
+
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &m_timelineSemaphore;
+	waitInfo.pValues = &value;
+
+	if (vkWaitSemaphores(m_logicalDevice, &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to wait on timeline semaphore!");
+	}
+
+	m_completedValue = std::max(m_completedValue, value);
+}
+
+///////////////////////////////////////////
+bool VulkanTimeline::IsValueComplete(uint64_t value)
+{
+	if (value <= m_completedValue) {
+		return true;
+	}
+
+	return value <= GetCompletedValue();
+}
+
+///////////////////////////////////////////
+void VulkanTimeline::Retire(uint64_t value, std::function<void()> destroyFn)
+{
+	m_retirements.push_back({ value, std::move(destroyFn) });
+}
+
+///////////////////////////////////////////
+void VulkanTimeline::CollectRetired()
+{
+	if (m_retirements.empty()) {
+		return;
+	}
+
+	uint64_t completedValue = GetCompletedValue();
+
+	//Retirements are pushed with increasing values so we can stop at the first one the GPU has not reached
+	while (!m_retirements.empty() && m_retirements.front().value <= completedValue) {
+		m_retirements.front().destroyFn();
+		m_retirements.pop_front();
+	}
+}
+
+///////////////////////////////////////////
+VkSemaphore VulkanTimeline::GetSemaphore() const
+{
+	return m_timelineSemaphore;
+}
+
+///////////////////////////////////////////
+uint64_t VulkanTimeline::GetLastSubmittedValue() const
+{
+	return m_lastSubmittedValue;
+}
+
+///////////////////////////////////////////
+uint64_t VulkanTimeline::GetCompletedValue()
+{
+	uint64_t value = 0;
+	if (vkGetSemaphoreCounterValue(m_logicalDevice, m_timelineSemaphore, &value) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to query timeline semaphore value!");
+	}
+
+	m_completedValue = value;
+	return value;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+///////////////////////////////////////////
+//A semaphore a submit has to wait on. For timeline semaphores value is the point to wait for, binary semaphores ignore it
+struct TimelineWait {
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	uint64_t value = 0;
+	VkPipelineStageFlags stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+};
+
+///////////////////////////////////////////
+//Tracks every submit made to a queue with one monotonically increasing timeline semaphore value.
+//CPU waits, resource retirement and cross queue dependencies are all expressed as "wait for value N".
+class VulkanTimeline
+{
+public:
+	void InitTimeline(VulkanDevice* pDevice);
+	void DestroyTimeline();
+
+	//Submits the command buffers and signals the next value of the timeline (plus any binary semaphores such as the present semaphore). Returns the signalled value
+	uint64_t Submit(VkQueue queue, const std::vector<VkCommandBuffer>& commandBuffers, const std::vector<TimelineWait>& waits, const std::vector<VkSemaphore>& binarySignals);
+
+	//Blocks the CPU until the GPU has reached value, returns straight away if it already has
+	void WaitForValue(uint64_t value);
+	bool IsValueComplete(uint64_t value);
+
+	//Queues destroyFn to be called once the GPU has passed value
+	void Retire(uint64_t value, std::function<void()> destroyFn);
+	//Runs every retirement whose value the GPU has passed
+	void CollectRetired();
+
+	VkSemaphore GetSemaphore() const;
+	uint64_t GetLastSubmittedValue() const;
+	uint64_t GetCompletedValue();
+
+private:
+	struct Retirement {
+		uint64_t value;
+		std::function<void()> destroyFn;
+	};
+
+	VkDevice m_logicalDevice = VK_NULL_HANDLE;
+	VkSemaphore m_timelineSemaphore = VK_NULL_HANDLE;
+
+	uint64_t m_lastSubmittedValue = 0;
+	uint64_t m_completedValue = 0; //Cached so most checks do not need to ask the driver
+
+	std::deque<Retirement> m_retirements;
+};
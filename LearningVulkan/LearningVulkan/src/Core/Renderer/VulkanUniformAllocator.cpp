@@ -0,0 +1,146 @@
+#include "VulkanUniformAllocator.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+///////////////////////////////////////////
+void VulkanUniformAllocator::InitUniformAllocator(VulkanDevice* pDevice, uint32_t regionCount, VkDeviceSize regionSize, VkDeviceSize bindingRange)
+{
+	m_logicalDevice = pDevice->GetLogicalDevice();
+
+	//Storage usage too so the same allocator can feed dynamic storage buffers, which may need a stricter alignment
+	const VkPhysicalDeviceLimits& limits = pDevice->GetPhysicalDeviceProperties().limits;
+	m_alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+
+	//Every region starts aligned so the first allocation of each frame needs no padding
+	m_regionCount = regionCount;
+	m_regionSize = GetAlignedSize(regionSize);
+	m_buffer.InitBuffer(pDevice, m_regionSize * m_regionCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	m_regionStart = 0;
+	m_cursor = 0;
+
+	CreateDescriptorSet(std::min(bindingRange, static_cast<VkDeviceSize>(limits.maxUniformBufferRange)));
+}
+
+///////////////////////////////////////////
+void VulkanUniformAllocator::DestroyUniformAllocator()
+{
+	//Destroying the pool frees the set allocated from it
+	vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(m_logicalDevice, m_descriptorSetLayout, nullptr);
+	m_buffer.DestroyBuffer();
+}
+
+///////////////////////////////////////////
+void VulkanUniformAllocator::BeginRegion(uint32_t regionIndex)
+{
+	m_regionStart = m_regionSize * regionIndex;
+	m_cursor = 0;
+}
+
+///////////////////////////////////////////
+UniformAllocation VulkanUniformAllocator::Allocate(VkDeviceSize size)
+{
+	VkDeviceSize alignedSize = GetAlignedSize(size);
+	VkDeviceSize offset = m_cursor.fetch_add(alignedSize);
+
+	if (offset + alignedSize > m_regionSize) {
+		throw std::runtime_error("Uniform allocator region is full!");
+	}
+
+	UniformAllocation allocation{};
+	allocation.offset = static_cast<uint32_t>(m_regionStart + offset);
+	allocation.pData = static_cast<uint8_t*>(m_buffer.GetMappedData()) + allocation.offset;
+	return allocation;
+}
+
+///////////////////////////////////////////
+VkDeviceSize VulkanUniformAllocator::GetAlignedSize(VkDeviceSize size) const
+{
+	return ((size + m_alignment - 1) / m_alignment) * m_alignment;
+}
+
+///////////////////////////////////////////
+VkDescriptorSetLayout VulkanUniformAllocator::GetDescriptorSetLayout() const
+{
+	return m_descriptorSetLayout;
+}
+
+///////////////////////////////////////////
+VkDescriptorSet VulkanUniformAllocator::GetDescriptorSet() const
+{
+	return m_descriptorSet;
+}
+
+///////////////////////////////////////////
+VkDeviceSize VulkanUniformAllocator::GetRegionSize() const
+{
+	return m_regionSize;
+}
+
+///////////////////////////////////////////
+VkDeviceSize VulkanUniformAllocator::GetRegionUsage() const
+{
+	return std::min(m_cursor.load(), m_regionSize);
+}
+
+///////////////////////////////////////////
+void VulkanUniformAllocator::CreateDescriptorSet(VkDeviceSize bindingRange)
+{
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	if (vkCreateDescriptorSetLayout(m_logicalDevice, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create uniform descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	poolSize.descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(m_logicalDevice, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create uniform descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &m_descriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(m_logicalDevice, &allocInfo, &m_descriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate uniform descriptor set!");
+	}
+
+	//The set is written once, the dynamic offset picks the region and the allocation every time it is bound
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = m_buffer.GetBuffer();
+	bufferInfo.offset = 0;
+	bufferInfo.range = bindingRange;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_descriptorSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	write.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(m_logicalDevice, 1, &write, 0, nullptr);
+}
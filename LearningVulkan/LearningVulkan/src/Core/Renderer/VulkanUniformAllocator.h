@@ -0,0 +1,61 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+
+#include <atomic>
+
+///////////////////////////////////////////
+//Where a piece of uniform data was written. offset is passed to vkCmdBindDescriptorSets as the dynamic offset
+struct UniformAllocation {
+	void* pData = nullptr;
+	uint32_t offset = 0;
+};
+
+///////////////////////////////////////////
+//Linear allocator over one persistently mapped buffer split into equal regions, one per frame in flight.
+//Allocating is an atomic bump of the region's cursor and BeginRegion() rewinds it, so per draw data costs no allocations and no map calls.
+//The buffer is bound through a single dynamic uniform buffer descriptor, every allocation is just a different dynamic offset into it
+class VulkanUniformAllocator
+{
+public:
+	//bindingRange is the most a shader reads from one dynamic offset, usually the size of the biggest per draw struct
+	void InitUniformAllocator(VulkanDevice* pDevice, uint32_t regionCount, VkDeviceSize regionSize, VkDeviceSize bindingRange);
+	void DestroyUniformAllocator();
+
+	//Rewinds the region, only call once the GPU has finished every submit that read from it
+	void BeginRegion(uint32_t regionIndex);
+
+	//Safe to call from several recording threads at once. The offset is aligned to minUniformBufferOffsetAlignment, throws if the region is full
+	UniformAllocation Allocate(VkDeviceSize size);
+	//Size rounded up so consecutive elements each start on a valid dynamic offset
+	VkDeviceSize GetAlignedSize(VkDeviceSize size) const;
+
+	//Set 0 of any pipeline layout reading from the allocator, binding 0 is the dynamic uniform buffer visible to every graphics stage
+	VkDescriptorSetLayout GetDescriptorSetLayout() const;
+	VkDescriptorSet GetDescriptorSet() const;
+
+	VkDeviceSize GetRegionSize() const;
+	//Bytes handed out from the current region, including alignment padding
+	VkDeviceSize GetRegionUsage() const;
+
+private:
+	void CreateDescriptorSet(VkDeviceSize bindingRange);
+
+private:
+	VkDevice m_logicalDevice = VK_NULL_HANDLE;
+	VulkanBuffer m_buffer;
+	VkDeviceSize m_alignment = 1;
+	VkDeviceSize m_regionSize = 0;
+	uint32_t m_regionCount = 0;
+
+	VkDeviceSize m_regionStart = 0;
+	std::atomic<VkDeviceSize> m_cursor{ 0 }; //Relative to m_regionStart
+
+	VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+};
@@ -0,0 +1,287 @@
+#include "VulkanUploadEngine.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+///////////////////////////////////////////
+//Every upload starts on this boundary, enough for any buffer copy and for copying into images with most optimalBufferCopyOffsetAlignment values
+static constexpr VkDeviceSize UPLOAD_ALIGNMENT = 16;
+
+///////////////////////////////////////////
+void VulkanUploadEngine::InitUploadEngine(VulkanDevice* pDevice, VkDeviceSize ringSize)
+{
+	m_pDevice = pDevice;
+	m_logicalDevice = pDevice->GetLogicalDevice();
+
+	QueueFamilyIndices queueFamilyIndices = pDevice->FindQueueFamiliesForPhysicalDevice();
+	m_transferFamily = queueFamilyIndices.transferFamily.value();
+	m_graphicsFamily = queueFamilyIndices.graphicsFamily.value();
+
+	m_transferTimeline.InitTimeline(pDevice);
+
+	//Coherent memory means writes through the mapping are visible to the copy as soon as it is submitted, no flushes needed
+	m_ringSize = std::max(ringSize, UPLOAD_ALIGNMENT);
+	m_stagingRing.InitBuffer(pDevice, m_ringSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	m_ringHead = 0;
+	m_ringTail = 0;
+
+	m_statistics = UploadStatistics();
+}
+
+///////////////////////////////////////////
+void VulkanUploadEngine::DestroyUploadEngine()
+{
+	m_transferTimeline.WaitForValue(m_transferTimeline.GetLastSubmittedValue());
+	ReclaimCompletedBatches();
+	m_transferTimeline.DestroyTimeline();
+
+	for (auto& batch : m_freeBatches) {
+		vkDestroyCommandPool(m_logicalDevice, batch.commandPool, nullptr);
+	}
+	m_freeBatches.clear();
+
+	m_stagingRing.DestroyBuffer();
+	m_pendingCopies.clear();
+	m_pendingAcquires.clear();
+}
+
+///////////////////////////////////////////
+void VulkanUploadEngine::UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* pData, VkDeviceSize size)
+{
+	//Chunks no bigger than a quarter of the ring let the copy engine work on one chunk while the next is being written
+	VkDeviceSize maxChunkSize = std::max(m_ringSize / 4, UPLOAD_ALIGNMENT);
+	const uint8_t* pSource = static_cast<const uint8_t*>(pData);
+
+	for (VkDeviceSize uploaded = 0; uploaded < size;) {
+		VkDeviceSize chunkSize = std::min(size - uploaded, maxChunkSize);
+		VkDeviceSize ringOffset = AllocateRingSpace(chunkSize);
+
+		memcpy(static_cast<uint8_t*>(m_stagingRing.GetMappedData()) + ringOffset, pSource + uploaded, chunkSize);
+
+		PendingCopy copy{};
+		copy.dstBuffer = dstBuffer;
+		copy.region.srcOffset = ringOffset;
+		copy.region.dstOffset = dstOffset + uploaded;
+		copy.region.size = chunkSize;
+		m_pendingCopies.push_back(copy);
+
+		uploaded += chunkSize;
+	}
+
+	m_statistics.bytesUploaded += size;
+}
+
+///////////////////////////////////////////
+uint64_t VulkanUploadEngine::Flush()
+{
+	ReclaimCompletedBatches();
+
+	if (m_pendingCopies.empty()) {
+		return 0;
+	}
+
+	UploadBatch batch = GetFreeBatch();
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(batch.commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin upload command buffer!");
+	}
+
+	//Consecutive copies into the same buffer share one vkCmdCopyBuffer
+	std::vector<VkBufferCopy> regions;
+	for (size_t i = 0; i < m_pendingCopies.size(); ++i) {
+		regions.push_back(m_pendingCopies[i].region);
+
+		bool bLastForBuffer = i + 1 == m_pendingCopies.size() || m_pendingCopies[i + 1].dstBuffer != m_pendingCopies[i].dstBuffer;
+		if (bLastForBuffer) {
+			vkCmdCopyBuffer(batch.commandBuffer, m_stagingRing.GetBuffer(), m_pendingCopies[i].dstBuffer, static_cast<uint32_t>(regions.size()), regions.data());
+			regions.clear();
+		}
+	}
+
+	QueueOwnershipTransfer transfer = GetOwnershipTransfer();
+	for (const auto& copy : m_pendingCopies) {
+		VulkanQueueOwnership::ReleaseBuffer(batch.commandBuffer, copy.dstBuffer, copy.region.dstOffset, copy.region.size, transfer);
+	}
+
+	if (vkEndCommandBuffer(batch.commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to record upload command buffer!");
+	}
+
+	batch.timelineValue = m_transferTimeline.Submit(m_pDevice->GetTransferQueue(), { batch.commandBuffer }, {}, {});
+	batch.ringEnd = m_ringHead;
+	m_inFlightBatches.push_back(batch);
+
+	for (const auto& copy : m_pendingCopies) {
+		m_pendingAcquires.push_back({ copy.dstBuffer, copy.region.dstOffset, copy.region.size, batch.timelineValue });
+	}
+
+	m_statistics.copyCount += m_pendingCopies.size();
+	m_statistics.batchCount++;
+	m_pendingCopies.clear();
+
+	return batch.timelineValue;
+}
+
+///////////////////////////////////////////
+void VulkanUploadEngine::WaitIdle()
+{
+	Flush();
+	m_transferTimeline.WaitForValue(m_transferTimeline.GetLastSubmittedValue());
+	ReclaimCompletedBatches();
+}
+
+///////////////////////////////////////////
+TimelineWait VulkanUploadEngine::RecordAcquires(VkCommandBuffer commandBuffer)
+{
+	TimelineWait wait{};
+	if (m_pendingAcquires.empty()) {
+		return wait;
+	}
+
+	QueueOwnershipTransfer transfer = GetOwnershipTransfer();
+	for (const auto& acquire : m_pendingAcquires) {
+		VulkanQueueOwnership::AcquireBuffer(commandBuffer, acquire.buffer, acquire.offset, acquire.size, transfer);
+		wait.value = std::max(wait.value, acquire.timelineValue);
+	}
+	m_pendingAcquires.clear();
+
+	wait.semaphore = m_transferTimeline.GetSemaphore();
+	wait.stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	return wait;
+}
+
+///////////////////////////////////////////
+bool VulkanUploadEngine::HasPendingAcquires() const
+{
+	return !m_pendingAcquires.empty();
+}
+
+///////////////////////////////////////////
+const UploadStatistics& VulkanUploadEngine::GetStatistics() const
+{
+	return m_statistics;
+}
+
+///////////////////////////////////////////
+void VulkanUploadEngine::WriteJson(JsonWriter& writer) const
+{
+	writer.Write("ringSize", static_cast<uint64_t>(m_ringSize));
+	writer.Write("bytesUploaded", m_statistics.bytesUploaded);
+	writer.Write("copies", m_statistics.copyCount);
+	writer.Write("batches", m_statistics.batchCount);
+	writer.Write("ringStalls", m_statistics.ringStalls);
+}
+
+///////////////////////////////////////////
+VkDeviceSize VulkanUploadEngine::AllocateRingSpace(VkDeviceSize size)
+{
+	if (size > m_ringSize) {
+		throw std::runtime_error("Upload is larger than the staging ring!");
+	}
+
+	bool bStalled = false;
+	while (true) {
+		//An idle ring starts again from offset 0 so even a full ring sized upload fits
+		if (m_ringTail == m_ringHead) {
+			m_ringHead = ((m_ringHead + m_ringSize - 1) / m_ringSize) * m_ringSize;
+			m_ringTail = m_ringHead;
+		}
+
+		uint64_t start = ((m_ringHead + UPLOAD_ALIGNMENT - 1) / UPLOAD_ALIGNMENT) * UPLOAD_ALIGNMENT;
+		VkDeviceSize offset = start % m_ringSize;
+
+		//Allocations never wrap around the end of the ring, the leftover bytes are skipped
+		if (offset + size > m_ringSize) {
+			start += m_ringSize - offset;
+			offset = 0;
+		}
+
+		if (start + size - m_ringTail <= m_ringSize) {
+			m_ringHead = start + size;
+			return offset;
+		}
+
+		//The ring is full. Submit whatever is still queued so it can finish, then wait for the oldest batch to hand its space back
+		if (!bStalled) {
+			m_statistics.ringStalls++;
+			bStalled = true;
+		}
+
+		if (!m_pendingCopies.empty()) {
+			Flush();
+		}
+		else if (!m_inFlightBatches.empty()) {
+			m_transferTimeline.WaitForValue(m_inFlightBatches.front().timelineValue);
+			ReclaimCompletedBatches();
+		}
+		else {
+			throw std::runtime_error("Failed to allocate staging ring space!");
+		}
+	}
+}
+
+///////////////////////////////////////////
+void VulkanUploadEngine::ReclaimCompletedBatches()
+{
+	while (!m_inFlightBatches.empty() && m_transferTimeline.IsValueComplete(m_inFlightBatches.front().timelineValue)) {
+		UploadBatch& batch = m_inFlightBatches.front();
+		m_ringTail = batch.ringEnd;
+
+		vkResetCommandPool(m_logicalDevice, batch.commandPool, 0);
+		m_freeBatches.push_back(batch);
+		m_inFlightBatches.pop_front();
+	}
+}
+
+///////////////////////////////////////////
+VulkanUploadEngine::UploadBatch VulkanUploadEngine::GetFreeBatch()
+{
+	if (!m_freeBatches.empty()) {
+		UploadBatch batch = m_freeBatches.back();
+		m_freeBatches.pop_back();
+		return batch;
+	}
+
+	//One pool per batch so a finished batch is reset with a single vkResetCommandPool
+	UploadBatch batch{};
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = m_transferFamily;
+
+	if (vkCreateCommandPool(m_logicalDevice, &poolInfo, nullptr, &batch.commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create upload command pool!");
+	}
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = batch.commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	if (vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, &batch.commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate upload command buffer!");
+	}
+
+	return batch;
+}
+
+///////////////////////////////////////////
+QueueOwnershipTransfer VulkanUploadEngine::GetOwnershipTransfer() const
+{
+	//The engine does not know what the graphics queue will do with the data, so the acquire makes it visible to every read
+	QueueOwnershipTransfer transfer{};
+	transfer.srcQueueFamily = m_transferFamily;
+	transfer.dstQueueFamily = m_graphicsFamily;
+	transfer.srcStage = VK_PIPELINE_STAGE_2_COPY_BIT;
+	transfer.srcAccess = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	transfer.dstStage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	transfer.dstAccess = VK_ACCESS_2_MEMORY_READ_BIT;
+	return transfer;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include "VulkanDevice.h"
+#include "VulkanBuffer.h"
+#include "VulkanTimeline.h"
+#include "VulkanQueueOwnership.h"
+#include "../Profiling/JsonWriter.h"
+
+#include <deque>
+#include <vector>
+
+///////////////////////////////////////////
+struct UploadStatistics {
+	uint64_t bytesUploaded = 0;
+	uint64_t copyCount = 0;
+	uint64_t batchCount = 0; //Transfer submits, one per Flush() that had work
+	uint64_t ringStalls = 0; //Times an upload had to wait for the GPU to free ring space
+};
+
+///////////////////////////////////////////
+//The single path for getting data into device local buffers. Uploads are written straight into a persistently mapped staging ring,
+//each Flush() copies everything queued since the last one in one command buffer on the transfer queue and signals a value on the engine's own timeline.
+//Ring space is handed back once the GPU passes that value, so nothing is ever allocated per upload.
+//When the transfer family differs from graphics the written ranges are released by the transfer queue and have to be acquired with RecordAcquires() before graphics reads them.
+class VulkanUploadEngine
+{
+public:
+	void InitUploadEngine(VulkanDevice* pDevice, VkDeviceSize ringSize);
+	//Waits for every submitted batch before destroying the ring
+	void DestroyUploadEngine();
+
+	//Copies the data into the ring straight away so pData can be freed on return, the GPU copy happens with the next Flush().
+	//dstBuffer needs TRANSFER_DST usage and the range must not be in use by the GPU or uploaded twice in the same batch.
+	//Uploads bigger than a quarter of the ring are split, flushing and waiting for ring space as needed
+	void UploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* pData, VkDeviceSize size);
+
+	//Submits every queued copy in one transfer command buffer. Returns the transfer timeline value signalled once they have landed, 0 if nothing was queued
+	uint64_t Flush();
+	//Flushes and blocks until every upload has landed
+	void WaitIdle();
+
+	//Records the graphics queue half of the ownership transfer for every flushed upload not acquired yet.
+	//The returned wait must be added to the submit executing commandBuffer, its semaphore is null when there was nothing to acquire
+	TimelineWait RecordAcquires(VkCommandBuffer commandBuffer);
+	bool HasPendingAcquires() const;
+
+	const UploadStatistics& GetStatistics() const;
+	void WriteJson(JsonWriter& writer) const;
+
+private:
+	//One transfer command buffer and the ring space its copies read from
+	struct UploadBatch {
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		uint64_t timelineValue = 0;
+		uint64_t ringEnd = 0; //The ring tail moves here once the batch has finished
+	};
+
+	struct PendingCopy {
+		VkBuffer dstBuffer;
+		VkBufferCopy region;
+	};
+
+	struct PendingAcquire {
+		VkBuffer buffer;
+		VkDeviceSize offset;
+		VkDeviceSize size;
+		uint64_t timelineValue;
+	};
+
+	//Returns the ring offset of size free bytes, waiting for in flight batches when the ring is full
+	VkDeviceSize AllocateRingSpace(VkDeviceSize size);
+	//Hands back the ring space and command pools of every batch the GPU has finished
+	void ReclaimCompletedBatches();
+	UploadBatch GetFreeBatch();
+
+	//Transfer queue writes handed to the graphics queue
+	QueueOwnershipTransfer GetOwnershipTransfer() const;
+
+private:
+	VulkanDevice* m_pDevice = nullptr;
+	VkDevice m_logicalDevice = VK_NULL_HANDLE;
+	uint32_t m_transferFamily = 0;
+	uint32_t m_graphicsFamily = 0;
+
+	VulkanTimeline m_transferTimeline;
+
+	//Head and tail only ever grow, the ring offset is the position modulo the ring size
+	VulkanBuffer m_stagingRing;
+	VkDeviceSize m_ringSize = 0;
+	uint64_t m_ringHead = 0;
+	uint64_t m_ringTail = 0;
+
+	std::vector<PendingCopy> m_pendingCopies;
+	std::vector<PendingAcquire> m_pendingAcquires;
+
+	std::deque<UploadBatch> m_inFlightBatches;
+	std::vector<UploadBatch> m_freeBatches;
+
+	UploadStatistics m_statistics;
+};
@@ -0,0 +1,91 @@
+#include "VulkanVertexLayout.h"
+
+#include <stdexcept>
+
+///////////////////////////////////////////
+VulkanVertexLayout& VulkanVertexLayout::AddBinding(uint32_t stride, VkVertexInputRate inputRate)
+{
+	VkVertexInputBindingDescription binding{};
+	binding.binding = static_cast<uint32_t>(m_bindings.size());
+	binding.stride = stride;
+	binding.inputRate = inputRate;
+	m_bindings.push_back(binding);
+
+	return *this;
+}
+
+///////////////////////////////////////////
+VulkanVertexLayout& VulkanVertexLayout::AddAttribute(uint32_t location, VkFormat format, uint32_t offset)
+{
+	if (m_bindings.empty()) {
+		throw std::runtime_error("Vertex attributes need a binding to read from!");
+	}
+
+	const VkVertexInputBindingDescription& binding = m_bindings.back();
+	uint32_t formatSize = GetFormatSize(format);
+	if (formatSize != 0 && offset + formatSize > binding.stride) {
+		throw std::runtime_error("Vertex attribute does not fit inside its binding's stride!");
+	}
+
+	VkVertexInputAttributeDescription attribute{};
+	attribute.location = location;
+	attribute.binding = binding.binding;
+	attribute.format = format;
+	attribute.offset = offset;
+	m_attributes.push_back(attribute);
+
+	return *this;
+}
+
+///////////////////////////////////////////
+const std::vector<VkVertexInputBindingDescription>& VulkanVertexLayout::GetBindingDescriptions() const
+{
+	return m_bindings;
+}
+
+///////////////////////////////////////////
+const std::vector<VkVertexInputAttributeDescription>& VulkanVertexLayout::GetAttributeDescriptions() const
+{
+	return m_attributes;
+}
+
+///////////////////////////////////////////
+uint32_t VulkanVertexLayout::GetStride(uint32_t binding) const
+{
+	return binding < m_bindings.size() ? m_bindings[binding].stride : 0;
+}
+
+///////////////////////////////////////////
+uint32_t VulkanVertexLayout::GetFormatSize(VkFormat format)
+{
+	switch (format) {
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SNORM:
+	case VK_FORMAT_R8G8B8A8_UINT:
+	case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+	case VK_FORMAT_R16G16_SFLOAT:
+	case VK_FORMAT_R16G16_UNORM:
+	case VK_FORMAT_R16G16_SNORM:
+	case VK_FORMAT_R32_SFLOAT:
+	case VK_FORMAT_R32_UINT:
+	case VK_FORMAT_R32_SINT:
+		return 4;
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+	case VK_FORMAT_R16G16B16A16_UNORM:
+	case VK_FORMAT_R16G16B16A16_SNORM:
+	case VK_FORMAT_R32G32_SFLOAT:
+	case VK_FORMAT_R32G32_UINT:
+	case VK_FORMAT_R32G32_SINT:
+		return 8;
+	case VK_FORMAT_R32G32B32_SFLOAT:
+	case VK_FORMAT_R32G32B32_UINT:
+	case VK_FORMAT_R32G32B32_SINT:
+		return 12;
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+	case VK_FORMAT_R32G32B32A32_UINT:
+	case VK_FORMAT_R32G32B32A32_SINT:
+		return 16;
+	default:
+		return 0;
+	}
+}
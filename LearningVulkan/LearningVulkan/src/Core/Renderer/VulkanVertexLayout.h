@@ -0,0 +1,29 @@
+#pragma once
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#undef GLFW_INCLUDE_VULKAN
+
+#include <vector>
+
+///////////////////////////////////////////
+//Describes how vertex buffers are laid out and generates the binding and attribute descriptions a pipeline needs from it.
+//Attributes belong to the binding added most recently, so an interleaved vertex is one AddBinding() followed by one AddAttribute() per member
+class VulkanVertexLayout
+{
+public:
+	//Bindings are numbered in the order they are added, matching the order vkCmdBindVertexBuffers() expects them in
+	VulkanVertexLayout& AddBinding(uint32_t stride, VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX);
+	//Throws if no binding has been added yet or the attribute does not fit inside the binding's stride
+	VulkanVertexLayout& AddAttribute(uint32_t location, VkFormat format, uint32_t offset);
+
+	const std::vector<VkVertexInputBindingDescription>& GetBindingDescriptions() const;
+	const std::vector<VkVertexInputAttributeDescription>& GetAttributeDescriptions() const;
+	uint32_t GetStride(uint32_t binding) const;
+
+	//Size in bytes of the formats a vertex attribute is likely to use, 0 for anything else
+	static uint32_t GetFormatSize(VkFormat format);
+
+private:
+	std::vector<VkVertexInputBindingDescription> m_bindings;
+	std::vector<VkVertexInputAttributeDescription> m_attributes;
+};
@@ -0,0 +1,549 @@
+#include "TransformHierarchy.h"
+
+#include <glm/simd/common.h>
+
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+///////////////////////////////////////////
+//Slots per job, a few microseconds of matrix maths each so the scheduling cost stays small
+constexpr uint32_t TRANSFORM_BATCH_SIZE = 1024;
+//A small update is a scatter of short subtrees across arrays far bigger than the cache, so each batch asks for the memory of the one this far ahead
+constexpr uint32_t TRANSFORM_PREFETCH_DISTANCE = 8;
+//Nodes at the start of a batch that are prefetched, the hardware prefetcher picks up the rest of a long one
+constexpr uint32_t TRANSFORM_PREFETCH_NODES = 8;
+
+///////////////////////////////////////////
+//Parent world matrix of every root, so roots take the same path as every other node
+static const glm::mat4 ROOT_PARENT_WORLD(1.0f);
+
+///////////////////////////////////////////
+//Index of the lowest set bit, bits must not be 0
+static uint32_t LowestSetBit(uint64_t bits)
+{
+#ifdef _MSC_VER
+	unsigned long index = 0;
+	_BitScanForward64(&index, bits);
+	return index;
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(bits));
+#endif
+}
+
+///////////////////////////////////////////
+//Asks for the cache lines holding count elements from pFirst without waiting for them
+template<typename T>
+static void PrefetchElements(const T* pFirst, uint32_t count)
+{
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+	const char* pEnd = reinterpret_cast<const char*>(pFirst + count);
+	for (const char* pLine = reinterpret_cast<const char*>(reinterpret_cast<uintptr_t>(pFirst) & ~uintptr_t(63)); pLine < pEnd; pLine += 64) {
+		_mm_prefetch(pLine, _MM_HINT_T0);
+	}
+#endif
+}
+
+///////////////////////////////////////////
+//Moves element order[i] of values to index i
+template<typename T>
+static void ReorderArray(std::vector<T>& values, const std::vector<uint32_t>& order)
+{
+	std::vector<T> sorted;
+	sorted.reserve(values.size());
+	for (uint32_t slot : order) {
+		sorted.push_back(values[slot]);
+	}
+	values.swap(sorted);
+}
+
+///////////////////////////////////////////
+void TransformHierarchy::Reserve(size_t nodeCount)
+{
+	m_position.reserve(nodeCount);
+	m_rotation.reserve(nodeCount);
+	m_scale.reserve(nodeCount);
+	m_world.reserve(nodeCount);
+	m_parentSlot.reserve(nodeCount);
+	m_subtreeSize.reserve(nodeCount);
+	m_handle.reserve(nodeCount);
+	m_dirtyBits.reserve((nodeCount + 63) / 64);
+	m_slotOfHandle.reserve(nodeCount);
+}
+
+///////////////////////////////////////////
+void TransformHierarchy::Clear()
+{
+	m_position.clear();
+	m_rotation.clear();
+	m_scale.clear();
+	m_world.clear();
+	m_parentSlot.clear();
+	m_subtreeSize.clear();
+	m_handle.clear();
+	m_dirtyBits.clear();
+	m_slotOfHandle.clear();
+	m_bNeedsSort = true;
+}
+
+///////////////////////////////////////////
+NodeHandle TransformHierarchy::AddNode(NodeHandle parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	uint32_t parentSlot = UINT32_MAX;
+	if (parent != INVALID_NODE_HANDLE) {
+		if (parent >= m_slotOfHandle.size()) {
+			throw std::runtime_error("Transform node parent does not exist!");
+		}
+		parentSlot = m_slotOfHandle[parent];
+	}
+
+	//Appended after every existing node, so parents still come before children until the next sort makes the subtrees contiguous
+	uint32_t slot = static_cast<uint32_t>(m_handle.size());
+	NodeHandle handle = static_cast<NodeHandle>(m_slotOfHandle.size());
+	m_position.push_back(position);
+	m_rotation.push_back(rotation);
+	m_scale.push_back(scale);
+	m_world.push_back(glm::mat4(1.0f));
+	m_parentSlot.push_back(parentSlot);
+	m_subtreeSize.push_back(1);
+	m_handle.push_back(handle);
+	if (slot % 64 == 0) {
+		m_dirtyBits.push_back(0);
+	}
+	m_slotOfHandle.push_back(slot);
+
+	m_bNeedsSort = true;
+	return handle;
+}
+
+///////////////////////////////////////////
+void TransformHierarchy::SetLocalTransform(NodeHandle node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	uint32_t slot = m_slotOfHandle[node];
+	m_position[slot] = position;
+	m_rotation[slot] = rotation;
+	m_scale[slot] = scale;
+	m_dirtyBits[slot / 64] |= uint64_t(1) << (slot % 64);
+}
+
+///////////////////////////////////////////
+const glm::mat4& TransformHierarchy::GetWorldMatrix(NodeHandle node) const
+{
+	return m_world[m_slotOfHandle[node]];
+}
+
+///////////////////////////////////////////
+size_t TransformHierarchy::GetNodeCount() const
+{
+	return m_handle.size();
+}
+
+///////////////////////////////////////////
+uint32_t TransformHierarchy::GetDepth() const
+{
+	return m_depth;
+}
+
+///////////////////////////////////////////
+void TransformHierarchy::SetDestinationCount(uint32_t destinationCount)
+{
+	destinationCount = std::max(destinationCount, 1u);
+	m_destinationStamp.assign(destinationCount, 0);
+	m_history.assign(destinationCount, UpdateHistory());
+}
+
+///////////////////////////////////////////
+uint32_t TransformHierarchy::UpdateWorldMatrices(JobSystem* pJobSystem, glm::mat4* pDestination, uint32_t destinationIndex)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	if (m_destinationStamp.empty()) {
+		SetDestinationCount(1);
+	}
+	if (destinationIndex >= m_destinationStamp.size()) {
+		throw std::runtime_error("Transform destination index is out of range!");
+	}
+
+	uint64_t stamp = ++m_updateCounter;
+	uint32_t nodeCount = static_cast<uint32_t>(m_handle.size());
+
+	//The new order invalidates every slot index, so the whole hierarchy is recomputed and every destination rewritten
+	m_dirtyRanges.clear();
+	if (m_bNeedsSort) {
+		SortNodes();
+		SlotRange everything;
+		everything.count = nodeCount;
+		m_dirtyRanges.push_back(everything);
+	}
+	else {
+		CollectDirtyRanges(m_dirtyRanges);
+	}
+
+	//The destination was last written a few updates ago, so it first gets whatever the updates in between changed, oldest first so the newest matrix lands last.
+	//A destination that is about to be rewritten in full needs none of it
+	uint32_t copiedCount = 0;
+	uint64_t destinationStamp = m_destinationStamp[destinationIndex];
+	if (!(m_dirtyRanges.size() == 1 && m_dirtyRanges[0].count == nodeCount)) {
+		bool bCopyEverything = destinationStamp == 0 || destinationStamp + m_history.size() < stamp;
+		for (uint64_t previousStamp = destinationStamp + 1; previousStamp < stamp && !bCopyEverything; ++previousStamp) {
+			bCopyEverything = m_history[previousStamp % m_history.size()].bEverything;
+		}
+
+		if (bCopyEverything) {
+			SplitEvenly(nodeCount);
+			RunBatches(pJobSystem, [this, pDestination](uint32_t batch) {
+				for (uint32_t slot = m_batches[batch].first; slot < m_batches[batch].first + m_batches[batch].count; ++slot) {
+					pDestination[m_handle[slot]] = m_world[slot];
+				}
+			});
+			copiedCount = nodeCount;
+		}
+		else {
+			for (uint64_t previousStamp = destinationStamp + 1; previousStamp < stamp; ++previousStamp) {
+				const UpdateHistory& previous = m_history[previousStamp % m_history.size()];
+				SplitEvenly(previous.count);
+				RunBatches(pJobSystem, [this, pDestination, &previous](uint32_t batch) {
+					for (uint32_t i = m_batches[batch].first; i < m_batches[batch].first + m_batches[batch].count; ++i) {
+						pDestination[previous.handles[i]] = previous.worlds[i];
+					}
+				});
+				copiedCount += previous.count;
+			}
+		}
+	}
+
+	uint32_t updatedCount = 0;
+	for (const SlotRange& range : m_dirtyRanges) {
+		updatedCount += range.count;
+	}
+
+	//Recorded for the other destinations' catch up, which is only worth it while a small part of the hierarchy changes
+	UpdateHistory& history = m_history[stamp % m_history.size()];
+	history.stamp = stamp;
+	history.bEverything = updatedCount > nodeCount / 2;
+	history.count = history.bEverything ? 0 : updatedCount;
+	if (history.worlds.size() < history.count) {
+		history.handles.resize(history.count);
+		history.worlds.resize(history.count);
+	}
+	UpdateHistory* pHistory = history.bEverything ? nullptr : &history;
+
+	SplitIntoBatches(m_dirtyRanges, pDestination, pHistory);
+	RunBatches(pJobSystem, [this, pDestination, pHistory](uint32_t batch) {
+		if (batch + TRANSFORM_PREFETCH_DISTANCE < m_batches.size()) {
+			PrefetchRange(m_batches[batch + TRANSFORM_PREFETCH_DISTANCE], pDestination);
+		}
+		UpdateRange(m_batches[batch], pDestination, pHistory, m_batchIndex[batch]);
+	});
+	m_destinationStamp[destinationIndex] = stamp;
+
+	std::chrono::duration<double, std::micro> elapsed = std::chrono::high_resolution_clock::now() - start;
+	m_statistics.updateCount++;
+	m_statistics.lastUpdatedNodes = updatedCount;
+	m_statistics.lastCopiedNodes = copiedCount;
+	m_statistics.lastUpdateUs = elapsed.count();
+	m_statistics.maxUpdateUs = std::max(m_statistics.maxUpdateUs, elapsed.count());
+	m_statistics.totalUpdateUs += elapsed.count();
+
+	return updatedCount;
+}
+
+///////////////////////////////////////////
+const TransformUpdateStatistics& TransformHierarchy::GetStatistics() const
+{
+	return m_statistics;
+}
+
+///////////////////////////////////////////
+void TransformHierarchy::WriteJson(JsonWriter& writer) const
+{
+	writer.Write("nodes", static_cast<uint64_t>(m_handle.size()));
+	writer.Write("depth", m_depth);
+	writer.Write("updates", m_statistics.updateCount);
+	writer.Write("lastUpdatedNodes", m_statistics.lastUpdatedNodes);
+	writer.Write("lastCopiedNodes", m_statistics.lastCopiedNodes);
+	writer.Write("lastUpdateUs", m_statistics.lastUpdateUs);
+	writer.Write("meanUpdateUs", m_statistics.updateCount > 0 ? m_statistics.totalUpdateUs / m_statistics.updateCount : 0.0);
+	writer.Write("maxUpdateUs", m_statistics.maxUpdateUs);
+}
+
+///////////////////////////////////////////
+void TransformHierarchy::SortNodes()
+{
+	uint32_t nodeCount = static_cast<uint32_t>(m_handle.size());
+
+	//Children of each slot in slot order, counted first then laid out back to back
+	std::vector<uint32_t> childStart(nodeCount + 1, 0);
+	for (uint32_t slot = 0; slot < nodeCount; ++slot) {
+		if (m_parentSlot[slot] != UINT32_MAX) {
+			childStart[m_parentSlot[slot] + 1]++;
+		}
+	}
+	for (uint32_t slot = 0; slot < nodeCount; ++slot) {
+		childStart[slot + 1] += childStart[slot];
+	}
+	std::vector<uint32_t> children(childStart[nodeCount]);
+	std::vector<uint32_t> childCursor(childStart.begin(), childStart.end() - 1);
+	for (uint32_t slot = 0; slot < nodeCount; ++slot) {
+		if (m_parentSlot[slot] != UINT32_MAX) {
+			children[childCursor[m_parentSlot[slot]]++] = slot;
+		}
+	}
+
+	//Depth first from each root in turn. Children are pushed in reverse so they come out in the order they were added
+	std::vector<uint32_t> order;
+	order.reserve(nodeCount);
+	std::vector<uint32_t> stack;
+	for (uint32_t root = 0; root < nodeCount; ++root) {
+		if (m_parentSlot[root] != UINT32_MAX) {
+			continue;
+		}
+
+		stack.push_back(root);
+		while (!stack.empty()) {
+			uint32_t slot = stack.back();
+			stack.pop_back();
+			order.push_back(slot);
+			for (uint32_t child = childStart[slot + 1]; child > childStart[slot]; --child) {
+				stack.push_back(children[child - 1]);
+			}
+		}
+	}
+
+	std::vector<uint32_t> newSlot(nodeCount);
+	for (uint32_t i = 0; i < nodeCount; ++i) {
+		newSlot[order[i]] = i;
+	}
+
+	ReorderArray(m_position, order);
+	ReorderArray(m_rotation, order);
+	ReorderArray(m_scale, order);
+	ReorderArray(m_handle, order);
+	ReorderArray(m_parentSlot, order);
+
+	//Children now come after their parent, so walking backwards finishes every subtree before its root
+	std::vector<uint32_t> depth(nodeCount, 1);
+	m_depth = 0;
+	for (uint32_t slot = 0; slot < nodeCount; ++slot) {
+		if (m_parentSlot[slot] != UINT32_MAX) {
+			m_parentSlot[slot] = newSlot[m_parentSlot[slot]];
+			depth[slot] = depth[m_parentSlot[slot]] + 1;
+		}
+		m_depth = std::max(m_depth, depth[slot]);
+		m_slotOfHandle[m_handle[slot]] = slot;
+	}
+	m_bHandlesInSlotOrder = true;
+	for (uint32_t slot = 0; slot < nodeCount; ++slot) {
+		m_bHandlesInSlotOrder = m_bHandlesInSlotOrder && m_handle[slot] == slot;
+	}
+	std::fill(m_subtreeSize.begin(), m_subtreeSize.end(), 1);
+	for (uint32_t slot = nodeCount; slot > 0; --slot) {
+		uint32_t parent = m_parentSlot[slot - 1];
+		if (parent != UINT32_MAX) {
+			m_subtreeSize[parent] += m_subtreeSize[slot - 1];
+		}
+	}
+
+	//Everything is about to be recomputed, so nothing stays flagged and every destination gets a full copy
+	std::fill(m_dirtyBits.begin(), m_dirtyBits.end(), 0);
+	std::fill(m_destinationStamp.begin(), m_destinationStamp.end(), 0);
+	m_bNeedsSort = false;
+}
+
+///////////////////////////////////////////
+void TransformHierarchy::CollectDirtyRanges(std::vector<SlotRange>& ranges)
+{
+	//The flags are walked in slot order, skipping empty words, so no sort is needed. A flagged node inside the previous range is recomputed with it.
+	//Subtrees that follow each other are merged, a run of sibling subtrees is still safe to update front to back
+	uint32_t coveredEnd = 0;
+	for (uint32_t word = 0; word < m_dirtyBits.size(); ++word) {
+		uint64_t bits = m_dirtyBits[word];
+		if (bits == 0) {
+			continue;
+		}
+		m_dirtyBits[word] = 0;
+
+		while (bits != 0) {
+			uint32_t slot = word * 64 + LowestSetBit(bits);
+			bits &= bits - 1;
+			if (slot < coveredEnd) {
+				continue;
+			}
+
+			if (!ranges.empty() && slot == coveredEnd) {
+				ranges.back().count += m_subtreeSize[slot];
+			}
+			else {
+				SlotRange range;
+				range.first = slot;
+				range.count = m_subtreeSize[slot];
+				ranges.push_back(range);
+			}
+			coveredEnd = slot + m_subtreeSize[slot];
+		}
+	}
+}
+
+///////////////////////////////////////////
+void TransformHierarchy::SplitIntoBatches(const std::vector<SlotRange>& ranges, glm::mat4* pDestination, UpdateHistory* pHistory)
+{
+	m_batches.clear();
+	m_batchIndex.clear();
+
+	//Nodes take history entries in the order they are handed out here
+	uint32_t index = 0;
+	std::vector<SlotRange> pending(ranges.rbegin(), ranges.rend());
+	while (!pending.empty()) {
+		SlotRange range = pending.back();
+		pending.pop_back();
+		if (range.count <= TRANSFORM_BATCH_SIZE) {
+			m_batches.push_back(range);
+			m_batchIndex.push_back(index);
+			index += range.count;
+			continue;
+		}
+
+		//Walk the range one top level subtree at a time, packing small ones together
+		uint32_t end = range.first + range.count;
+		uint32_t slot = range.first;
+		while (slot < end) {
+			if (m_subtreeSize[slot] <= TRANSFORM_BATCH_SIZE) {
+				SlotRange batch;
+				batch.first = slot;
+				while (slot < end && slot + m_subtreeSize[slot] - batch.first <= TRANSFORM_BATCH_SIZE) {
+					slot += m_subtreeSize[slot];
+				}
+				batch.count = slot - batch.first;
+				m_batches.push_back(batch);
+				m_batchIndex.push_back(index);
+				index += batch.count;
+			}
+			else {
+				//Its children only depend on it, so once it is done they split into independent subtrees
+				UpdateSlot(slot, pDestination, pHistory, index++);
+				SlotRange children;
+				children.first = slot + 1;
+				children.count = m_subtreeSize[slot] - 1;
+				pending.push_back(children);
+				slot += m_subtreeSize[slot];
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////
+void TransformHierarchy::SplitEvenly(uint32_t count)
+{
+	m_batches.clear();
+	for (uint32_t first = 0; first < count; first += TRANSFORM_BATCH_SIZE) {
+		SlotRange batch;
+		batch.first = first;
+		batch.count = std::min(count - first, TRANSFORM_BATCH_SIZE);
+		m_batches.push_back(batch);
+	}
+}
+
+///////////////////////////////////////////
+template<typename Function>
+void TransformHierarchy::RunBatches(JobSystem* pJobSystem, const Function& function)
+{
+	uint32_t slotCount = 0;
+	for (const SlotRange& batch : m_batches) {
+		slotCount += batch.count;
+	}
+
+	if (pJobSystem == nullptr || slotCount <= TRANSFORM_BATCH_SIZE) {
+		for (uint32_t i = 0; i < m_batches.size(); ++i) {
+			function(i);
+		}
+		return;
+	}
+
+	//Batches are anything from one node up to the batch size, so jobs take consecutive batches until they have about a batch worth of slots
+	std::vector<uint32_t> jobStart(1, 0);
+	uint32_t jobSlots = 0;
+	for (uint32_t i = 0; i < m_batches.size(); ++i) {
+		if (jobSlots > 0 && jobSlots + m_batches[i].count > TRANSFORM_BATCH_SIZE) {
+			jobStart.push_back(i);
+			jobSlots = 0;
+		}
+		jobSlots += m_batches[i].count;
+	}
+	jobStart.push_back(static_cast<uint32_t>(m_batches.size()));
+
+	pJobSystem->ParallelFor(static_cast<uint32_t>(jobStart.size() - 1), 1, [&jobStart, &function](uint32_t first, uint32_t count) {
+		for (uint32_t i = jobStart[first]; i < jobStart[first + count]; ++i) {
+			function(i);
+		}
+	});
+}
+
+///////////////////////////////////////////
+void TransformHierarchy::PrefetchRange(SlotRange range, const glm::mat4* pDestination) const
+{
+	uint32_t slot = range.first;
+	uint32_t count = std::min(range.count, TRANSFORM_PREFETCH_NODES);
+	PrefetchElements(&m_position[slot], count);
+	PrefetchElements(&m_rotation[slot], count);
+	PrefetchElements(&m_scale[slot], count);
+	PrefetchElements(&m_world[slot], count);
+	PrefetchElements(&m_parentSlot[slot], count);
+	PrefetchElements(&m_handle[slot], count);
+	if (m_bHandlesInSlotOrder) {
+		PrefetchElements(&pDestination[slot], count);
+	}
+}
+
+///////////////////////////////////////////
+void TransformHierarchy::UpdateRange(SlotRange range, glm::mat4* pDestination, UpdateHistory* pHistory, uint32_t index)
+{
+	for (uint32_t slot = range.first; slot < range.first + range.count; ++slot) {
+		UpdateSlot(slot, pDestination, pHistory, index + (slot - range.first));
+	}
+}
+
+///////////////////////////////////////////
+void TransformHierarchy::UpdateSlot(uint32_t slot, glm::mat4* pDestination, UpdateHistory* pHistory, uint32_t index)
+{
+	//Translation * rotation * scale without building the three matrices
+	glm::mat3 rotation = glm::mat3_cast(m_rotation[slot]);
+	const glm::vec3& scale = m_scale[slot];
+	glm::mat4 local(
+		glm::vec4(rotation[0] * scale.x, 0.0f),
+		glm::vec4(rotation[1] * scale.y, 0.0f),
+		glm::vec4(rotation[2] * scale.z, 0.0f),
+		glm::vec4(m_position[slot], 1.0f));
+
+	uint32_t parent = m_parentSlot[slot];
+	const glm::mat4& parentWorld = parent == UINT32_MAX ? ROOT_PARENT_WORLD : m_world[parent];
+	glm::mat4& world = m_world[slot];
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+	//glm multiplies its default unaligned matrices a component at a time. The local matrix is affine, so each world column is the parent's first three columns weighted by it, plus the parent's translation for the last
+	glm_vec4 parentColumns[4];
+	for (int column = 0; column < 4; ++column) {
+		parentColumns[column] = _mm_loadu_ps(&parentWorld[column].x);
+	}
+	for (int column = 0; column < 4; ++column) {
+		glm_vec4 result = glm_vec4_mul(parentColumns[0], _mm_set1_ps(local[column].x));
+		result = glm_vec4_add(result, glm_vec4_mul(parentColumns[1], _mm_set1_ps(local[column].y)));
+		result = glm_vec4_add(result, glm_vec4_mul(parentColumns[2], _mm_set1_ps(local[column].z)));
+		if (column == 3) {
+			result = glm_vec4_add(result, parentColumns[3]);
+		}
+		_mm_storeu_ps(&world[column].x, result);
+	}
+#else
+	world = parentWorld * local;
+#endif
+
+	//Whole matrices written in order, which is what write combined mapped memory wants
+	NodeHandle handle = m_handle[slot];
+	pDestination[handle] = world;
+	if (pHistory != nullptr) {
+		pHistory->handles[index] = handle;
+		pHistory->worlds[index] = world;
+	}
+}
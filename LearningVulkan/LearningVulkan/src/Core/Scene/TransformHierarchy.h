@@ -0,0 +1,116 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "../Threading/JobSystem.h"
+#include "../Profiling/JsonWriter.h"
+
+#include <cstdint>
+#include <vector>
+
+///////////////////////////////////////////
+//Stable identifier of a node, also its index into every destination buffer
+typedef uint32_t NodeHandle;
+constexpr NodeHandle INVALID_NODE_HANDLE = UINT32_MAX;
+
+///////////////////////////////////////////
+struct TransformUpdateStatistics {
+	uint64_t updateCount = 0;
+	uint32_t lastUpdatedNodes = 0; //World matrices recomputed by the last update
+	uint32_t lastCopiedNodes = 0; //Matrices changed by earlier updates that the last update's destination had not seen yet
+	double lastUpdateUs = 0.0;
+	double maxUpdateUs = 0.0;
+	double totalUpdateUs = 0.0;
+};
+
+///////////////////////////////////////////
+//Scene graph of local transforms stored as structure of arrays, sorted depth first so a parent always comes before its children and every subtree is one contiguous range of slots.
+//Setting a local transform only flags the node. UpdateWorldMatrices() merges the flagged subtrees into ranges, splits big ones at subtree boundaries and recomputes them in parallel batches,
+//writing each world matrix straight into the caller's (usually persistently mapped) destination at the node's handle.
+//Nodes added depth first keep handles in the sorted order, so those writes stream through the destination rather than scattering.
+//A destination is expected per frame in flight, each one is brought up to date with the changes made while it was in use
+class TransformHierarchy
+{
+public:
+	void Reserve(size_t nodeCount);
+	void Clear();
+
+	//parent must already exist, INVALID_NODE_HANDLE adds a root. Adding nodes resorts the hierarchy and rewrites every destination on the next update
+	NodeHandle AddNode(NodeHandle parent, const glm::vec3& position = glm::vec3(0.0f), const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+	void SetLocalTransform(NodeHandle node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+	//As of the last update
+	const glm::mat4& GetWorldMatrix(NodeHandle node) const;
+
+	size_t GetNodeCount() const;
+	//Nodes on the longest path from a root to a leaf, as of the last sort
+	uint32_t GetDepth() const;
+
+	//How many destinations UpdateWorldMatrices() is given in turn, usually the frames in flight. Every destination is rewritten in full on its next update
+	void SetDestinationCount(uint32_t destinationCount);
+	//pDestination holds one matrix per node and must not be in use by the GPU. Returns how many world matrices were recomputed.
+	//pJobSystem may be null, small updates run on the calling thread either way
+	uint32_t UpdateWorldMatrices(JobSystem* pJobSystem, glm::mat4* pDestination, uint32_t destinationIndex);
+
+	const TransformUpdateStatistics& GetStatistics() const;
+	void WriteJson(JsonWriter& writer) const;
+
+private:
+	//Slots [first, first + count)
+	struct SlotRange {
+		uint32_t first = 0;
+		uint32_t count = 0;
+	};
+
+	//What each of the last few updates recomputed, enough to catch up any destination written at most destinationCount updates ago.
+	//The changed matrices are kept back to back, so catching up streams through them instead of revisiting every changed subtree
+	struct UpdateHistory {
+		uint64_t stamp = 0;
+		bool bEverything = false; //Too much changed to keep, catching up copies the whole hierarchy
+		uint32_t count = 0; //Entries in use, the arrays only ever grow
+		std::vector<NodeHandle> handles;
+		std::vector<glm::mat4> worlds;
+	};
+
+	//Depth first reorder of every array, called by the first update after nodes were added
+	void SortNodes();
+	//Flagged slots in order, with any that sit inside an earlier one's subtree dropped. Each range is a whole subtree whose parent is already up to date
+	void CollectDirtyRanges(std::vector<SlotRange>& ranges);
+	//Cuts ranges of whole subtrees into batches that can run in any order. A subtree too big for one batch has its root computed here and its children's subtrees split in turn
+	void SplitIntoBatches(const std::vector<SlotRange>& ranges, glm::mat4* pDestination, UpdateHistory* pHistory);
+	//Fills m_batches with [0, count) cut into TRANSFORM_BATCH_SIZE pieces, for copies that have no order to respect
+	void SplitEvenly(uint32_t count);
+	//Calls function with the index of every batch in m_batches, grouped into jobs of about TRANSFORM_BATCH_SIZE slots
+	template<typename Function>
+	void RunBatches(JobSystem* pJobSystem, const Function& function);
+	//Starts loading the memory the first few nodes of range will need
+	void PrefetchRange(SlotRange range, const glm::mat4* pDestination) const;
+	//pHistory may be null, otherwise each recomputed node is also recorded there from entry index on
+	void UpdateRange(SlotRange range, glm::mat4* pDestination, UpdateHistory* pHistory, uint32_t index);
+	void UpdateSlot(uint32_t slot, glm::mat4* pDestination, UpdateHistory* pHistory, uint32_t index);
+
+private:
+	//Indexed by slot, the node's position in the sorted order
+	std::vector<glm::vec3> m_position;
+	std::vector<glm::quat> m_rotation;
+	std::vector<glm::vec3> m_scale;
+	std::vector<glm::mat4> m_world;
+	std::vector<uint32_t> m_parentSlot; //UINT32_MAX for roots
+	std::vector<uint32_t> m_subtreeSize; //The node and all its descendants, the subtree is [slot, slot + size)
+	std::vector<NodeHandle> m_handle;
+	std::vector<uint64_t> m_dirtyBits; //One bit per slot, flagged since the last update
+
+	std::vector<uint32_t> m_slotOfHandle;
+	uint32_t m_depth = 0;
+	bool m_bNeedsSort = false;
+	bool m_bHandlesInSlotOrder = false; //Every node was added depth first, so a slot is also its index into the destinations
+
+	std::vector<SlotRange> m_dirtyRanges; //Reused every update
+	std::vector<SlotRange> m_batches; //Reused every update
+	std::vector<uint32_t> m_batchIndex; //Where each batch's nodes start in the update's history
+
+	std::vector<UpdateHistory> m_history;
+	std::vector<uint64_t> m_destinationStamp; //Update that last wrote each destination, 0 when it needs a full rewrite
+	uint64_t m_updateCounter = 0;
+
+	TransformUpdateStatistics m_statistics;
+};
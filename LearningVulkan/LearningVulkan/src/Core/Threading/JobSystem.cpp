@@ -0,0 +1,292 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+//Lets a job pushed from a worker go onto that worker's own deque
+static thread_local JobSystem* t_pJobSystem = nullptr;
+static thread_local int t_workerIndex = -1;
+
+//How many times an idle worker looks for work before going to sleep
+constexpr uint32_t IDLE_SPIN_COUNT = 64;
+
+///////////////////////////////////////////
+bool JobCounter::IsDone() const
+{
+	return m_pendingCount.load() == 0;
+}
+
+///////////////////////////////////////////
+uint32_t JobCounter::GetPendingCount() const
+{
+	return m_pendingCount.load();
+}
+
+///////////////////////////////////////////
+void JobSystem::InitJobSystem(uint32_t threadCount)
+{
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+
+	m_bStopping = false;
+	for (uint32_t i = 0; i < threadCount; ++i) {
+		m_workers.push_back(std::make_unique<Worker>());
+	}
+
+	//Only start the threads once every deque exists, a worker may try to steal straight away
+	for (uint32_t i = 0; i < threadCount; ++i) {
+		m_workers[i]->thread = std::thread(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+///////////////////////////////////////////
+void JobSystem::DestroyJobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_bStopping = true;
+	}
+	m_wakeCondition.notify_all();
+
+	for (auto& worker : m_workers) {
+		worker->thread.join();
+	}
+	m_workers.clear();
+}
+
+///////////////////////////////////////////
+void JobSystem::Run(std::function<void()> job, JobCounter* pCounter, JobPriority priority, JobCounter* pDependency)
+{
+	if (pCounter != nullptr) {
+		pCounter->m_pendingCount.fetch_add(1);
+	}
+
+	if (pDependency != nullptr) {
+		std::lock_guard<std::mutex> lock(pDependency->m_mutex);
+		if (pDependency->m_pendingCount.load() > 0) {
+			pDependency->m_continuations.push_back({ std::move(job), pCounter, static_cast<int>(priority) });
+			return;
+		}
+	}
+
+	Job newJob;
+	newJob.function = std::move(job);
+	newJob.pCounter = pCounter;
+	Enqueue(std::move(newJob), priority);
+}
+
+///////////////////////////////////////////
+void JobSystem::Wait(JobCounter* pCounter)
+{
+	int workerIndex = t_pJobSystem == this ? t_workerIndex : -1;
+	while (!pCounter->IsDone()) {
+		if (!TryRunJob(workerIndex, false)) {
+			std::this_thread::yield();
+		}
+	}
+
+	//The last job decrements the counter while holding its mutex, once we own it the counter is no longer touched and the caller may destroy it
+	std::lock_guard<std::mutex> lock(pCounter->m_mutex);
+}
+
+///////////////////////////////////////////
+void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t first, uint32_t count)>& function)
+{
+	batchSize = std::max(batchSize, 1u);
+
+	JobCounter counter;
+	for (uint32_t first = 0; first < count; first += batchSize) {
+		uint32_t batchCount = std::min(batchSize, count - first);
+		Run([&function, first, batchCount]() { function(first, batchCount); }, &counter);
+	}
+
+	Wait(&counter);
+}
+
+///////////////////////////////////////////
+uint32_t JobSystem::GetThreadCount() const
+{
+	return static_cast<uint32_t>(m_workers.size());
+}
+
+///////////////////////////////////////////
+JobSystemStatistics JobSystem::GetStatistics() const
+{
+	JobSystemStatistics statistics;
+	statistics.executed = m_externalExecuted.load();
+	for (const auto& worker : m_workers) {
+		statistics.executed += worker->executed.load();
+		statistics.stolen += worker->stolen.load();
+		statistics.stealAttempts += worker->stealAttempts.load();
+	}
+	return statistics;
+}
+
+///////////////////////////////////////////
+void JobSystem::ResetStatistics()
+{
+	m_externalExecuted = 0;
+	for (auto& worker : m_workers) {
+		worker->executed = 0;
+		worker->stolen = 0;
+		worker->stealAttempts = 0;
+	}
+}
+
+///////////////////////////////////////////
+void JobSystem::WorkerLoop(uint32_t workerIndex)
+{
+	t_pJobSystem = this;
+	t_workerIndex = static_cast<int>(workerIndex);
+
+	uint32_t idleCount = 0;
+	while (true) {
+		if (TryRunJob(t_workerIndex, true)) {
+			idleCount = 0;
+			continue;
+		}
+
+		if (++idleCount < IDLE_SPIN_COUNT) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_sleepingCount.fetch_add(1);
+		m_wakeCondition.wait(lock, [this]() { return m_bStopping || m_queuedCount.load() > 0; });
+		m_sleepingCount.fetch_sub(1);
+
+		//Drain the queues before stopping so nobody is left waiting on a counter that never reaches zero
+		if (m_bStopping && m_queuedCount.load() == 0) {
+			return;
+		}
+		idleCount = 0;
+	}
+}
+
+///////////////////////////////////////////
+void JobSystem::Enqueue(Job job, JobPriority priority)
+{
+	if (priority == JobPriority::Background) {
+		std::lock_guard<std::mutex> lock(m_backgroundMutex);
+		m_backgroundJobs.push_back(std::move(job));
+	}
+	else {
+		//Jobs spawned by a worker stay on its deque where they are likely still in cache, anything else is spread round robin
+		uint32_t target = t_pJobSystem == this && t_workerIndex >= 0 ? static_cast<uint32_t>(t_workerIndex) : m_nextWorker.fetch_add(1) % static_cast<uint32_t>(m_workers.size());
+
+		Worker& worker = *m_workers[target];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.jobs.push_back(std::move(job));
+	}
+
+	//A worker only sleeps after seeing no queued jobs, so if nobody is sleeping after the increment the wake up can be skipped.
+	//Otherwise taking the lock makes sure the sleeper is already waiting before it is notified
+	m_queuedCount.fetch_add(1);
+	if (m_sleepingCount.load() > 0) {
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+		}
+		m_wakeCondition.notify_one();
+	}
+}
+
+///////////////////////////////////////////
+bool JobSystem::TryRunJob(int workerIndex, bool bAllowBackground)
+{
+	Job job;
+	bool bFound = false;
+	uint32_t workerCount = static_cast<uint32_t>(m_workers.size());
+
+	//Newest job on our own deque first, it is the most likely to still be in cache
+	if (workerIndex >= 0) {
+		Worker& worker = *m_workers[workerIndex];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (!worker.jobs.empty()) {
+			job = std::move(worker.jobs.back());
+			worker.jobs.pop_back();
+			bFound = true;
+		}
+	}
+
+	//Steal the oldest job from someone else, those tend to be the largest pieces of work left
+	uint32_t start = workerIndex >= 0 ? static_cast<uint32_t>(workerIndex) + 1 : 0;
+	for (uint32_t i = 0; i < workerCount && !bFound; ++i) {
+		uint32_t victimIndex = (start + i) % workerCount;
+		if (static_cast<int>(victimIndex) == workerIndex) {
+			continue;
+		}
+
+		if (workerIndex >= 0) {
+			m_workers[workerIndex]->stealAttempts.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		Worker& victim = *m_workers[victimIndex];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty()) {
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			bFound = true;
+
+			if (workerIndex >= 0) {
+				m_workers[workerIndex]->stolen.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	if (!bFound && bAllowBackground) {
+		std::lock_guard<std::mutex> lock(m_backgroundMutex);
+		if (!m_backgroundJobs.empty()) {
+			job = std::move(m_backgroundJobs.front());
+			m_backgroundJobs.pop_front();
+			bFound = true;
+		}
+	}
+
+	if (!bFound) {
+		return false;
+	}
+
+	m_queuedCount.fetch_sub(1);
+	Execute(job, workerIndex);
+	return true;
+}
+
+///////////////////////////////////////////
+void JobSystem::Execute(Job& job, int workerIndex)
+{
+	job.function();
+
+	if (workerIndex >= 0) {
+		m_workers[workerIndex]->executed.fetch_add(1, std::memory_order_relaxed);
+	}
+	else {
+		m_externalExecuted.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Finish(job.pCounter);
+}
+
+///////////////////////////////////////////
+void JobSystem::Finish(JobCounter* pCounter)
+{
+	if (pCounter == nullptr) {
+		return;
+	}
+
+	std::vector<JobCounter::Continuation> continuations;
+	{
+		std::lock_guard<std::mutex> lock(pCounter->m_mutex);
+		if (pCounter->m_pendingCount.fetch_sub(1) == 1) {
+			continuations.swap(pCounter->m_continuations);
+		}
+	}
+
+	//The counter may be destroyed as soon as its mutex is released, only the local copies are used from here
+	for (auto& continuation : continuations) {
+		Job job;
+		job.function = std::move(continuation.function);
+		job.pCounter = continuation.pCounter;
+		Enqueue(std::move(job), static_cast<JobPriority>(continuation.priority));
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+///////////////////////////////////////////
+//Counts the jobs of a group that have not finished yet. Jobs can be made to depend on a counter, they are only queued once it reaches zero
+class JobCounter
+{
+public:
+	bool IsDone() const;
+	uint32_t GetPendingCount() const;
+
+private:
+	friend class JobSystem;
+
+	struct Continuation {
+		std::function<void()> function;
+		JobCounter* pCounter;
+		int priority;
+	};
+
+	std::atomic<uint32_t> m_pendingCount{ 0 };
+	std::mutex m_mutex;
+	std::vector<Continuation> m_continuations; //Jobs waiting on this counter
+};
+
+///////////////////////////////////////////
+enum class JobPriority {
+	Normal,    //Frame work such as culling and command recording, stolen between workers and run by threads waiting on a counter
+	Background //Long jobs such as pipeline compiles, only picked up by idle workers so they never delay a waiting frame
+};
+
+///////////////////////////////////////////
+struct JobSystemStatistics {
+	uint64_t executed = 0;
+	uint64_t stolen = 0;
+	uint64_t stealAttempts = 0;
+};
+
+///////////////////////////////////////////
+//Work stealing scheduler. Every worker owns a deque, it pushes and pops its own jobs at the back while idle workers steal the oldest ones from the front.
+//Threads waiting on a counter run other normal jobs instead of blocking, so jobs may wait on the jobs they spawn.
+class JobSystem
+{
+public:
+	//A thread count of 0 picks one worker per hardware thread, leaving one for the main thread
+	void InitJobSystem(uint32_t threadCount = 0);
+	//Finishes every queued job before joining the workers
+	void DestroyJobSystem();
+
+	//pCounter is incremented now and decremented once the job has run. When pDependency is given the job is only queued once it is done
+	void Run(std::function<void()> job, JobCounter* pCounter = nullptr, JobPriority priority = JobPriority::Normal, JobCounter* pDependency = nullptr);
+	//Runs other jobs until the counter reaches zero
+	void Wait(JobCounter* pCounter);
+
+	//Splits [0, count) into batches of at most batchSize and blocks until every batch has run
+	void ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t first, uint32_t count)>& function);
+
+	uint32_t GetThreadCount() const;
+	JobSystemStatistics GetStatistics() const;
+	void ResetStatistics();
+
+private:
+	struct Job {
+		std::function<void()> function;
+		JobCounter* pCounter = nullptr;
+	};
+
+	struct Worker {
+		std::thread thread;
+		std::mutex mutex;
+		std::deque<Job> jobs;
+
+		std::atomic<uint64_t> executed{ 0 };
+		std::atomic<uint64_t> stolen{ 0 };
+		std::atomic<uint64_t> stealAttempts{ 0 };
+	};
+
+	void WorkerLoop(uint32_t workerIndex);
+	void Enqueue(Job job, JobPriority priority);
+	//Own deque first, then the other workers' deques, then background jobs if allowed
+	bool TryRunJob(int workerIndex, bool bAllowBackground);
+	void Execute(Job& job, int workerIndex);
+	void Finish(JobCounter* pCounter);
+
+private:
+	std::vector<std::unique_ptr<Worker>> m_workers;
+
+	std::mutex m_backgroundMutex;
+	std::deque<Job> m_backgroundJobs;
+
+	//Queued normal and background jobs, lets sleeping workers know there is something to do
+	std::atomic<uint32_t> m_queuedCount{ 0 };
+	std::atomic<uint32_t> m_sleepingCount{ 0 };
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wakeCondition;
+	bool m_bStopping = false;
+
+	std::atomic<uint32_t> m_nextWorker{ 0 }; //Round robin target for jobs pushed from outside the workers
+	std::atomic<uint64_t> m_externalExecuted{ 0 }; //Jobs run by threads inside Wait()
+};
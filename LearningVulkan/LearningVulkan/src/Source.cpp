@@ -1,22 +1,590 @@
 #include <stdexcept>
 #include <vector>
+#include <string>
+#include <iostream>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <random>
 
 #include "Application.h"
+#include "Core/Culling/FrustumCuller.h"
+#include "Core/Scene/TransformHierarchy.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+///////////////////////////////////////////
+struct CommandLineOptions {
+	ApplicationSettings settings;
+
+	//When set we draw a fixed amount of frames at every ring depth and report the throughput of each
+	bool bFramesInFlightBenchmark = false;
+	uint32_t benchmarkFrameCount = 1000;
+
+	//Measures job throughput and steal rates of the job system at every worker count from 1 to the hardware thread count, no window or device is created
+	bool bJobSystemBenchmark = false;
+	uint32_t jobBenchmarkJobCount = 1 << 20;
+
+	//Draws the same frames without and then with the depth prepass and reports the fragment shader invocations each one paid for
+	bool bDepthPrepassBenchmark = false;
+
+	//Compares scalar and SIMD CPU frustum culling at 10k, 100k and 1M objects, no window or device is created
+	bool bCullingBenchmark = false;
+
+	//Times incremental transform hierarchy updates as more and more of the nodes change each frame, no window or device is created
+	bool bTransformBenchmark = false;
+	uint32_t transformBenchmarkNodeCount = 100000;
+};
+
+///////////////////////////////////////////
+//Thrown for an argument that cannot be used as given, main prints the usage text instead of running
+class CommandLineError : public std::runtime_error
+{
+public:
+	using std::runtime_error::runtime_error;
+};
+
+///////////////////////////////////////////
+//Whole decimal numbers that fit in 32 bits. std::stoul alone accepts trailing text and wraps negative numbers
+static uint32_t ParseUnsigned(const std::string& arg, const std::string& value)
+{
+	if (value.empty() || value.size() > 10 || value.find_first_not_of("0123456789") != std::string::npos || std::stoull(value) > UINT32_MAX) {
+		throw CommandLineError(arg + " expects a whole number up to " + std::to_string(UINT32_MAX) + ", not \"" + value + "\"");
+	}
+
+	return static_cast<uint32_t>(std::stoull(value));
+}
+
+///////////////////////////////////////////
+static float ParseFloat(const std::string& arg, const std::string& value)
+{
+	size_t length = 0;
+	float number = 0.0f;
+	try {
+		number = std::stof(value, &length);
+	}
+	catch (const std::logic_error&) {
+		length = 0;
+	}
+
+	if (length == 0 || length != value.size() || !std::isfinite(number)) {
+		throw CommandLineError(arg + " expects a number, not \"" + value + "\"");
+	}
+
+	return number;
+}
+
+///////////////////////////////////////////
+static void PrintUsage()
+{
+	std::cerr << "Usage: LearningVulkan [options]\n"
+		"  --frames-in-flight <1-4>         Frames the CPU may record ahead of the GPU\n"
+		"  --headless                       Render into offscreen images with no window\n"
+		"  --headless-frames <n>            Frames a headless run draws\n"
+		"  --benchmark                      Time frames and write a JSON report\n"
+		"  --warmup-frames <n>              Untimed frames drawn before the benchmark\n"
+		"  --measure-frames <n>             Frames the benchmark times\n"
+		"  --benchmark-output <path>        Where the benchmark report is written\n"
+		"  --pipeline-stats                 Collect pipeline statistics queries\n"
+		"  --pipeline-cache <path>          Pipeline cache loaded at startup and written at shutdown\n"
+		"  --no-pipeline-cache              Neither load nor write a pipeline cache\n"
+		"  --worker-threads <n>             Worker threads, 0 uses one per hardware thread\n"
+		"  --draw-count <n>                 Copies of the mesh drawn each frame\n"
+		"  --stress-triangles <n>           Draw a grid mesh totalling about this many triangles\n"
+		"  --parallel-recording             Record the draw list on the worker threads\n"
+		"  --gpu-driven                     Cull in a compute pass and draw with one indirect count call\n"
+		"  --occlusion-culling              Two phase Hi-Z occlusion culling, implies --gpu-driven\n"
+		"  --depth-layers <n>               Stack the draw list in this many layers\n"
+		"  --depth-prepass                  Draw depth only before shading\n"
+		"  --no-reversed-z                  Near at depth 0 and far at 1 with a LESS test\n"
+		"  --scene-nodes <n>                Nodes in a random transform hierarchy updated every frame\n"
+		"  --scene-change-ratio <ratio>     Fraction of the hierarchy changed each frame\n"
+		"  --static-command-buffers         Reuse one recorded command buffer per swap chain image\n"
+		"  --upload-ring-mb <n>             Size of the staging ring in megabytes\n"
+		"  --upload-benchmark <n>           Stream this many megabytes to the GPU first and report the bandwidth\n"
+		"  --defrag-budget-kb <n>           Most the defragmenter copies per frame, 0 turns it off\n"
+		"  --fragmentation-test <n>         Create this many buffers and free every other one at startup\n"
+		"  --job-benchmark                  Measure job system throughput at every worker count\n"
+		"  --job-benchmark-jobs <n>         Jobs per job system benchmark run\n"
+		"  --culling-benchmark              Compare scalar and SIMD frustum culling\n"
+		"  --transform-benchmark            Time incremental transform hierarchy updates\n"
+		"  --transform-benchmark-nodes <n>  Nodes in the transform benchmark hierarchy\n"
+		"  --benchmark-depth-prepass        Compare fragment counts with and without the depth prepass\n"
+		"  --benchmark-frames-in-flight     Report throughput at every frames in flight depth\n"
+		"  --benchmark-frame-count <n>      Frames drawn by each benchmark run\n";
+}
+
+///////////////////////////////////////////
+static CommandLineOptions ParseCommandLine(int argc, char** argv)
+{
+	CommandLineOptions options;
+	bool bHeadlessFrameCountGiven = false;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool bHasValue = i + 1 < argc;
+
+		if (arg == "--frames-in-flight" && bHasValue) {
+			options.settings.framesInFlight = ParseUnsigned(arg, argv[++i]);
+		}
+		else if (arg == "--headless") {
+			options.settings.bHeadless = true;
+		}
+		else if (arg == "--headless-frames" && bHasValue) {
+			options.settings.headlessFrameCount = ParseUnsigned(arg, argv[++i]);
+			bHeadlessFrameCountGiven = true;
+		}
+		else if (arg == "--benchmark") {
+			options.settings.bBenchmark = true;
+		}
+		else if (arg == "--warmup-frames" && bHasValue) {
+			options.settings.benchmarkWarmupFrames = ParseUnsigned(arg, argv[++i]);
+		}
+		else if (arg == "--measure-frames" && bHasValue) {
+			options.settings.benchmarkMeasureFrames = ParseUnsigned(arg, argv[++i]);
+		}
+		else if (arg == "--benchmark-output" && bHasValue) {
+			options.settings.benchmarkOutputPath = argv[++i];
+		}
+		else if (arg == "--pipeline-stats") {
+			options.settings.bPipelineStatistics = true;
+		}
+		else if (arg == "--pipeline-cache" && bHasValue) {
+			options.settings.pipelineCachePath = argv[++i];
+		}
+		else if (arg == "--no-pipeline-cache") {
+			options.settings.pipelineCachePath.clear();
+		}
+		else if (arg == "--worker-threads" && bHasValue) {
+			options.settings.workerThreadCount = ParseUnsigned(arg, argv[++i]);
+		}
+		else if (arg == "--draw-count" && bHasValue) {
+			options.settings.drawCount = ParseUnsigned(arg, argv[++i]);
+		}
+		else if (arg == "--stress-triangles" && bHasValue) {
+			options.settings.stressTriangleCount = ParseUnsigned(arg, argv[++i]);
+		}
+		else if (arg == "--parallel-recording") {
+			options.settings.bParallelRecording = true;
+		}
+		else if (arg == "--gpu-driven") {
+			options.settings.bGpuDrivenRendering = true;
+		}
+		else if (arg == "--occlusion-culling") {
+			options.settings.bOcclusionCulling = true;
+		}
+		else if (arg == "--depth-layers" && bHasValue) {
+			options.settings.depthLayerCount = ParseUnsigned(arg, argv[++i]);
+		}
+		else if (arg == "--depth-prepass") {
+			options.settings.bDepthPrepass = true;
+		}
+		else if (arg == "--no-reversed-z") {
+			options.settings.bReversedDepth = false;
+		}
+		else if (arg == "--scene-nodes" && bHasValue) {
+			options.settings.sceneNodeCount = ParseUnsigned(arg, argv[++i]);
+		}
+		else if (arg == "--scene-change-ratio" && bHasValue) {
+			options.settings.sceneChangeRatio = ParseFloat(arg, argv[++i]);
+		}
+		else if (arg == "--static-command-buffers") {
+			options.settings.bStaticCommandBuffers = true;
+		}
+		else if (arg == "--upload-ring-mb" && bHasValue) {
+			options.settings.uploadRingMegabytes = ParseUnsigned(arg, argv[++i]);
+		}
+		else if (arg == "--upload-benchmark" && bHasValue) {
+			options.settings.uploadBenchmarkMegabytes = ParseUnsigned(arg, argv[++i]);
+		}
+		else if (arg == "--defrag-budget-kb" && bHasValue) {
+			options.settings.defragmentBudgetKilobytes = ParseUnsigned(arg, argv[++i]);
+		}
+		else if (arg == "--fragmentation-test" && bHasValue) {
+			options.settings.fragmentationTestBufferCount = ParseUnsigned(arg, argv[++i]);
+		}
+		else if (arg == "--job-benchmark") {
+			options.bJobSystemBenchmark = true;
+		}
+		else if (arg == "--job-benchmark-jobs" && bHasValue) {
+			options.jobBenchmarkJobCount = ParseUnsigned(arg, argv[++i]);
+		}
+		else if (arg == "--culling-benchmark") {
+			options.bCullingBenchmark = true;
+		}
+		else if (arg == "--transform-benchmark") {
+			options.bTransformBenchmark = true;
+		}
+		else if (arg == "--transform-benchmark-nodes" && bHasValue) {
+			options.transformBenchmarkNodeCount = ParseUnsigned(arg, argv[++i]);
+		}
+		else if (arg == "--benchmark-depth-prepass") {
+			options.bDepthPrepassBenchmark = true;
+		}
+		else if (arg == "--benchmark-frames-in-flight") {
+			options.bFramesInFlightBenchmark = true;
+		}
+		else if (arg == "--benchmark-frame-count" && bHasValue) {
+			options.benchmarkFrameCount = ParseUnsigned(arg, argv[++i]);
+		}
+		else {
+			std::cerr << "Ignoring unknown argument: " << arg << "\n";
+		}
+	}
+
+	//Each of these replaces the normal run, so a second one would be silently ignored
+	uint32_t runModeCount = 0;
+	for (bool bRunMode : { options.settings.bBenchmark, options.bFramesInFlightBenchmark, options.bDepthPrepassBenchmark, options.bJobSystemBenchmark, options.bCullingBenchmark, options.bTransformBenchmark }) {
+		runModeCount += bRunMode ? 1 : 0;
+	}
+	if (runModeCount > 1) {
+		throw CommandLineError("Only one of --benchmark, --benchmark-frames-in-flight, --benchmark-depth-prepass, --job-benchmark, --culling-benchmark and --transform-benchmark can be used at a time");
+	}
+
+	//A benchmark draws its own warm up and measured frame counts
+	if (bHeadlessFrameCountGiven && options.settings.bBenchmark) {
+		throw CommandLineError("--headless-frames has no effect with --benchmark, use --warmup-frames and --measure-frames");
+	}
+
+	return options;
+}
+
+///////////////////////////////////////////
+static int RunFramesInFlightBenchmark(const CommandLineOptions& options)
+{
+	std::cout << "Frames in flight benchmark (" << options.benchmarkFrameCount << " frames per depth)\n";
+
+	for (uint32_t depth = 1; depth <= MAX_FRAMES_IN_FLIGHT; ++depth) {
+		ApplicationSettings settings = options.settings;
+		settings.framesInFlight = depth;
+
+		Application app;
+		app.Init(1920, 1080, "Hello Triangle", settings);
+
+		double seconds = 0.0;
+		uint32_t renderedFrameCount = 0;
+		try {
+			seconds = app.RunTimed(options.benchmarkFrameCount, renderedFrameCount);
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << "\n";
+			return 1;
+		}
+
+		app.Cleanup();
+
+		if (renderedFrameCount == 0) {
+			std::cerr << "\tDepth " << depth << ": the window was closed before any frame was drawn\n";
+			return 1;
+		}
+
+		double framesPerSecond = seconds > 0.0 ? renderedFrameCount / seconds : 0.0;
+		std::cout << "\tDepth " << depth << ": " << framesPerSecond << " frames/s (" << (seconds * 1000.0) / renderedFrameCount << " ms/frame)\n";
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////
+static int RunDepthPrepassBenchmark(const CommandLineOptions& options)
+{
+	const uint32_t width = 1920;
+	const uint32_t height = 1080;
+	std::cout << "Depth prepass benchmark (" << options.benchmarkFrameCount << " frames per run, " << options.settings.depthLayerCount << " depth layers)\n";
+
+	//Fragment shader invocations come from the pipeline statistics queries, so both runs need them
+	double fragmentsPerFrame[2] = {};
+	for (uint32_t run = 0; run < 2; ++run) {
+		ApplicationSettings settings = options.settings;
+		settings.bDepthPrepass = run == 1;
+		settings.bPipelineStatistics = true;
+
+		Application app;
+		app.Init(width, height, "Hello Triangle", settings);
+
+		double seconds = 0.0;
+		uint32_t renderedFrameCount = 0;
+		try {
+			seconds = app.RunTimed(options.benchmarkFrameCount, renderedFrameCount);
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << "\n";
+			return 1;
+		}
+
+		fragmentsPerFrame[run] = app.GetFragmentsPerFrame();
+		app.Cleanup();
+
+		if (renderedFrameCount == 0) {
+			std::cerr << "\tThe window was closed before any frame was drawn\n";
+			return 1;
+		}
+
+		std::cout << "\t" << (settings.bDepthPrepass ? "Prepass" : "No prepass") << ": " << (seconds * 1000.0) / renderedFrameCount << " ms/frame, "
+			<< fragmentsPerFrame[run] / 1000000.0 << "M fragments/frame (" << fragmentsPerFrame[run] / (static_cast<double>(width) * height) << " per pixel)\n";
+	}
+
+	if (fragmentsPerFrame[0] > 0.0) {
+		std::cout << "\tThe prepass shaded " << (1.0 - fragmentsPerFrame[1] / fragmentsPerFrame[0]) * 100.0 << "% fewer fragments\n";
+	}
+	else {
+		std::cerr << "\tNo fragment counts were collected, the device may not support pipeline statistics queries\n";
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////
+//A few hundred nanoseconds of arithmetic, small enough that scheduling overhead dominates
+static uint64_t JobBenchmarkWork(uint64_t seed)
+{
+	uint64_t value = seed;
+	for (int i = 0; i < 64; ++i) {
+		value = value * 6364136223846793005ull + 1442695040888963407ull;
+	}
+	return value;
+}
 
 ///////////////////////////////////////////
-int main() {
+static int RunJobSystemBenchmark(const CommandLineOptions& options)
+{
+	//Every root job spawns its children onto its own worker's deque, so the other workers only get work by stealing
+	const uint32_t fanOut = 64;
+	uint32_t rootCount = std::max(options.jobBenchmarkJobCount / fanOut, 1u);
+	uint32_t jobCount = rootCount * fanOut;
+	std::vector<uint64_t> results(jobCount);
+
+	uint32_t maxWorkers = std::max(std::thread::hardware_concurrency(), 1u);
+	std::cout << "Job system benchmark (" << jobCount << " jobs per run, the main thread also runs jobs while waiting)\n";
+
+	for (uint32_t workers = 1; workers <= maxWorkers; ++workers) {
+		JobSystem jobSystem;
+		jobSystem.InitJobSystem(workers);
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		JobCounter counter;
+		for (uint32_t root = 0; root < rootCount; ++root) {
+			jobSystem.Run([&jobSystem, &counter, &results, root, fanOut]() {
+				for (uint32_t child = 0; child < fanOut; ++child) {
+					uint32_t index = root * fanOut + child;
+					jobSystem.Run([&results, index]() { results[index] = JobBenchmarkWork(index); }, &counter);
+				}
+			}, &counter);
+		}
+		jobSystem.Wait(&counter);
+
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		JobSystemStatistics stats = jobSystem.GetStatistics();
+		jobSystem.DestroyJobSystem();
+
+		double seconds = elapsed.count();
+		double stealRate = stats.executed > 0 ? static_cast<double>(stats.stolen) / stats.executed : 0.0;
+		double stealSuccess = stats.stealAttempts > 0 ? static_cast<double>(stats.stolen) / stats.stealAttempts : 0.0;
+		std::cout << "\tWorkers " << workers << ": " << (stats.executed / seconds) / 1000000.0 << "M jobs/s, "
+			<< stealRate * 100.0 << "% of jobs stolen, " << stealSuccess * 100.0 << "% of steal attempts succeeded\n";
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////
+static int RunCullingBenchmark()
+{
+	//A camera at the origin looking down -z, spheres are scattered through a box wider than the frustum so only part of them survive
+	glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+	glm::mat4 view = glm::lookAtRH(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	FrustumPlanes planes = FrustumCuller::ExtractFrustumPlanes(projection * view);
+
+	std::cout << "Culling benchmark (" << FrustumCuller::GetSimdName() << ", " << FrustumCuller::GetSimdWidth() << " objects per instruction)\n";
+
+	const uint32_t objectCounts[] = { 10000, 100000, 1000000 };
+	for (uint32_t objectCount : objectCounts) {
+		std::mt19937 random(objectCount);
+		std::uniform_real_distribution<float> horizontal(-800.0f, 800.0f);
+		std::uniform_real_distribution<float> depth(-1100.0f, 100.0f);
+		std::uniform_real_distribution<float> radius(0.5f, 5.0f);
+
+		FrustumCuller culler;
+		culler.Reserve(objectCount);
+		for (uint32_t i = 0; i < objectCount; ++i) {
+			culler.AddSphere(glm::vec3(horizontal(random), horizontal(random), depth(random)), radius(random));
+		}
+
+		//Enough repeats that every count tests about the same number of spheres
+		uint32_t iterations = std::max(20000000u / objectCount, 1u);
+		std::vector<uint32_t> scalarVisible;
+		std::vector<uint32_t> simdVisible;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < iterations; ++i) {
+			culler.CullScalar(planes, scalarVisible);
+		}
+		std::chrono::duration<double> scalarSeconds = std::chrono::high_resolution_clock::now() - start;
+
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < iterations; ++i) {
+			culler.Cull(planes, simdVisible);
+		}
+		std::chrono::duration<double> simdSeconds = std::chrono::high_resolution_clock::now() - start;
+
+		double tested = static_cast<double>(objectCount) * iterations;
+		double scalarRate = tested / scalarSeconds.count() / 1000000.0;
+		double simdRate = tested / simdSeconds.count() / 1000000.0;
+		std::cout << "\t" << objectCount << " objects: scalar " << scalarRate << "M objects/s, SIMD " << simdRate << "M objects/s ("
+			<< simdRate / scalarRate << "x), " << simdVisible.size() << " visible\n";
+
+		if (scalarVisible != simdVisible) {
+			std::cerr << "\tScalar and SIMD culling disagree: " << scalarVisible.size() << " vs " << simdVisible.size() << " visible\n";
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////
+static int RunTransformBenchmark(const CommandLineOptions& options)
+{
+	const uint32_t nodeCount = std::max(options.transformBenchmarkNodeCount, 1u);
+	const uint32_t frameCount = 1000;
+	const uint32_t destinationCount = 2; //Stands in for a mapped buffer with one region per frame in flight
+
+	JobSystem jobSystem;
+	jobSystem.InitJobSystem(options.settings.workerThreadCount);
+
+	//Built depth first like the application's scene, the local transforms are mirrored here to check the results against
+	std::mt19937 random(nodeCount);
+	std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+	std::bernoulli_distribution climb(0.55);
+	std::vector<NodeHandle> parents(nodeCount);
+	std::vector<glm::mat4> locals(nodeCount);
+	std::vector<NodeHandle> path;
+
+	TransformHierarchy hierarchy;
+	hierarchy.Reserve(nodeCount);
+	for (uint32_t i = 0; i < nodeCount; ++i) {
+		while (!path.empty() && (path.size() >= 16 || climb(random))) {
+			path.pop_back();
+		}
+		parents[i] = path.empty() ? INVALID_NODE_HANDLE : path.back();
+		path.push_back(i);
+		glm::vec3 position(offset(random), offset(random), offset(random));
+		locals[i] = glm::translate(glm::mat4(1.0f), position);
+		hierarchy.AddNode(parents[i], position);
+	}
+	hierarchy.SetDestinationCount(destinationCount);
+
+	std::vector<glm::mat4> destination(static_cast<size_t>(nodeCount) * destinationCount);
+	auto start = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < destinationCount; ++i) {
+		hierarchy.UpdateWorldMatrices(&jobSystem, destination.data() + static_cast<size_t>(nodeCount) * i, i);
+	}
+	std::chrono::duration<double, std::micro> buildUs = std::chrono::high_resolution_clock::now() - start;
+
+	std::cout << "Transform benchmark (" << nodeCount << " nodes, " << hierarchy.GetDepth() << " deep, " << jobSystem.GetThreadCount() << " workers)\n";
+	std::cout << "\tSort and first update of every destination: " << buildUs.count() << " us\n";
+
+	std::uniform_int_distribution<uint32_t> node(0, nodeCount - 1);
+	const double ratios[] = { 0.001, 0.01, 0.1, 1.0 };
+	for (double ratio : ratios) {
+		uint32_t changeCount = static_cast<uint32_t>(nodeCount * ratio);
+		double totalUs = 0.0;
+		uint64_t updatedNodes = 0;
+
+		for (uint32_t frame = 0; frame < frameCount; ++frame) {
+			for (uint32_t i = 0; i < changeCount; ++i) {
+				NodeHandle handle = node(random);
+				glm::vec3 position(offset(random), offset(random), offset(random));
+				glm::quat rotation = glm::angleAxis(angle(random), glm::vec3(0.0f, 1.0f, 0.0f));
+				locals[handle] = glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation);
+				hierarchy.SetLocalTransform(handle, position, rotation, glm::vec3(1.0f));
+			}
+
+			//Setting the transforms is the caller's cost, only the update is timed
+			uint32_t destinationIndex = frame % destinationCount;
+			updatedNodes += hierarchy.UpdateWorldMatrices(&jobSystem, destination.data() + static_cast<size_t>(nodeCount) * destinationIndex, destinationIndex);
+			totalUs += hierarchy.GetStatistics().lastUpdateUs;
+		}
+
+		std::cout << "\t" << ratio * 100.0 << "% changed: " << totalUs / frameCount << " us/frame, " << updatedNodes / frameCount << " world matrices recomputed/frame\n";
+	}
+
+	//With nothing left to change, one more update per destination brings every copy up to date
+	for (uint32_t i = 0; i < destinationCount; ++i) {
+		hierarchy.UpdateWorldMatrices(&jobSystem, destination.data() + static_cast<size_t>(nodeCount) * i, i);
+	}
+	jobSystem.DestroyJobSystem();
+
+	//Handles were given out in order and parents always come first, so one pass in handle order is the reference
+	std::vector<glm::mat4> reference(nodeCount);
+	uint32_t mismatchCount = 0;
+	for (uint32_t i = 0; i < nodeCount; ++i) {
+		reference[i] = parents[i] == INVALID_NODE_HANDLE ? locals[i] : reference[parents[i]] * locals[i];
+		for (uint32_t d = 0; d < destinationCount; ++d) {
+			const glm::mat4& written = destination[static_cast<size_t>(nodeCount) * d + i];
+			for (int column = 0; column < 4; ++column) {
+				if (glm::any(glm::greaterThan(glm::abs(written[column] - reference[i][column]), glm::vec4(1e-3f)))) {
+					mismatchCount++;
+					break;
+				}
+			}
+		}
+	}
+
+	if (mismatchCount > 0) {
+		std::cerr << "\t" << mismatchCount << " written world matrices disagree with the reference\n";
+		return 1;
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////
+int main(int argc, char** argv) {
+	CommandLineOptions options;
+	try {
+		options = ParseCommandLine(argc, argv);
+	}
+	catch (const CommandLineError& e) {
+		std::cerr << e.what() << "\n\n";
+		PrintUsage();
+		return 1;
+	}
+
+	if (options.bJobSystemBenchmark) {
+		return RunJobSystemBenchmark(options);
+	}
+
+	if (options.bCullingBenchmark) {
+		return RunCullingBenchmark();
+	}
+
+	if (options.bTransformBenchmark) {
+		return RunTransformBenchmark(options);
+	}
+
+	if (options.bDepthPrepassBenchmark) {
+		return RunDepthPrepassBenchmark(options);
+	}
+
+	if (options.bFramesInFlightBenchmark) {
+		return RunFramesInFlightBenchmark(options);
+	}
+
 	Application app;
-	app.Init(1920,1080, "Hello Triangle");
+	app.Init(1920,1080, "Hello Triangle", options.settings);
 
 	try {
 		app.Run();
 	}
 	catch (const std::exception& e) {
-		printf(e.what() + '\n');
+		std::cerr << e.what() << "\n";
 		return 1;
 	}
 
 	app.Cleanup();
 
 	return 0;
-}
\ No newline at end of file
+}